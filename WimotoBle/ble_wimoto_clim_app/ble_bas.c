@@ -15,6 +15,7 @@
 #include "nordic_common.h"
 #include "ble_srv_common.h"
 #include "app_util.h"
+#include "wimoto_hvx.h"
 
 
 #define INVALID_BATTERY_LEVEL  255
@@ -293,7 +294,7 @@ uint32_t ble_bas_battery_level_update(ble_bas_t * p_bas, uint8_t battery_level)
             hvx_params.p_len    = &len;
             hvx_params.p_data   = &battery_level;
             
-            err_code = sd_ble_gatts_hvx(p_bas->conn_handle, &hvx_params);
+            err_code = wimoto_hvx_send(p_bas->conn_handle, &hvx_params);
         }
         else
         {
@@ -24,17 +24,17 @@
 #include "ble_srv_common.h"
 #include "app_util.h"
 #include "wimoto.h"
+#include "wimoto_evt.h"
+#include "wimoto_hvx.h"
 #include "wimoto_sensors.h"
 
-extern bool     CHECK_ALARM_TIMEOUT;          /*Flag to indicate whether to check for alarm conditions defined in connect.c*/
 bool 						HUMS_CONNECTED_STATE=false;   /*This flag indicates whether a client is connected to the peripheral in humidity service*/
 extern uint8_t	var_receive_uuid;							/*variable for receiving uuid*/
 extern uint8_t	htu_hum_level[2];             /*variable to store current humidity value to broadcast*/ 
 bool            hum_alarm_set_changed = false;
 
 bool     				m_hums_alarm_ind_conf_pending = false;       /**< Flag to keep track of when an indication confirmation is pending.*/
-extern bool     m_temps_alarm_ind_conf_pending;
-extern bool     m_lights_alarm_ind_conf_pending;
+bool     				HUMS_READ_PENDING = false;       /**< Flag to keep track of when a read of the current humidity level waits for a measurement. */
 
 /**@brief Function for handling the Connect event.
 *
@@ -45,7 +45,7 @@ static void on_connect(ble_hums_t * p_hums, ble_evt_t * p_ble_evt)
 {		
     p_hums->conn_handle = p_ble_evt->evt.gap_evt.conn_handle;
     HUMS_CONNECTED_STATE = true;      /*Set the flag to true so that state remains in connectable mode until disconnect*/
-		CHECK_ALARM_TIMEOUT   = true;     /*set the flag to true to check the alarm condition on connection*/
+		wimoto_evt_post(WIMOTO_EVT_ALARM_CHECK); /*check the alarm conditions on connection*/
 }
 
 
@@ -62,6 +62,27 @@ static void on_disconnect(ble_hums_t * p_hums, ble_evt_t * p_ble_evt)
 }
 
 
+/**@brief Function for handling the Read/Write Authorization Request event.
+*
+* @details A read of the current humidity level is answered by ble_hums_current_read_reply() once the main loop
+*          has taken a new measurement.
+*
+* @param[in]   p_hums      Humidity Service structure.
+* @param[in]   p_ble_evt   Event received from the BLE stack.
+*/
+static void on_rw_authorize_request(ble_hums_t * p_hums, ble_evt_t * p_ble_evt)
+{
+    ble_gatts_evt_rw_authorize_request_t * p_auth_req = &p_ble_evt->evt.gatts_evt.params.authorize_request;
+
+    if ((p_auth_req->type == BLE_GATTS_AUTHORIZE_TYPE_READ) &&
+        (p_auth_req->request.read.handle == p_hums->current_hum_level_handles.value_handle))
+    {
+        HUMS_READ_PENDING = true;
+        wimoto_evt_post(WIMOTO_EVT_READ_SENSORS);    /* the measurement is taken from the main loop*/
+    }
+}
+
+
 /**@brief Function for handling write events on values.
 *
 * @details This function will be called for all write events of humidity low, high values and alarm set 
@@ -69,7 +90,7 @@ static void on_disconnect(ble_hums_t * p_hums, ble_evt_t * p_ble_evt)
 */
 static void write_evt_handler(void)
 {   
-    CHECK_ALARM_TIMEOUT = true; 
+    wimoto_evt_post(WIMOTO_EVT_ALARM_CHECK);
 }
 
 static void on_hums_evt(ble_hums_t * p_hums, ble_hums_alarm_evt_t *p_evt)
@@ -305,11 +326,16 @@ void ble_hums_on_ble_evt(ble_hums_t * p_hums, ble_evt_t * p_ble_evt)
 
     case BLE_GAP_EVT_DISCONNECTED:
 				m_hums_alarm_ind_conf_pending = false;												//Clear pending confirmation flag if a disconnect occurs	
+				HUMS_READ_PENDING = false;
         on_disconnect(p_hums, p_ble_evt);
         break;
 
     case BLE_GATTS_EVT_WRITE:
         on_write(p_hums, p_ble_evt);
+        break;
+
+    case BLE_GATTS_EVT_RW_AUTHORIZE_REQUEST:
+        on_rw_authorize_request(p_hums, p_ble_evt);
         break;
 		case BLE_GATTS_EVT_HVC:
             on_hvc(p_hums, p_ble_evt);
@@ -365,7 +391,7 @@ static uint32_t current_hum_level_char_add(ble_hums_t * p_hums, const ble_hums_i
     attr_md.read_perm  = p_hums_init->hums_char_attr_md.read_perm;
     attr_md.write_perm = p_hums_init->hums_char_attr_md2.write_perm;
     attr_md.vloc       = BLE_GATTS_VLOC_USER;
-    attr_md.rd_auth    = 0;
+    attr_md.rd_auth    = 1;                                   /* the value is measured when a client reads it*/
     attr_md.wr_auth    = 0;
     attr_md.vlen       = 0;
 
@@ -785,7 +811,7 @@ uint32_t ble_hums_level_alarm_check(ble_hums_t * p_hums,ble_device_t *p_device)
             hvx_params.p_len    = &len1;
             hvx_params.p_data   = current_hum_level_array;
 
-            err_code = sd_ble_gatts_hvx(p_hums->conn_handle, &hvx_params);
+            err_code = wimoto_hvx_send(p_hums->conn_handle, &hvx_params);
 						previous_hum_level = current_hum_level;
         }
         else
@@ -813,25 +839,13 @@ uint32_t ble_hums_level_alarm_check(ble_hums_t * p_hums,ble_device_t *p_device)
         if(current_hum_level < hum_level_low_value)
         {
             alarm[0] = SET_ALARM_LOW;		/*set alarm to 01 if humidity level is low */
-						alarm[1]=p_device->device_time_stamp_set[0];
-						alarm[2]=p_device->device_time_stamp_set[1];
-						alarm[3]=p_device->device_time_stamp_set[2];
-						alarm[4]=p_device->device_time_stamp_set[3];
-						alarm[5]=p_device->device_time_stamp_set[4];
-						alarm[6]=p_device->device_time_stamp_set[5];
-						alarm[7]=p_device->device_time_stamp_set[6];
+						ble_time_stamp_encode(&alarm[1]);	/*capture the timestamp when alarm occured*/
         }
         
         else if(current_hum_level > hum_level_high_value)
         {
             alarm[0] = SET_ALARM_HIGH;		       /*set alarm to 02 if humidity level is high */
-						alarm[1]=p_device->device_time_stamp_set[0];
-						alarm[2]=p_device->device_time_stamp_set[1];
-						alarm[3]=p_device->device_time_stamp_set[2];
-						alarm[4]=p_device->device_time_stamp_set[3];
-						alarm[5]=p_device->device_time_stamp_set[4];
-						alarm[6]=p_device->device_time_stamp_set[5];
-						alarm[7]=p_device->device_time_stamp_set[6];
+						ble_time_stamp_encode(&alarm[1]);	/*capture the timestamp when alarm occured*/
         } 
 	
     }
@@ -854,7 +868,7 @@ uint32_t ble_hums_level_alarm_check(ble_hums_t * p_hums,ble_device_t *p_device)
     if((alarm[0]!= 0x00)&&(p_hums->climate_hum_alarm_set == 0x01))  /*check whether the alarm is tripped and alarm set characteristics is set to ON*/
     {		
 				//check whether the confirmation for indication is not pending
-        if((!m_temps_alarm_ind_conf_pending)&&(!m_lights_alarm_ind_conf_pending)&&(!m_hums_alarm_ind_conf_pending))
+        if(!m_hums_alarm_ind_conf_pending)
 				{
 				// Send value if connected and notifying
         if ((p_hums->conn_handle != BLE_CONN_HANDLE_INVALID) && p_hums->is_notification_supported)
@@ -869,7 +883,7 @@ uint32_t ble_hums_level_alarm_check(ble_hums_t * p_hums,ble_device_t *p_device)
             hvx_params.p_len    = &len;
             hvx_params.p_data   = alarm;
 
-            err_code = sd_ble_gatts_hvx(p_hums->conn_handle, &hvx_params);
+            err_code = wimoto_hvx_send(p_hums->conn_handle, &hvx_params);
 						p_hums->hums_alarm_with_time_stamp[0]= alarm[0];
 						if(err_code == NRF_SUCCESS)
 						{
@@ -887,7 +901,43 @@ uint32_t ble_hums_level_alarm_check(ble_hums_t * p_hums,ble_device_t *p_device)
 
 }
 
-/**@brief Function to read humidity level from htu21d.
+
+/**@brief Function for answering a pending read of the current humidity level.
+*
+* @details The application calls this function from the main loop after a read of the current
+*          humidity level was requested.
+*
+* @param[in]   p_hums    Humidity Service structure.
+*
+* @return      NRF_SUCCESS on success, NRF_ERROR_INVALID_STATE if no read is pending, otherwise an error code.
+*/
+uint32_t ble_hums_current_read_reply(ble_hums_t * p_hums)
+{
+    ble_gatts_rw_authorize_reply_params_t auth_reply;
+    uint16_t                              current_value;
+    uint8_t                               current_value_array[2];
+
+    if (!HUMS_READ_PENDING)
+    {
+        return NRF_ERROR_INVALID_STATE;
+    }
+    HUMS_READ_PENDING = false;
+
+    current_value          = read_hum_level();
+    current_value_array[0] = current_value >> 8;
+    current_value_array[1] = (uint8_t)(current_value & LOWER_BYTE_MASK);
+
+    memset(&auth_reply, 0, sizeof(auth_reply));
+
+    auth_reply.type                    = BLE_GATTS_AUTHORIZE_TYPE_READ;
+    auth_reply.params.read.gatt_status = BLE_GATT_STATUS_SUCCESS;
+    auth_reply.params.read.len         = sizeof(current_value_array);
+    auth_reply.params.read.p_data      = current_value_array;       /* the stack copies the value to the characteristic*/
+
+    return sd_ble_gatts_rw_authorize_reply(p_hums->conn_handle, &auth_reply);
+}
+
+/**@brief Function to read humidity level from htu21d, as acquired by wimoto_sensors_acquire().
 *
 * @param[in]   void
 * @param[out]  uint16_t current_hum_level.
@@ -896,9 +946,7 @@ uint16_t read_hum_level()
 {
     static uint16_t current_hum_level = 0x0000;
 
-    twi_turn_ON();
-    current_hum_level = eDRV_HTU21_MeasureHumidity();  /* Read Humidity from HTU21D sensor*/
-    twi_turn_OFF(); 
+    current_hum_level = wimoto_sensors_sample()->humidity;  /* Humidity of the latest HTU21D sample*/
 
     return current_hum_level;
 }	
@@ -141,6 +141,14 @@ void ble_hums_on_ble_evt(ble_hums_t * p_hums, ble_evt_t * p_ble_evt);
 */
 uint32_t ble_hums_level_alarm_check(ble_hums_t *,ble_device_t *);
 
+/**@brief Function for answering a pending read of the current humidity level with a new measurement.
+*
+* @param[in]   p_hums    Humidity Service structure.
+*
+* @return      NRF_SUCCESS on success, NRF_ERROR_INVALID_STATE if no read is pending, otherwise an error code.
+*/
+uint32_t ble_hums_current_read_reply(ble_hums_t *);
+
 /**@brief Function to read humidity level from htu21d.
 *
 * @param[in]   void
@@ -142,6 +142,14 @@ void ble_lights_on_ble_evt(ble_lights_t * p_lights, ble_evt_t * p_ble_evt);
 */
 uint32_t ble_lights_level_alarm_check(ble_lights_t *, ble_device_t *);
 
+/**@brief Function for answering a pending read of the current light level with a new measurement.
+*
+* @param[in]   p_lights    Light Service structure.
+*
+* @return      NRF_SUCCESS on success, NRF_ERROR_INVALID_STATE if no read is pending, otherwise an error code.
+*/
+uint32_t ble_lights_current_read_reply(ble_lights_t *);
+
 /**@brief Function to read light_level from isl29023.
 *
 * @param[in]    void
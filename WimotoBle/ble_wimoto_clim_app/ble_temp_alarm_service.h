@@ -141,6 +141,14 @@ void ble_temps_on_ble_evt(ble_temps_t * p_bas, ble_evt_t * p_ble_evt);
 */
 uint32_t ble_temps_level_alarm_check(ble_temps_t *,ble_device_t *);
 
+/**@brief Function for answering a pending read of the current temperature with a new measurement.
+*
+* @param[in]   p_temps    Temperature Service structure.
+*
+* @return      NRF_SUCCESS on success, NRF_ERROR_INVALID_STATE if no read is pending, otherwise an error code.
+*/
+uint32_t ble_temps_current_read_reply(ble_temps_t *);
+
 /**@brief Function to read temperature from htu21d.
 *
 * @param[in]    void
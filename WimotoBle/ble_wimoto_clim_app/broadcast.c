@@ -254,7 +254,7 @@ void do_temperature_measurement(uint8_t *buffer)
 {
     uint16_t current_temperature;
 
-    current_temperature = eDRV_HTU21_MeasureTemperature(); /* Read temperature from htu21d */
+    current_temperature = wimoto_sensors_sample()->temperature; /* Temperature from htu21d */
     buffer[1]           = current_temperature & 0x00FF;    /* Convert the 16 bit temperature variable to unit8 array */
     buffer[0]           = current_temperature >>8;
 
@@ -264,7 +264,7 @@ void do_light_measurement(uint8_t *buffer)
 {
     uint16_t current_light;
 
-    current_light      = ISL29023_get_one_time_ALS();      /* Read Light level from isl2903sensor*/
+    current_light      = wimoto_sensors_sample()->light_level; /* Light level from isl2903sensor*/
     buffer[1]          = current_light & 0x00FF;           /* Convert the 16 bit light value to unit8 array */
     buffer[0]          = current_light >>8;                
     
@@ -274,7 +274,7 @@ void do_humidity_measurement(uint8_t *buffer)
 {                                                          
     uint16_t htu_hum;                                      
     
-    htu_hum           = eDRV_HTU21_MeasureHumidity();      /* Read humidity from htu21d sensor*/
+    htu_hum           = wimoto_sensors_sample()->humidity; /* Humidity from htu21d sensor*/
     buffer[1]         = htu_hum & 0x00FF;                  /* Convert the 16 bit humidity variable to unit8 array*/
     buffer[0]         = htu_hum >>8;
 
@@ -298,7 +298,7 @@ static void advertising_init()
     ble_advdata_manuf_data_t   manuf_specific_data;
     uint8_t                    manuf_data_array[6];	
 
-    do_light_measurement(light_level);
+    (void)wimoto_sensors_acquire();                         /* Sample all the sensors at once */
 
     do_temperature_measurement(temperature);                /* Read temperature from htu21d sensor */
 
@@ -229,6 +229,64 @@ uint16_t HTU21D_PollMasterTransfer(uint8_t MeasurementType)
 
 }
 
+/**
+*@brief   Function to start a NO HOLD MASTER measurement without waiting for it
+*@details The bus is free during the conversion, the result is read with HTU21D_collect()
+*           after HTU21D_T_CONVERSION_MS or HTU21D_RH_CONVERSION_MS
+*/
+/*------------------------------------------------------------------------------------------*/
+bool HTU21D_trigger(etHTU21MeasureType eHTU21MeasureType)
+/*------------------------------------------------------------------------------------------*/
+{
+    uint8_t MeasurementType;
+
+    switch(eHTU21MeasureType)
+    {
+    case HUMIDITY: 	MeasurementType = TRIG_RH_MEASUREMENT_POLL;
+        break;
+
+    case TEMP    :  MeasurementType = TRIG_T_MEASUREMENT_POLL;
+        break;
+
+        default      :  return false;
+    }
+
+    return twi_master_transfer(HTU21D_ADDRESS ,&MeasurementType ,1 ,TWI_ISSUE_STOP);
+}
+
+/**
+*@brief   Function to read the measurement started by HTU21D_trigger
+*@details Function reads 16 bit data and 8 bit CRC, checks for CRC errors(if error checking is enabled)
+*           and returns the 16 bit value with the status bits cleared. 0 is returned if the conversion
+*           has not finished (the read is not acknowledged) or on CRC error
+*/
+/*------------------------------------------------------------------------------------------*/
+uint16_t HTU21D_collect(void)
+/*------------------------------------------------------------------------------------------*/
+{
+    uint8_t  data_buffer[3];
+    uint8_t  reg_val_array[2];
+    uint16_t Reg_value;
+
+    if (!twi_master_transfer(HTU21D_ADDRESS | TWI_READ_BIT ,data_buffer ,3 ,TWI_ISSUE_STOP))
+    {
+        return 0;
+    }
+    Reg_value        = ((data_buffer[0] << 8) | data_buffer[1]);    /* 16 bit reg value */
+    reg_val_array[1] = data_buffer[1];
+    reg_val_array[0] = data_buffer[0];
+
+    if (HTU21D_CRC_CHECK_ENABLE == FEATURE_ENABLED)                  /* If CRC checking is enabled check for CRC errors */
+    {
+        if(false == HTU21D_CheckCrc(reg_val_array ,2 ,data_buffer[2]))
+        {
+            return 0;                                                /* CRC error occurred */
+        }
+    }
+
+    return (Reg_value & ~0x0003);                                    /* Clearing status bits (0th and 1st bit of 16 bit data)*/
+}
+
 /**
 *@brief   Function to calculate Relative Humidity from the 16 bit data read (useful while debugging)
 */
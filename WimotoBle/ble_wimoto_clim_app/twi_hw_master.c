@@ -14,157 +14,161 @@
 #include <stdint.h>
 #include "nrf.h"
 #include "twi_master.h"
+#include "twi_hw_master.h"
 #include "twi_master_config.h"
 #include "nrf_delay.h"
 #include "nrf_gpio.h"
 #include "nrf_assert.h"
 #include "nrf_soc.h"
 #include "nrf_error.h"
-/* Max cycles approximately to wait on RXDREADY and TXDREADY event, this is optimum way instead of using timers, this is not power aware, negetive side is this is not power aware */
-#define MAX_TIMEOUT_LOOPS             (10000UL)        /*!< MAX while loops to wait for RXD/TXD event */
+#include "app_timer.h"
+#define TWI_IRQ_PRIORITY              NRF_APP_PRIORITY_LOW   /*!< TWI1 interrupt priority, low enough to call the SoftDevice from the handler */
+#define TWI_INT_MASK                  (TWI_INTENSET_STOPPED_Msk | TWI_INTENSET_RXDREADY_Msk | TWI_INTENSET_TXDSENT_Msk | TWI_INTENSET_ERROR_Msk)
+#define TWI_CHAIN_TIMEOUT_MS          50                     /*!< Time a transaction chain may take before it is given up */
+
+typedef void (*twi_master_evt_handler_t) (bool transfer_succeeded);
+
+static uint8_t *                   m_data;                   /**< Next byte to send or receive. */
+static uint8_t                     m_data_length;            /**< Bytes left in the current transfer. */
+static bool                        m_issue_stop_condition;   /**< Send a STOP once the last byte of a write is out. */
+static twi_master_evt_handler_t    m_evt_handler;            /**< Completion handler of the current transfer. */
+static volatile bool               m_busy = false;           /**< A transfer is in progress. */
+static twi_master_chain_t *         mp_queue_head = NULL;     /**< Chain being transferred, the queue runs from here. */
+static twi_master_chain_t *         mp_queue_tail = NULL;     /**< Last queued chain. */
+static uint8_t                      m_xfer_index;             /**< Transfer of the head chain in progress. */
+static bool                         m_queue_powered = false;  /**< TWI1 was powered up by the queue and is gated off when it drains. */
+static app_timer_id_t               m_timeout_timer;          /**< Gives up the chain being transferred if it doesn't complete. */
+static uint32_t                     m_timeout_ticks = 0;      /**< Chain timeout in RTC1 ticks, 0 until the timer is created. */
+static bool                         m_timeout_running = false;/**< The chain timeout timer is started. */
+
+/**@brief Function for recovering the peripheral as indicated by PAN 56: "TWI: TWI module lock-up." found at
+*        Product Anomaly Notification document found at
+*        https://www.nordicsemi.com/eng/Products/Bluetooth-R-low-energy/nRF51822/#Downloads
+*/
+static void twi_master_recover(void)
+{
+    NRF_TWI1->EVENTS_ERROR = 0;
+    NRF_TWI1->ENABLE       = TWI_ENABLE_ENABLE_Disabled << TWI_ENABLE_ENABLE_Pos;
+    NRF_TWI1->POWER        = 0;
+    nrf_delay_us(5);
+    NRF_TWI1->POWER        = 1;
+    NRF_TWI1->ENABLE       = TWI_ENABLE_ENABLE_Enabled << TWI_ENABLE_ENABLE_Pos;
+
+    (void)twi_master_init();
+}
 
-static bool twi_master_write(uint8_t *data, uint8_t data_length, bool issue_stop_condition)
+/**@brief Function for ending the current transfer and reporting it to its owner.
+*/
+static void twi_master_complete(bool transfer_succeeded)
 {
-    uint32_t timeout = MAX_TIMEOUT_LOOPS;   /* max loops to wait for EVENTS_TXDSENT event*/
+    twi_master_evt_handler_t evt_handler = m_evt_handler;
 
-    if (data_length == 0)
+    NRF_TWI1->INTENCLR = TWI_INT_MASK;
+    (void)sd_ppi_channel_enable_clr(PPI_CHEN_CH0_Msk);
+
+    m_evt_handler = NULL;
+    m_busy        = false;
+
+    if (evt_handler != NULL)
     {
-        /* gently return false for requesting data of size 0 */
-        return false;
+        evt_handler(transfer_succeeded);
     }
+}
 
-    NRF_TWI1->TXD = *data++;
-    NRF_TWI1->TASKS_STARTTX = 1;
+/**@brief TWI1 interrupt handler, moves the transfer on one byte per event.
+*/
+void SPI1_TWI1_IRQHandler(void)
+{
+    if (NRF_TWI1->EVENTS_ERROR != 0)
+    {
+        twi_master_recover();
+        twi_master_complete(false);
+        return;
+    }
 
-    while (true)
+    if (NRF_TWI1->EVENTS_TXDSENT != 0)
     {
-        while(NRF_TWI1->EVENTS_TXDSENT == 0 && NRF_TWI1->EVENTS_ERROR == 0 && (--timeout))
+        NRF_TWI1->EVENTS_TXDSENT = 0;
+        if (--m_data_length != 0)
         {
+            NRF_TWI1->TXD = *m_data++;
         }
-
-        if (timeout == 0 || NRF_TWI1->EVENTS_ERROR != 0)
+        else if (m_issue_stop_condition)
         {
-            // Recover the peripheral as indicated by PAN 56: "TWI: TWI module lock-up." found at
-            // Product Anomaly Notification document found at 
-            // https://www.nordicsemi.com/eng/Products/Bluetooth-R-low-energy/nRF51822/#Downloads
-            NRF_TWI1->EVENTS_ERROR = 0;
-            NRF_TWI1->ENABLE       = TWI_ENABLE_ENABLE_Disabled << TWI_ENABLE_ENABLE_Pos; 
-            NRF_TWI1->POWER        = 0;
-            nrf_delay_us(5);
-            NRF_TWI1->POWER        = 1;
-            NRF_TWI1->ENABLE       = TWI_ENABLE_ENABLE_Enabled << TWI_ENABLE_ENABLE_Pos;
+            /* the STOPPED event completes the transfer */
+            NRF_TWI1->TASKS_STOP = 1;
+        }
+        else
+        {
+            twi_master_complete(true);
+        }
+    }
 
-            (void)twi_master_init();
+    if (NRF_TWI1->EVENTS_RXDREADY != 0)
+    {
+        NRF_TWI1->EVENTS_RXDREADY = 0;
+        *m_data++ = NRF_TWI1->RXD;
 
-            return false;
+        /* configure PPI to stop TWI master before we get last BB event */
+        if (--m_data_length == 1)
+        {
+            (void)sd_ppi_channel_assign(0,
+            &(NRF_TWI1->EVENTS_BB),
+            &(NRF_TWI1->TASKS_STOP));
         }
 
-        NRF_TWI1->EVENTS_TXDSENT = 0;
-        if (--data_length == 0)
+        if (m_data_length != 0)
         {
-            break;
+            // Recover the peripheral as indicated by PAN 56: "TWI: TWI module lock-up." found at
+            // Product Anomaly Notification document found at
+            // https://www.nordicsemi.com/eng/Products/Bluetooth-R-low-energy/nRF51822/#Downloads
+            nrf_delay_us(20);
+            NRF_TWI1->TASKS_RESUME = 1;
         }
-
-        NRF_TWI1->TXD = *data++;
     }
 
-    if (issue_stop_condition) 
-    { 
-        NRF_TWI1->EVENTS_STOPPED = 0; 
-        NRF_TWI1->TASKS_STOP = 1; 
-        /* wait until stop sequence is sent and clear the EVENTS_STOPPED */ 
-        while(NRF_TWI1->EVENTS_STOPPED == 0) 
-        { 
-        } 
+    if (NRF_TWI1->EVENTS_STOPPED != 0)
+    {
+        NRF_TWI1->EVENTS_STOPPED = 0;
+        if (m_busy)
+        {
+            twi_master_complete(true);
+        }
     }
-
-    return true;
 }
 
-static bool twi_master_read(uint8_t *data, uint8_t data_length, bool issue_stop_condition)
+/**@brief Function for starting a transfer on a clear bus, the rest of it runs from the TWI1 interrupt.
+*/
+static void twi_master_start(uint8_t address, uint8_t *data, uint8_t data_length, bool issue_stop_condition, twi_master_evt_handler_t evt_handler)
 {
-    uint32_t timeout = MAX_TIMEOUT_LOOPS;   /* max loops to wait for RXDREADY event*/
-
-    if(data_length == 0)
-    {
-        /* gently return false for requesting data of size 0 */
-        return false;
-    }
+    m_data                 = data;
+    m_data_length          = data_length;
+    m_issue_stop_condition = issue_stop_condition;
+    m_evt_handler          = evt_handler;
+    m_busy                 = true;
 
+    NRF_TWI1->ADDRESS         = (address >> 1);
+    NRF_TWI1->EVENTS_RXDREADY = 0;
+    NRF_TWI1->EVENTS_TXDSENT  = 0;
+    NRF_TWI1->EVENTS_STOPPED  = 0;
+    NRF_TWI1->EVENTS_ERROR    = 0;
+    /* POWER off (twi_turn_OFF) resets INTEN, so arm it for every transfer */
+    NRF_TWI1->INTENSET        = TWI_INT_MASK;
 
-    if (data_length == 1)
+    if ((address & TWI_READ_BIT) != 0)
     {
-        //NRF_PPI->CH[0].TEP = (uint32_t)&NRF_TWI1->TASKS_STOP;
-
-        sd_ppi_channel_assign(0,
+        /* reads always end with a STOP, sent by PPI on the last BB event */
+        (void)sd_ppi_channel_assign(0,
         &(NRF_TWI1->EVENTS_BB),
-        &(NRF_TWI1->TASKS_STOP));
+        (data_length == 1) ? &(NRF_TWI1->TASKS_STOP) : &(NRF_TWI1->TASKS_SUSPEND));
+        (void)sd_ppi_channel_enable_set(PPI_CHEN_CH0_Msk);
+        NRF_TWI1->TASKS_STARTRX = 1;
     }
     else
     {
-        //NRF_PPI->CH[0].TEP = (uint32_t)&NRF_TWI1->TASKS_SUSPEND;
-        sd_ppi_channel_assign(0,
-        &(NRF_TWI1->EVENTS_BB),
-        &(NRF_TWI1->TASKS_SUSPEND));
-
+        NRF_TWI1->TXD = *m_data++;
+        NRF_TWI1->TASKS_STARTTX = 1;
     }
-    //NRF_PPI->CHENSET = PPI_CHENSET_CH0_Msk;
-    sd_ppi_channel_enable_set(PPI_CHEN_CH0_Msk);
-		//NRF_TWI1->EVENTS_RXDREADY = 0;
-    NRF_TWI1->TASKS_STARTRX = 1;
-    while(true)
-    {
-        while(NRF_TWI1->EVENTS_RXDREADY == 0 && NRF_TWI1->EVENTS_ERROR == 0 && (--timeout))
-        {  //nrf_app_event_wait();
-        }
-				NRF_TWI1->EVENTS_RXDREADY = 0;
-        if(timeout == 0 || NRF_TWI1->EVENTS_ERROR != 0)
-        {
-            // Recover the peripheral as indicated by PAN 56: "TWI: TWI module lock-up." found at
-            // Product Anomaly Notification document found at
-            // https://www.nordicsemi.com/eng/Products/Bluetooth-R-low-energy/nRF51822/#Downloads
-            NRF_TWI1->EVENTS_ERROR = 0;
-            NRF_TWI1->ENABLE       = TWI_ENABLE_ENABLE_Disabled << TWI_ENABLE_ENABLE_Pos;
-            NRF_TWI1->POWER        = 0;
-            nrf_delay_us(5);
-            NRF_TWI1->POWER        = 1;
-            NRF_TWI1->ENABLE       = TWI_ENABLE_ENABLE_Enabled << TWI_ENABLE_ENABLE_Pos;
-
-            (void)twi_master_init();
-
-            return false;
-        }
-
-        *data++ = NRF_TWI1->RXD;
-
-        /* configure PPI to stop TWI master before we get last BB event */
-        if (--data_length == 1)
-        {
-            //  NRF_PPI->CH[0].TEP = (uint32_t)&NRF_TWI1->TASKS_STOP;
-            sd_ppi_channel_assign(0,
-            &(NRF_TWI1->EVENTS_BB),
-            &(NRF_TWI1->TASKS_STOP));
-        }
-
-        if (data_length == 0)
-					break;
-				
-				// Recover the peripheral as indicated by PAN 56: "TWI: TWI module lock-up." found at
-        // Product Anomaly Notification document found at
-        // https://www.nordicsemi.com/eng/Products/Bluetooth-R-low-energy/nRF51822/#Downloads
-        nrf_delay_us(20);
-        NRF_TWI1->TASKS_RESUME = 1;
-    }
-
-    /* wait until stop sequence is sent and clear the EVENTS_STOPPED */
-    while(NRF_TWI1->EVENTS_STOPPED == 0)
-    {  //nrf_app_event_wait();
-    }
-    NRF_TWI1->EVENTS_STOPPED = 0;
-
-    //  NRF_PPI->CHENCLR = PPI_CHENCLR_CH0_Msk;
-    sd_ppi_channel_enable_clr(PPI_CHEN_CH0_Msk);
-    return true;
 }
 
 /**
@@ -280,28 +284,197 @@ NRF_PPI->CHENCLR = PPI_CHENCLR_CH0_Msk;*/
     err_code = sd_ppi_channel_enable_clr(PPI_CHEN_CH0_Msk);
     ASSERT(err_code == NRF_SUCCESS);
 
+    NRF_TWI1->INTENCLR = TWI_INT_MASK;
+    err_code = sd_nvic_SetPriority(SPI1_TWI1_IRQn, TWI_IRQ_PRIORITY);
+    ASSERT(err_code == NRF_SUCCESS);
+    err_code = sd_nvic_ClearPendingIRQ(SPI1_TWI1_IRQn);
+    ASSERT(err_code == NRF_SUCCESS);
+    err_code = sd_nvic_EnableIRQ(SPI1_TWI1_IRQn);
+    ASSERT(err_code == NRF_SUCCESS);
+
     NRF_TWI1->ENABLE = TWI_ENABLE_ENABLE_Enabled << TWI_ENABLE_ENABLE_Pos;
 
     return twi_master_clear_bus();
 }
 
-bool twi_master_transfer(uint8_t address, uint8_t *data, uint8_t data_length, bool issue_stop_condition)
+static void twi_master_queue_evt_handler(bool transfer_succeeded);
+
+/**@brief Function for moving the queue on once a transfer is done.
+*
+* @details Moves on to the next transfer of the head chain, or completes the chain and reports
+*          it to its owner. A chain stops at its first failed transfer.
+*/
+static void twi_master_queue_next(bool transfer_succeeded)
 {
-    bool transfer_succeeded = true;
-    if (data_length > 0 && twi_master_clear_bus())
+    twi_master_chain_t * p_chain = mp_queue_head;
+
+    if (transfer_succeeded && (++m_xfer_index < p_chain->xfer_count))
     {
-        NRF_TWI1->ADDRESS = (address >> 1);
+        return;
+    }
 
-        if ((address & TWI_READ_BIT) != 0)
+    if (m_timeout_running)
+    {
+        (void)app_timer_stop(m_timeout_timer);
+        m_timeout_running = false;
+    }
+
+    mp_queue_head      = p_chain->p_next;
+    m_xfer_index       = 0;
+    p_chain->succeeded = transfer_succeeded;
+    p_chain->queued    = false;
+    if (p_chain->handler != NULL)
+    {
+        p_chain->handler(p_chain, transfer_succeeded);
+    }
+}
+
+/**@brief Function for starting the next transfer of the queue, TWI1 is powered up for the first one.
+*
+* @details The queued chains run back-to-back. A transfer which can't start (stuck bus) fails its
+*          chain. Once the queue has drained TWI1 is gated off again, unless it was already powered
+*          when the queue started.
+*/
+static void twi_master_queue_run(void)
+{
+    while (mp_queue_head != NULL)
+    {
+        const twi_master_xfer_t * p_xfer = &mp_queue_head->p_xfers[m_xfer_index];
+
+        if (m_busy)                                     /* started by a chain handler queueing more work*/
         {
-            transfer_succeeded = twi_master_read(data, data_length, issue_stop_condition);
+            return;
         }
-        else
+        if (NRF_TWI1->POWER == 0)
+        {
+            NRF_TWI1->POWER = 1;
+            (void)twi_master_init();
+            m_queue_powered = true;
+        }
+
+        if (twi_master_clear_bus())
         {
-            transfer_succeeded = twi_master_write(data, data_length, issue_stop_condition);
+            if ((m_xfer_index == 0) && (m_timeout_ticks != 0))         /* first transfer of the chain*/
+            {
+                m_timeout_running = (app_timer_start(m_timeout_timer, m_timeout_ticks, mp_queue_head) == NRF_SUCCESS);
+            }
+            twi_master_start(p_xfer->address, p_xfer->p_data, p_xfer->data_length, p_xfer->issue_stop_condition, twi_master_queue_evt_handler);
+            return;
         }
+        twi_master_queue_next(false);
+    }
+
+    if (m_queue_powered)
+    {
+        NRF_TWI1->POWER = 0;
+        m_queue_powered = false;
+    }
+}
+
+/**@brief Chain timeout handler, gives up the transfer in progress as the ERROR event does.
+*
+* @details Runs at the priority of the TWI1 interrupt, so it can't preempt a completion. A
+*          timeout of a chain which has completed in the meantime is ignored.
+*
+* @param[in]   p_context        Chain the timer was started for.
+*/
+static void twi_master_timeout_handler(void * p_context)
+{
+    if (!m_timeout_running || (p_context != mp_queue_head))
+    {
+        return;
+    }
+    m_timeout_running = false;
+    if (m_busy)
+    {
+        twi_master_recover();
+        twi_master_complete(false);
+    }
+}
+
+/**@brief Completion handler of the queued transfers, called from the TWI1 interrupt.
+*/
+static void twi_master_queue_evt_handler(bool transfer_succeeded)
+{
+    twi_master_queue_next(transfer_succeeded);
+    twi_master_queue_run();
+}
+
+uint32_t twi_master_chain_enqueue(twi_master_chain_t * p_chain)
+{
+    uint8_t nested;
+    bool    idle;
+
+    if ((p_chain->xfer_count == 0) || p_chain->queued)
+    {
+        return NRF_ERROR_INVALID_PARAM;
+    }
+    p_chain->p_next    = NULL;
+    p_chain->queued    = true;
+    p_chain->succeeded = false;
+
+    (void)sd_nvic_critical_region_enter(&nested);
+    idle = (mp_queue_head == NULL);
+    if (idle)
+    {
+        mp_queue_head = p_chain;
+    }
+    else
+    {
+        mp_queue_tail->p_next = p_chain;
+    }
+    mp_queue_tail = p_chain;
+    (void)sd_nvic_critical_region_exit(nested);
+
+    if (idle)
+    {
+        twi_master_queue_run();
+    }
+    return NRF_SUCCESS;
+}
+
+uint32_t twi_master_timeout_init(uint32_t prescaler)
+{
+    uint32_t err_code;
+
+    err_code = app_timer_create(&m_timeout_timer, APP_TIMER_MODE_SINGLE_SHOT, twi_master_timeout_handler);
+    if (err_code == NRF_SUCCESS)
+    {
+        m_timeout_ticks = APP_TIMER_TICKS(TWI_CHAIN_TIMEOUT_MS, prescaler);
+    }
+    return err_code;
+}
+
+bool twi_master_chain_run(twi_master_chain_t * p_chain)
+{
+    if (twi_master_chain_enqueue(p_chain) != NRF_SUCCESS)
+    {
+        return false;
+    }
+
+    /* sleep until the TWI1 interrupt, or the chain timeout, has finished the chain */
+    while (p_chain->queued)
+    {
+        (void)sd_app_evt_wait();
+    }
+    return p_chain->succeeded;
+}
+
+bool twi_master_busy(void)
+{
+    return (mp_queue_head != NULL);
+}
+
+bool twi_master_transfer(uint8_t address, uint8_t *data, uint8_t data_length, bool issue_stop_condition)
+{
+    twi_master_xfer_t  xfer  = {address, data, data_length, issue_stop_condition};
+    twi_master_chain_t chain = {&xfer, 1, NULL};
+
+    if (data_length == 0)
+    {
+        return true;
     }
-    return transfer_succeeded;
+    return twi_master_chain_run(&chain);
 }
 
 /*lint --flb "Leave library region" */
@@ -40,11 +40,21 @@
 #define CLIMATE_PROFILE_DLOGS_DLOGS_EN_UUID               0x561B
 #define CLIMATE_PROFILE_DLOGS_DATA_UUID                   0x561C
 #define CLIMATE_PROFILE_DLOGS_READ_DATA_UUID              0x561D
+#define CLIMATE_PROFILE_DLOGS_CURSOR_UUID                 0x5621
+#define CLIMATE_PROFILE_DLOGS_QUERY_UUID                  0x5622
+#define CLIMATE_PROFILE_DLOGS_ROLLUP_UUID                 0x5623
+#define CLIMATE_PROFILE_DLOGS_DEADBAND_UUID               0x5624
+#define CLIMATE_PROFILE_DLOGS_INTERVAL_UUID               0x5625
+/*Data logger record schema: {record word, lowest bit, bit width, scale} of every logged channel*/
+#define CLIMATE_PROFILE_DLOGS_SCHEMA                      {{2, 16, 14, 2},  /* temperature, HTU21D status bits are not stored*/ \
+                                                           {2,  0, 16, 0},  /* light level*/                                    \
+                                                           {3, 16, 14, 2}}  /* humidity, HTU21D status bits are not stored*/
 /*custom UUID definitions for Device Management service.*/
 #define CLIMATE_PROFILE_DEVICE_SERVICE_UUID               0x561E
 #define CLIMATE_PROFILE_DEVICE_DFU_MODE_CHAR_UUID         0x561F
 #define CLIMATE_PROFILE_DEVICE_SWITCH_MODE_CHAR_UUID      0x5620
 #define CLIMATE_PROFILE_DEVICE_TIME_STAMP_CHAR_UUID       0x1805
+#define CLIMATE_PROFILE_DEVICE_FLASH_WEAR_CHAR_UUID       0x5626
 
 
 ////////////////////////////////////////////  GROW PROFILE CUSTOM UUID  ////////////////////////////////////////////
@@ -76,11 +86,21 @@
 #define GROW_PROFILE_DLOGS_DLOGS_EN_UUID                  0x4719
 #define GROW_PROFILE_DLOGS_DATA_UUID                      0x471A
 #define GROW_PROFILE_DLOGS_READ_DATA_UUID                 0x471B
+#define GROW_PROFILE_DLOGS_CURSOR_UUID                    0x471F
+#define GROW_PROFILE_DLOGS_QUERY_UUID                     0x4720
+#define GROW_PROFILE_DLOGS_ROLLUP_UUID                    0x4721
+#define GROW_PROFILE_DLOGS_DEADBAND_UUID                  0x4722
+#define GROW_PROFILE_DLOGS_INTERVAL_UUID                  0x4723
+/*Data logger record schema: {record word, lowest bit, bit width, scale} of every logged channel*/
+#define GROW_PROFILE_DLOGS_SCHEMA                         {{2, 16, 12, 0},  /* temperature, 12 bit TMP102 reading*/             \
+                                                           {2,  0, 16, 0},  /* light level*/                                    \
+                                                           {3, 16,  8, 0}}  /* soil moisture, 8 bit ADC reading*/
 /*custom UUID definitions for Device Management service.*/
 #define GROW_PROFILE_DEVICE_MGMT_SERVICE_UUID             0x471C
 #define GROW_PROFILE_DEVICE_DFU_MODE_CHAR_UUID            0x471D
 #define GROW_PROFILE_DEVICE_SWITCH_MODE_CHAR_UUID         0x471E
 #define GROW_PROFILE_DEVICE_TIME_STAMP_CHAR_UUID          0x1805
+#define GROW_PROFILE_DEVICE_FLASH_WEAR_CHAR_UUID          0x4724
 
 
 ////////////////////////////////////////////  SENTRY PROFILE CUSTOM UUID  ////////////////////////////////////////////
@@ -102,11 +122,22 @@
 #define SENTRY_PROFILE_DLOGS_DLOGS_EN_UUID                0xDC72
 #define SENTRY_PROFILE_DLOGS_DATA_UUID                    0xDC73
 #define SENTRY_PROFILE_DLOGS_READ_DATA_UUID               0xDC74                                                    
+#define SENTRY_PROFILE_DLOGS_CURSOR_UUID                  0xDC78
+#define SENTRY_PROFILE_DLOGS_QUERY_UUID                   0xDC79
+#define SENTRY_PROFILE_DLOGS_ROLLUP_UUID                  0xDC7A
+#define SENTRY_PROFILE_DLOGS_DEADBAND_UUID                0xDC7B
+#define SENTRY_PROFILE_DLOGS_INTERVAL_UUID                0xDC7C
+/*Data logger record schema: {record word, lowest bit, bit width, scale} of every logged channel*/
+#define SENTRY_PROFILE_DLOGS_SCHEMA                       {{2, 16,  7, 0},  /* X, 6 bit MMA7660 reading and alert flag*/         \
+                                                           {2,  8,  7, 0},  /* Y*/                                              \
+                                                           {2,  0,  7, 0},  /* Z*/                                              \
+                                                           {3, 16,  1, 0}}  /* PIR state*/
 /*custom UUID definitions for Device Management service.*/                                                       
 #define SENTRY_PROFILE_DEVICE_MGMT_SERVICE_UUID           0xDC75
 #define SENTRY_PROFILE_DEVICE_DFU_MODE_CHAR_UUID          0xDC76
 #define SENTRY_PROFILE_DEVICE_SWITCH_MODE_CHAR_UUID       0xDC77
 #define SENTRY_PROFILE_DEVICE_TIME_STAMP_CHAR_UUID        0x1805
+#define SENTRY_PROFILE_DEVICE_FLASH_WEAR_CHAR_UUID        0xDC7D
 
 
 ////////////////////////////////////////////  THERMO PROFILE CUSTOM UUID  ////////////////////////////////////////////
@@ -131,11 +162,20 @@
 #define THERMO_PROFILE_DLOGS_DLOGS_EN_UUID                0x8E5B       
 #define THERMO_PROFILE_DLOGS_DATA_UUID                    0x8E5C       
 #define THERMO_PROFILE_DLOGS_READ_DATA_UUID            	  0x8E5D       
+#define THERMO_PROFILE_DLOGS_CURSOR_UUID                  0x8E61
+#define THERMO_PROFILE_DLOGS_QUERY_UUID                   0x8E62
+#define THERMO_PROFILE_DLOGS_ROLLUP_UUID                  0x8E63
+#define THERMO_PROFILE_DLOGS_DEADBAND_UUID                0x8E64
+#define THERMO_PROFILE_DLOGS_INTERVAL_UUID                0x8E65
+/*Data logger record schema: {record word, lowest bit, bit width, scale} of every logged channel*/
+#define THERMO_PROFILE_DLOGS_SCHEMA                       {{2,  0, 16, 0},  /* thermopile temperature in 0.01 K*/               \
+                                                           {3, 16,  8, 0}}  /* probe temperature, 8 bit ADC reading*/
 /*custom UUID definitions for Device Management service.*/                                                              
 #define THERMO_PROFILE_DEVICE_SERVICE_UUID                0x8E5E         
 #define THERMO_PROFILE_DEVICE_DFU_MODE_CHAR_UUID          0x8E5F 
 #define THERMO_PROFILE_DEVICE_SWITCH_MODE_CHAR_UUID       0x8E60 
 #define THERMO_PROFILE_DEVICE_TIME_STAMP_CHAR_UUID        0x1805  
+#define THERMO_PROFILE_DEVICE_FLASH_WEAR_CHAR_UUID        0x8E66
 
 
 ////////////////////////////////////////////  WATER PROFILE CUSTOM UUID  ////////////////////////////////////////////
@@ -158,11 +198,19 @@
 #define WATER_PROFILE_DLOGS_DLOGS_EN_UUID                 0xC7E6
 #define WATER_PROFILE_DLOGS_DATA_UUID                     0xC7E7
 #define WATER_PROFILE_DLOGS_READ_DATA_UUID             	  0xC7E8
+#define WATER_PROFILE_DLOGS_CURSOR_UUID                   0xC7EC
+#define WATER_PROFILE_DLOGS_QUERY_UUID                    0xC7ED
+#define WATER_PROFILE_DLOGS_ROLLUP_UUID                   0xC7EE
+#define WATER_PROFILE_DLOGS_DEADBAND_UUID                 0xC7EF
+#define WATER_PROFILE_DLOGS_INTERVAL_UUID                 0xC7F0
+/*Data logger record schema: {record word, lowest bit, bit width, scale} of every logged channel*/
+#define WATER_PROFILE_DLOGS_SCHEMA                        {{2,  0,  1, 0}}  /* water presence*/
 /*custom UUID definitions for Device Management service.*/
 #define WATER_PROFILE_DEVICE_SERVICE_UUID                 0xC7E9
 #define WATER_PROFILE_DEVICE_DFU_MODE_CHAR_UUID           0xC7EA
 #define WATER_PROFILE_DEVICE_SWITCH_MODE_CHAR_UUID        0xC7EB
 #define WATER_PROFILE_DEVICE_TIME_STAMP_CHAR_UUID         0x1805
+#define WATER_PROFILE_DEVICE_FLASH_WEAR_CHAR_UUID         0xC7F1
 
 
 
@@ -267,10 +315,9 @@
 #define SOIL_MOIS_DEFAULT_LOW_VALUE               0x00        /**< Default value of soil moisture low value>*/
 #define SOIL_MOIS_DEFAULT_HIGH_VALUE              0xFF        /**< Default value of soil moisture low value>*/
   
-#define THERMOP_CHAR_SIZE                         0x05        /**< Thermopile temperature is 5 characters*/
-#define THERMOP_DEFAULT_LOW_VALUE                 0x30        /**< Default value of thermopile tempreature low value>*/
-#define THERMOP_DEFAULT_HIGH_VALUE                0x39        /**< Default value of thermopile tempreature low value>*/
-#define PERIOD                                    0x2E        /**< Hex value of Period (.)*/
+#define THERMOP_CHAR_SIZE                         0x02        /**< Thermopile temperature is a signed 16 bit value in 0.01 degC, MSB first*/
+#define THERMOP_DEFAULT_LOW_VALUE                 0           /**< Default value of thermopile tempreature low value, 0.00 degC>*/
+#define THERMOP_DEFAULT_HIGH_VALUE                9999        /**< Default value of thermopile tempreature high value, 99.99 degC>*/
 
 #define WATERL_LEVEL_DEFAULT_LOW_VALUE            0x00        /**< Default value of soil moisture low value>*/
 #define WATERL_LEVEL_DEFAULT_HIGH_VALUE           0xFF        /**< Default value of soil moisture low value>*/
@@ -279,7 +326,12 @@
 #define PROBE_TEMP_DEFAULT_HIGH_VALUE             0xFF        /**< Default value of soil moisture low value>*/
  
 #define DATA_LOGGER_BUFFER_START_PAGE             0xC0        /**< first flash page of the datalogger cyclic buffer*/
-#define DATA_LOGGER_BUFFER_END_PAGE               0xEC        /**< last flash page of the datalogger cyclic buffer*/
+#define DATA_LOGGER_BUFFER_END_PAGE               0xE0        /**< last flash page of the datalogger cyclic buffer*/
+#define DATA_LOGGER_HOURLY_START_PAGE             0xE1        /**< first flash page of the hourly rollup ring*/
+#define DATA_LOGGER_HOURLY_END_PAGE               0xE4        /**< last flash page of the hourly rollup ring*/
+#define DATA_LOGGER_DAILY_START_PAGE              0xE5        /**< first flash page of the daily rollup ring*/
+#define DATA_LOGGER_DAILY_END_PAGE                0xEC        /**< last flash page of the daily rollup ring*/
+#define DATA_LOGGER_DEFAULT_INTERVAL              15          /**< minutes between data logs until set by the central*/
 #define COMPANY_IDENTIFER                         0x1701      /**< comapany identifier*/               
 #define BATTERY_MEAS_INTERVAL                     0x0F        /**< interval for measuring the battery level*/
 
@@ -0,0 +1,66 @@
+/**
+*@file     This file contains the queue of the application events on the scheduler.
+*
+*@details  Every event type has a pending bit, an event is only put into the queue when its bit
+*          was clear. The bit is cleared before the event is dispatched, so the handler of an
+*          event can post it again.
+*/
+
+#include <stdbool.h>
+#include "wimoto_evt.h"
+#include "nordic_common.h"
+#include "app_error.h"
+#include "app_scheduler.h"
+#include "app_util_platform.h"
+
+#define SCHED_MAX_EVENT_DATA_SIZE   sizeof(wimoto_evt_t)    /**< Maximum size of scheduler events. */
+#define SCHED_QUEUE_SIZE            WIMOTO_EVT_COUNT        /**< Maximum number of events in the scheduler queue, one of each type. */
+
+static wimoto_evt_handler_t m_evt_handler;                  /**< Handler of the application events. */
+static uint32_t             m_evt_pending = 0;              /**< Bit mask of the events in the queue. */
+
+
+/**@brief Function for dispatching an event from the scheduler queue.
+*
+* @param[in]   p_event_data   Event.
+* @param[in]   event_size     Size of the event.
+*/
+static void evt_dispatch(void * p_event_data, uint16_t event_size)
+{
+    wimoto_evt_t evt = *(wimoto_evt_t *)p_event_data;
+
+    UNUSED_PARAMETER(event_size);
+
+    CRITICAL_REGION_ENTER();
+    m_evt_pending &= ~(1UL << evt);                         /* posted again from now on*/
+    CRITICAL_REGION_EXIT();
+
+    m_evt_handler(evt);
+}
+
+
+void wimoto_evt_init(wimoto_evt_handler_t evt_handler)
+{
+    m_evt_handler = evt_handler;
+    m_evt_pending = 0;
+
+    APP_SCHED_INIT(SCHED_MAX_EVENT_DATA_SIZE, SCHED_QUEUE_SIZE);
+}
+
+
+void wimoto_evt_post(wimoto_evt_t evt)
+{
+    uint32_t err_code;
+    bool     queued;
+
+    CRITICAL_REGION_ENTER();
+    queued         = ((m_evt_pending & (1UL << evt)) != 0);
+    m_evt_pending |= (1UL << evt);
+    CRITICAL_REGION_EXIT();
+
+    if (!queued)
+    {
+        err_code = app_sched_event_put(&evt, sizeof(evt), evt_dispatch);
+        APP_ERROR_CHECK(err_code);
+    }
+}
@@ -0,0 +1,42 @@
+/** @file
+ *
+ * @brief Queue of the outgoing notifications and indications.
+ *
+ * @details The services hand their notifications and indications to this queue instead of calling
+ *          sd_ble_gatts_hvx() directly. A notification that finds no free TX buffer waits for the
+ *          next TX complete event, and only one indication is outstanding at a time, the next one
+ *          is sent on the confirmation of the previous. The order in which the values were queued
+ *          is kept, so the alarm checks can run back to back without waiting for the radio.
+ */
+
+#ifndef WIMOTO_HVX_H__
+#define WIMOTO_HVX_H__
+
+#include <stdint.h>
+#include "ble.h"
+
+/**@brief Function for sending or queueing a notification or indication.
+ *
+ * @details The value is copied, the buffer of the caller can be reused on return. The value is
+ *          sent at once if nothing is queued ahead of it, otherwise from the TX complete or the
+ *          handle value confirmation event that frees the link. A queued value that cannot be
+ *          sent then, e.g. because the client disabled its CCCD meanwhile, is dropped.
+ *
+ * @param[in]   conn_handle    Connection handle.
+ * @param[in]   p_hvx_params   Notification or indication, the offset has to be 0 and p_data set.
+ *
+ * @return      NRF_SUCCESS if the value was sent or queued, BLE_ERROR_NO_TX_BUFFERS if the queue
+ *              is full, otherwise the error code of sd_ble_gatts_hvx().
+ */
+uint32_t wimoto_hvx_send(uint16_t conn_handle, const ble_gatts_hvx_params_t * p_hvx_params);
+
+/**@brief Function for handling the BLE events of the queue.
+ *
+ * @details Sends the queued values on the TX complete and handle value confirmation events and
+ *          empties the queue on disconnect.
+ *
+ * @param[in]   p_ble_evt      Event received from the BLE stack.
+ */
+void wimoto_hvx_on_ble_evt(ble_evt_t * p_ble_evt);
+
+#endif // WIMOTO_HVX_H__
@@ -0,0 +1,48 @@
+/**
+*@file     This file contains the two-phase acquisition of the climate sensors.
+*
+*@details  The conversions of all the sensors are started together and the results are read once
+*          the slowest one (ISL29023) has finished, so a cycle takes as long as that conversion
+*          instead of the sum of all of them. The HTU21D converts one quantity at a time, its
+*          humidity conversion starts as soon as the temperature has been read.
+*/
+
+
+#include "wimoto_sensors.h"
+#include "wimoto.h"
+
+static wimoto_sensors_sample_t m_sample;                     /**< Latest sample of the sensors */
+
+/**
+*@brief   Function to acquire a new sample of all the sensors
+*@details A sensor which fails to start or to return its result reads as 0, as with the one-time
+*           reads of the drivers
+*/
+const wimoto_sensors_sample_t * wimoto_sensors_acquire(void)
+{
+    bool als_started;
+    bool htu_started;
+
+    /* Trigger phase */
+    als_started = ISL29023_trigger_one_time_ALS();
+    htu_started = HTU21D_trigger(TEMP);
+
+    delay_ms(HTU21D_T_CONVERSION_MS);
+    m_sample.temperature = htu_started ? HTU21D_collect() : 0;
+    htu_started          = HTU21D_trigger(HUMIDITY);
+
+    /* Collect phase, the ALS conversion is the slowest one */
+    delay_ms(ISL29023_ALS_CONVERSION_MS - HTU21D_T_CONVERSION_MS);
+    m_sample.humidity    = htu_started ? HTU21D_collect() : 0;
+    m_sample.light_level = als_started ? ISL29023_collect_ALS() : 0;
+
+    return &m_sample;
+}
+
+/**
+*@brief   Function to get the latest sample of all the sensors, without a new acquisition
+*/
+const wimoto_sensors_sample_t * wimoto_sensors_sample(void)
+{
+    return &m_sample;
+}
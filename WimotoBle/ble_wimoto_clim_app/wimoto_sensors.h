@@ -20,7 +20,7 @@
 /********************************************************************************************/
 #include <stdbool.h>
 #include <stdint.h>
-#include "twi_master.h"
+#include "twi_hw_master.h"
 #include "nrf.h"
 #include "nrf_delay.h"
 #include "nrf_gpio.h"
@@ -101,8 +101,6 @@ bool      write_to_register            (uint8_t,uint8_t,uint8_t);  /**< Write da
 /**< Functions      */
 /*Public Functions  */
 bool      TMP006_enable_powerdown_mode(void);     /**< Enable power down mode */
-uint32_t  TMP006_get_onetime_data(void);          /**< Enable continuous conversion mode then read contents of V-object & T-ambient  
-                                                       registers one time and reconfigure TMP006 in power down mode */																									 
 float     TMP006_readDieTempC(void);              /**< Calculate sensor temperature based on raw reading */
 float     TMP006_ObjTempC_conversion(void);       /**< Calculate object temperature based on raw sensor temp and thermopile voltage */
 void      do_thermopile_measurement(uint8_t*, float*);
@@ -149,11 +147,14 @@ uint16_t  TMP006_read_register(uint8_t base_address);       /**< Read the data f
 #define ISL29023_USE_16K_LUX_FSR                0x02  /**< Configure FSR of LUX as 16000 */
 #define ISL29023_USE_4K_LUX_FSR                 0x01  /**< Configure FSR of LUX as 4000 */
 #define ISL29023_USE_1K_LUX_FSR                 0x00  /**< Configure FSR of LUX as 1000 */
+#define ISL29023_ALS_CONVERSION_MS              90    /**< Integration time required for 16bit conversion */
  
 /**< Functions   */
 /*Public Functions*/
 bool          ISL29023_config_FSR_and_powerdown(void); /**< Configure the FSR reading of ISL29023 and enable power down mode*/
 uint16_t      ISL29023_get_one_time_ALS(void);         /**< Get the content of data registers using ALS once mode*/
+bool          ISL29023_trigger_one_time_ALS(void);     /**< Start an ALS once conversion without waiting for it*/
+uint16_t      ISL29023_collect_ALS(void);              /**< Read the data registers after an ALS once conversion*/
 
 /*Private Functions */
 uint8_t       ISL29023_read_register(uint8_t);         /**< Read data of register of ISL29023 */
@@ -228,6 +229,8 @@ bool        MMA7660_write_to_reg(uint8_t base_Address,uint8_t data);  /**< Write
 #define HTU21D_CRC_CHECK_ENABLE                 0x00   /**< 0x00 - Disabled 0x01 - Enabled */
 #define USE_HOLD_MASTER_MODE_ENABLE             0x01   /**< use Hold master mode while reading, if set to 0x00 use No hold master mode*/
 #define FEATURE_ENABLED                         0x01   /**< Default value for enabled feature*/
+#define HTU21D_T_CONVERSION_MS                  7      /**< Max temperature conversion time at the 11 bit resolution set by HTU21D_configure() */
+#define HTU21D_RH_CONVERSION_MS                 8      /**< Max humidity conversion time at the 11 bit resolution set by HTU21D_configure() */
 
 /* sensor command  */
 typedef enum
@@ -279,6 +282,8 @@ uint16_t eDRV_HTU21_MeasureHumidity(void);                                    /*
 bool HTU21D_WriteToUserRegister(uint8_t data);                                /**< Function to write data to the User register */
 uint8_t  HTU21D_ReadUserRegister(void);                                       /**< Function to read data from the User register */
 void 		 HTU21D_configure(void);																							/**< Function to configure HTU21D register*/
+bool HTU21D_trigger(etHTU21MeasureType eHTU21MeasureType);                    /**< Function to start a NO HOLD MASTER measurement without waiting for it */
+uint16_t HTU21D_collect(void);                                                /**< Function to read the measurement started by HTU21D_trigger (16 bit value, status bit cleared) */
 /*Private Functions */
 bool HTU21D_CheckCrc(uint8_t data[], uint8_t nbrOfBytes, uint8_t checksum);   /**< CRC error checking*/
 uint16_t HTU21D_MeasureHM(etHTU21MeasureType eHTU21MeasureType);              /**< Function to read the temperature/humidity   using HOLD MASTER mode */                                                                                  
@@ -319,6 +324,28 @@ void    ppi_init(void);                                                  /**< In
 int     one_mhz_start(void);                                             /**< Start 1Mhz wave*/
 
 
+/*------------------------------------------------------------------------------------------*/
+/* ACQUISITION PIPELINE														  		    */
+/*------------------------------------------------------------------------------------------*/
+/**
+*@Brief   Two-phase acquisition of the HTU21D and ISL29023 sensors
+*@Featurs 1. Starts the conversions of all the sensors at once (trigger phase)
+*         2. Sleeps until the slowest conversion has finished and reads all the results (collect phase)
+*/
+
+/**< Types        */
+typedef struct
+{
+    uint16_t temperature;                                                /**< HTU21D temperature, status bits cleared */
+    uint16_t humidity;                                                   /**< HTU21D humidity, status bits cleared */
+    uint16_t light_level;                                                /**< ISL29023 data registers in ALS once mode */
+} wimoto_sensors_sample_t;
+
+/**< Functions   */
+const wimoto_sensors_sample_t * wimoto_sensors_acquire(void);            /**< Acquire a new sample of all the sensors */
+const wimoto_sensors_sample_t * wimoto_sensors_sample(void);             /**< Latest sample of all the sensors */
+
+
 /********************************************************************************************/ 
 /* MODULE END*/
 /********************************************************************************************/
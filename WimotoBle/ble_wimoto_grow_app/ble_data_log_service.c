@@ -12,20 +12,26 @@
 * Shafy            11/10/2014     Changes in handling flash completion event and in reset data log function
 */
 
+#include <stddef.h>
 #include <string.h>
 #include "nordic_common.h"
 #include "ble_srv_common.h"
 #include "app_util.h"
 #include "wimoto.h"
+#include "wimoto_evt.h"
+#include "wimoto_time.h"
+#include "wimoto_hvx.h"
 #include "nrf_soc.h"
 #include "ble.h"
 #include "ble_flash.h"
 #include "ble_data_log_service.h"
 #include "app_error.h"
+#include "app_util_platform.h"
+#include "nrf_assert.h"
+#include "crc16.h"
 
 extern bool         ENABLE_DATA_LOG;              /* Flag to enable data logger */
-extern bool					ENABLE_DLOG_TIMER;						/* Flag to start the data logger timer */
-extern bool         READ_DATA;                    /* flag to start reading data from flash*/
+extern volatile bool READ_DATA;                   /* flag to start reading data from flash*/
 extern bool         START_DATA_READ;              /* flag to start data logging*/
 extern bool         TX_COMPLETE;                  /* flag to indicate transmission complete*/
 
@@ -37,14 +43,172 @@ uint32_t            write_pg;                     /* flash page number to which
 static uint32_t *write_addr;                      /* write_address of the word to which data is being written*/
 static uint32_t pg_end;                           /* last page in the buffer*/ 
 
+#define DLOG_WRITE_QUEUE_SIZE   16                /* number of log records staged in RAM*/
+#define DLOG_BATCH_RECORDS      8                 /* number of records committed to flash in one write*/
+#define DLOG_RECORD_WORDS       4                 /* size of one uncompressed log record in words*/
+#define DLOG_CHANNELS           (sizeof(dlog_schema) / sizeof(dlog_schema[0]))    /* number of sensor channels in a log record*/
+#define DLOG_MAX_CODED_SIZE     (14 + (3 * DLOG_CHANNELS))                       /* largest size of a compressed record in bytes, an uncompressed one*/
+#define DLOG_WRITE_BUF_WORDS    (((DLOG_BATCH_RECORDS * DLOG_MAX_CODED_SIZE) + 3) / 4)   /* size of the flash write buffer in words*/
+#define DLOG_HEADER_WORDS       (sizeof(dlog_page_header_t) / sizeof(uint32_t))  /* size of the page header in words*/
+#define DLOG_PAGE_MAGIC         0x574C4F47        /* marks a page of the data log ("WLOG")*/
+#define DLOG_FORMAT_VERSION     4                 /* layout of a page, 3: delta compressed profile channels, 4: erase count in the header*/
+#define DLOG_ERASE_COUNT_VERSION 4                /* first layout with the erase count in the header*/
+#define DLOG_ERASED_WORD        0xFFFFFFFF        /* content of an erased flash word*/
+#define DLOG_PAGE_ADDR(pg)      ((uint32_t *)(pg_size * (pg)))                   /* address of the first word of a flash page*/
+#define DLOG_TIME_INVALID       0xFFFFFFFF        /* time stamp of a record without a valid date*/
+#define DLOG_MAX_TIME_DELTA     0x1FFFE           /* largest time difference in seconds of a compressed record*/
+#define DLOG_CODE_PAD           0x00              /* padding up to the next word*/
+#define DLOG_CODE_RAW           0x01              /* an uncompressed record follows*/
+#define DLOG_NOTIFY_MAX_LEN     20                /* payload of a notification with the default ATT MTU*/
+#define DLOG_QUERY_LEN          9                 /* size of the query characteristic: start and end time stamp, stride*/
+#define DLOG_READ_IMAGE         0x02              /* read data switch value downloading the log as stored in flash*/
+#define DLOG_ROLLUP_MAGIC       0x57535554        /* marks a page of a rollup ring ("WSUM")*/
+#define DLOG_ROLLUP_TIERS       2                 /* number of rollup rings: hourly, daily*/
+#define DLOG_ROLLUP_MAX_WORDS   ((6 + (6 * DLOG_CHANNELS) + 3) / 4)               /* largest size of a rollup record in words*/
+#define DLOG_DEADBAND_LEN       (1 + (2 * DLOG_CHANNELS))                         /* size of the deadband characteristic: heartbeat, channel deadbands*/
+#define DLOG_SECONDS_PER_HOUR   3600
+#define DLOG_INTERVAL_LEN       (2 + DLOG_CHANNELS)                               /* size of the interval characteristic: interval, channel decimation factors*/
+#define DLOG_FLASH_ENDURANCE    20000             /* erase cycles a flash page of the nRF51 is specified for*/
+#define DLOG_MINUTES_PER_DAY    1440
+
+static const ble_dlogs_channel_t dlog_schema[] = GROW_PROFILE_DLOGS_SCHEMA;    /* channels logged by the profile*/
+
+/**@brief States of the data logger flash writer. */
+typedef enum
+{
+    DLOG_FLASH_IDLE,                              /* no flash operation in progress*/
+    DLOG_FLASH_ERASE,                             /* page erase in progress*/
+    DLOG_FLASH_HEADER,                            /* page header write in progress*/
+    DLOG_FLASH_WRITE                              /* record write in progress*/
+} dlog_flash_state_t;
+
+/**@brief State of the record compression, the values of the previous record. */
+typedef struct
+{
+    uint32_t time;                                /* time stamp of the previous record, DLOG_TIME_INVALID if none*/
+    uint16_t value[DLOG_CHANNELS];                /* channel values of the previous record*/
+    uint16_t id;                                  /* log ID of the next record*/
+    uint16_t reserved;
+} dlog_codec_state_t;
+
+/**@brief Header written to the start of every page of the cyclic buffer after it is erased.
+*
+* @details The magic, the sequence number and the erase count keep their place in every layout
+*          from DLOG_ERASE_COUNT_VERSION on.
+*/
+typedef struct
+{
+    uint32_t           magic;                     /* DLOG_PAGE_MAGIC*/
+    uint32_t           seq;                       /* sequence number, incremented for every page taken into use*/
+    uint32_t           erase_count;               /* number of times the page has been erased*/
+    uint32_t           version;                   /* DLOG_FORMAT_VERSION*/
+    dlog_codec_state_t base;                      /* absolute time stamp and values the first record of the page is coded against*/
+    uint32_t           crc;                       /* crc16 of the fields above*/
+} dlog_page_header_t;
+
+/**@brief Position of the reader in the cyclic buffer. */
+typedef struct
+{
+    uint8_t           *pos;                       /* position of the next record*/
+    uint32_t           pg;                        /* page of the next record*/
+    dlog_codec_state_t state;                     /* compression state before the next record*/
+} dlog_read_cursor_t;
+
+/**@brief Header written to the start of every page of a rollup ring after it is erased. */
+typedef struct
+{
+    uint32_t magic;                               /* DLOG_ROLLUP_MAGIC*/
+    uint32_t seq;                                 /* sequence number, incremented for every page taken into use*/
+    uint32_t erase_count;                         /* number of times the page has been erased*/
+    uint32_t crc;                                 /* crc16 of the fields above*/
+} dlog_rollup_header_t;
+
+/**@brief Erase statistics of a flash region: the cyclic buffer or a rollup ring. */
+typedef struct
+{
+    uint32_t total;                               /* erases of all pages of the region*/
+    uint32_t hot_pg;                              /* page erased most often*/
+    uint32_t hot_count;                           /* erase count of hot_pg*/
+    uint32_t page_seconds;                        /* seconds a page of the region takes to fill, 0 if not known*/
+} dlog_wear_t;
+
+/**@brief Rollup of the logged records over a fixed period and the ring its records are kept in. */
+typedef struct
+{
+    uint32_t             start_pg;                /* first page of the ring*/
+    uint32_t             end_pg;                  /* last page of the ring*/
+    uint32_t             period;                  /* length of the period in seconds*/
+    uint32_t             write_pg;                /* page being written*/
+    uint32_t             offset;                  /* number of bytes written to the write page*/
+    uint32_t             erase_pg;                /* page being erased*/
+    uint32_t             seq;                     /* sequence number of the next page taken into use*/
+    dlog_rollup_header_t header;                  /* header of the write page*/
+    bool                 header_pending;          /* the header of the write page has not been written yet*/
+    dlog_wear_t          wear;                    /* erase statistics of the ring*/
+    uint32_t             period_start;            /* time stamp of the start of the period being rolled up*/
+    uint16_t             count;                   /* number of records in the period, 0 if none*/
+    uint16_t             min[DLOG_CHANNELS];      /* lowest channel values of the period*/
+    uint16_t             max[DLOG_CHANNELS];      /* highest channel values of the period*/
+    uint32_t             sum[DLOG_CHANNELS];      /* sum of the channel values of the period*/
+    bool                 pending;                 /* buf holds a record waiting to be written*/
+    uint32_t             buf[DLOG_ROLLUP_MAX_WORDS];                   /* packed record of the last completed period*/
+} dlog_rollup_t;
+
+static uint32_t write_queue[DLOG_WRITE_QUEUE_SIZE][DLOG_RECORD_WORDS];    /* write-back buffer of records waiting to be written to flash*/
+static volatile uint8_t queue_head  = 0;          /* index of the oldest record in the write queue*/
+static volatile uint8_t queue_count = 0;          /* number of records in the write queue*/
+static volatile dlog_flash_state_t flash_state = DLOG_FLASH_IDLE;        /* current flash operation of the writer*/
+static volatile bool flush_requested = false;     /* write the staged records without waiting for a full batch*/
+static volatile bool header_pending = false;      /* the header of the current write page has not been written yet*/
+static dlog_page_header_t page_header;            /* header of the current write page*/
+static uint32_t next_seq = 0;                     /* sequence number of the next page taken into use*/
+static uint32_t write_buf[DLOG_WRITE_BUF_WORDS];  /* compressed records of the flash write in progress*/
+static uint8_t write_count;                       /* number of records in the flash write in progress*/
+static uint8_t write_words;                       /* number of words in the flash write in progress*/
+static dlog_codec_state_t enc_state = {DLOG_TIME_INVALID, {0}, 0, 0xFFFF};   /* compression state after the last record in flash*/
+static dlog_codec_state_t write_state;            /* compression state after the flash write in progress*/
+static uint32_t erase_pg;                         /* flash page being erased*/
+static dlog_wear_t log_wear;                      /* erase statistics of the cyclic buffer*/
+static uint32_t pg_size;                          /* size of a page*/
+static uint32_t pg_offset = 0;                    /* number of bytes written to the current write page*/
+static bool first_write = true;                   /* flag indicates whether a write is done for the first time in the flash*/
+static uint8_t write_cycle = 0;                   /* set to 1 once the cyclic buffer has been written fully*/
+static uint8_t *read_pos = NULL;                  /* position of the next record to be read, NULL until reading starts*/
+static dlog_codec_state_t read_state;             /* compression state of the reader*/
+static volatile uint8_t tx_buffers_free = 0;      /* estimate of the free application TX buffers, also counts the buffers freed by other services, a failed send sets it right*/
+static volatile uint8_t tx_complete_seq = 0;      /* incremented on every TX complete event*/
+static dlog_read_cursor_t read_tail = {NULL};     /* position after the last record acknowledged by the central, a download starts here*/
+static volatile bool ack_pending = false;         /* the central has acknowledged records which are not behind the read tail yet*/
+static volatile uint16_t ack_id;                  /* log ID of the last acknowledged record*/
+static bool query_active = false;                 /* the download in progress is limited by a query*/
+static uint32_t query_start;                      /* time stamp of the first record of the query window, 0 if unlimited*/
+static uint32_t query_end;                        /* time stamp of the last record of the query window, 0 if unlimited*/
+static uint8_t query_stride;                      /* number of records of the window per record sent*/
+static volatile bool download_active = false;     /* a download is in progress, its snapshot is protected from the writer*/
+static uint8_t *read_head;                        /* end of the records of the download snapshot, the write pointer at its start*/
+static uint32_t read_head_pg;                     /* page of read_head*/
+static volatile uint32_t read_lock_pg;            /* oldest page the download may still read, the writer does not erase it*/
+static dlog_rollup_t rollup[DLOG_ROLLUP_TIERS] =  /* hourly and daily rollups*/
+{
+    {DATA_LOGGER_HOURLY_START_PAGE, DATA_LOGGER_HOURLY_END_PAGE, 3600},
+    {DATA_LOGGER_DAILY_START_PAGE,  DATA_LOGGER_DAILY_END_PAGE,  86400}
+};
+static volatile dlog_flash_state_t rollup_state = DLOG_FLASH_IDLE;      /* current flash operation of the rollup writer*/
+static dlog_rollup_t *rollup_op;                  /* rollup of the flash operation in progress*/
+static dlog_rollup_t *rollup_read = NULL;         /* rollup being downloaded, NULL for the logged records*/
+static bool image_read = false;                   /* the download sends the pages of the log as stored in flash*/
+static uint32_t rollup_size;                      /* size of a rollup record in bytes*/
+static uint32_t rollup_words;                     /* size of a rollup record in flash in words*/
+static uint8_t deadband_heartbeat = 0;            /* hours between records written in deadband mode, 0 if the mode is off*/
+static uint16_t deadband[DLOG_CHANNELS];          /* change of every channel which is written in deadband mode*/
+static dlog_codec_state_t deadband_ref = {DLOG_TIME_INVALID};                  /* time stamp and values of the last record written*/
+static uint8_t decimation[DLOG_CHANNELS];         /* every decimation-th logged record takes a new value of a channel, 0 or 1 for all*/
+static uint8_t decimation_count[DLOG_CHANNELS];   /* logged records since a channel took a new value*/
+
 bool   DLOGS_CONNECTED_STATE=false;               /* Indicates whether the data logger service is connected or not*/
 
 bool   done_read = false;                         /* flag to indicate whether data logger reading is over*/ 
-bool   flash_comp_evt = false;			              /*flag to indicate flash operation completion event*/
-extern ble_date_time_t m_time_stamp;              /* time stamp structure*/ 
 extern uint8_t	 var_receive_uuid;  							/*variable for receiving uuid*/
-extern uint32_t buf[4];														/*buffer for flash write operation*/
-static bool reread = false;												/*flag to indicate whether or not a data log has to be resent*/
 /**@brief Function for handling the Connect event.
 *
 * @param[in]   ble_dlogs     Data logger service structure.
@@ -66,6 +230,11 @@ static void on_disconnect(ble_dlogs_t * ble_dlogs, ble_evt_t * p_ble_evt)
     UNUSED_PARAMETER(p_ble_evt);
     DLOGS_CONNECTED_STATE= false; 
     ble_dlogs->conn_handle = BLE_CONN_HANDLE_INVALID;
+    (void)data_log_flush();                                         /* commit the staged log records to flash*/
+    if (download_active)
+    {
+        wimoto_evt_post(WIMOTO_EVT_DOWNLOAD);                       /* end the download*/
+    }
 }
 
 /**@brief Function for handling the write event.
@@ -82,7 +251,7 @@ static void write_evt_handler (ble_dlogs_t * ble_dlogs, ble_dlogs_write_evt_t *
         if(ble_dlogs->data_logger_enable != 0x00)				/*if the user has set the data logger enable characteristics set the flag to true*/
         {
             ENABLE_DATA_LOG =true;
-						ENABLE_DLOG_TIMER = true; 									/*Set flag to initiate the data log timer*/
+						wimoto_evt_post(WIMOTO_EVT_DLOG_TIMER_START); 									/*Start the data log timer*/
         }
         else
         {
@@ -94,12 +263,43 @@ static void write_evt_handler (ble_dlogs_t * ble_dlogs, ble_dlogs_write_evt_t *
         if(ble_dlogs->read_data_switch != 0x00)				  /*if the user has set the data logger enable characteristics set the flag to true*/
         {
             READ_DATA =true;
+            wimoto_evt_post(WIMOTO_EVT_READ_DATA);
         }
         else
         {
             READ_DATA = false;
         }
         break;   
+
+    case BLE_DLOGS_CURSOR_WRITE:
+        ack_id      = ble_dlogs->cursor;                /*the read tail is moved behind this record by the download*/
+        ack_pending = true;
+        break;
+
+    case BLE_DLOGS_QUERY_WRITE:                         /*the query is applied by the next download*/
+        break;
+
+    case BLE_DLOGS_ROLLUP_WRITE:
+        if(ble_dlogs->rollup != 0x00)                   /*if the user has selected a rollup ring, start downloading it*/
+        {
+            READ_DATA =true;
+            wimoto_evt_post(WIMOTO_EVT_READ_DATA);
+        }
+        break;
+
+    case BLE_DLOGS_DEADBAND_WRITE:                      /*applied from the next record logged*/
+        deadband_heartbeat = ble_dlogs->heartbeat;
+        memcpy(deadband, ble_dlogs->deadband, sizeof(deadband));
+        break;
+
+    case BLE_DLOGS_INTERVAL_WRITE:
+        memcpy(decimation, ble_dlogs->decimation, sizeof(decimation));
+        memset(decimation_count, 0, sizeof(decimation_count));  /*every channel takes a new value in the next record*/
+        if(ENABLE_DATA_LOG)
+        {
+            wimoto_evt_post(WIMOTO_EVT_DLOG_TIMER_START); /*Restart the data log timer with the new interval*/
+        }
+        break;
         
     default:
         break;
@@ -235,6 +435,122 @@ static void on_write(ble_dlogs_t * ble_dlogs, ble_evt_t * p_ble_evt)
         // call application event handler
         ble_dlogs->write_evt_handler(ble_dlogs, &evt);
     }		
+
+    /*Write event for data logger cursor char value*/
+
+    if (
+            (p_evt_write->handle == ble_dlogs->cursor_handles.value_handle)
+            &&
+            (p_evt_write->len == 2)
+            &&
+            (ble_dlogs->write_evt_handler != NULL)
+            )
+    {
+        ble_dlogs_write_evt_t evt;
+        evt.evt_type           = BLE_DLOGS_CURSOR_WRITE;
+
+        // update the service structure
+        ble_dlogs->cursor = ((uint16_t)p_evt_write->data[0] << 8) | p_evt_write->data[1];
+
+        // call application event handler
+        ble_dlogs->write_evt_handler(ble_dlogs, &evt);
+    }
+
+    /*Write event for data logger query char value*/
+
+    if (
+            (p_evt_write->handle == ble_dlogs->query_handles.value_handle)
+            &&
+            (p_evt_write->len == DLOG_QUERY_LEN)
+            &&
+            (ble_dlogs->write_evt_handler != NULL)
+            )
+    {
+        ble_dlogs_write_evt_t evt;
+        evt.evt_type           = BLE_DLOGS_QUERY_WRITE;
+
+        // update the service structure
+        ble_dlogs->query_start  = ((uint32_t)p_evt_write->data[0] << 24) | ((uint32_t)p_evt_write->data[1] << 16) |
+                                  ((uint32_t)p_evt_write->data[2] << 8)  | p_evt_write->data[3];
+        ble_dlogs->query_end    = ((uint32_t)p_evt_write->data[4] << 24) | ((uint32_t)p_evt_write->data[5] << 16) |
+                                  ((uint32_t)p_evt_write->data[6] << 8)  | p_evt_write->data[7];
+        ble_dlogs->query_stride = p_evt_write->data[8];
+
+        // call application event handler
+        ble_dlogs->write_evt_handler(ble_dlogs, &evt);
+    }
+
+    /*Write event for data logger rollup char value*/
+
+    if (
+            (p_evt_write->handle == ble_dlogs->rollup_handles.value_handle)
+            &&
+            (p_evt_write->len == 1)
+            &&
+            (ble_dlogs->write_evt_handler != NULL)
+            )
+    {
+        ble_dlogs_write_evt_t evt;
+        evt.evt_type           = BLE_DLOGS_ROLLUP_WRITE;
+
+        // update the service structure
+        ble_dlogs->rollup =   p_evt_write->data[0];
+
+        // call application event handler
+        ble_dlogs->write_evt_handler(ble_dlogs, &evt);
+    }
+
+    /*Write event for data logger deadband char value*/
+
+    if (
+            (p_evt_write->handle == ble_dlogs->deadband_handles.value_handle)
+            &&
+            (p_evt_write->len == DLOG_DEADBAND_LEN)
+            &&
+            (ble_dlogs->write_evt_handler != NULL)
+            )
+    {
+        ble_dlogs_write_evt_t evt;
+        uint32_t              i;
+        evt.evt_type           = BLE_DLOGS_DEADBAND_WRITE;
+
+        // update the service structure
+        ble_dlogs->heartbeat = p_evt_write->data[0];
+        for (i = 0; i < DLOG_CHANNELS; i++)
+        {
+            ble_dlogs->deadband[i] = ((uint16_t)p_evt_write->data[1 + (2 * i)] << 8) | p_evt_write->data[2 + (2 * i)];
+        }
+
+        // call application event handler
+        ble_dlogs->write_evt_handler(ble_dlogs, &evt);
+    }
+
+    /*Write event for data logger interval char value*/
+
+    if (
+            (p_evt_write->handle == ble_dlogs->interval_handles.value_handle)
+            &&
+            (p_evt_write->len == DLOG_INTERVAL_LEN)
+            &&
+            ((p_evt_write->data[0] | p_evt_write->data[1]) != 0)
+            &&
+            (ble_dlogs->write_evt_handler != NULL)
+            )
+    {
+        ble_dlogs_write_evt_t evt;
+        uint32_t              i;
+        evt.evt_type           = BLE_DLOGS_INTERVAL_WRITE;
+
+        // update the service structure
+        ble_dlogs->interval = ((uint16_t)p_evt_write->data[0] << 8) | p_evt_write->data[1];
+        for (i = 0; i < DLOG_CHANNELS; i++)
+        {
+            ble_dlogs->decimation[i] = p_evt_write->data[2 + i];
+        }
+
+        // call application event handler
+        ble_dlogs->write_evt_handler(ble_dlogs, &evt);
+    }
 }
 
 void ble_dlogs_on_ble_evt(ble_dlogs_t * ble_dlogs, ble_evt_t * p_ble_evt)
@@ -252,6 +568,15 @@ void ble_dlogs_on_ble_evt(ble_dlogs_t * ble_dlogs, ble_evt_t * p_ble_evt)
     case BLE_GATTS_EVT_WRITE:
         on_write(ble_dlogs, p_ble_evt);
         break;
+
+    case BLE_EVT_TX_COMPLETE:
+        tx_buffers_free += p_ble_evt->evt.common_evt.params.tx_complete.count;
+        tx_complete_seq++;
+        if (download_active)
+        {
+            wimoto_evt_post(WIMOTO_EVT_DOWNLOAD);                   /* send the next notifications*/
+        }
+        break;
         
     default:
         break;
@@ -344,7 +669,7 @@ static uint32_t data_char_add(ble_dlogs_t * ble_dlogs, const ble_dlogs_init_t *
     ble_gatts_attr_t    attr_char_value;
     ble_uuid_t          ble_uuid;
     ble_gatts_attr_md_t attr_md;
-    static uint8_t      data[16]={0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00};
+    static uint8_t      data[DLOG_NOTIFY_MAX_LEN];
 
     if (ble_dlogs->is_notification_supported)
     {
@@ -375,13 +700,13 @@ static uint32_t data_char_add(ble_dlogs_t * ble_dlogs, const ble_dlogs_init_t *
     attr_md.vloc       = BLE_GATTS_VLOC_USER;
     attr_md.rd_auth    = 0;
     attr_md.wr_auth    = 0;
-    attr_md.vlen       = 0;
+    attr_md.vlen       = 1;
 
     memset(&attr_char_value, 0, sizeof(attr_char_value));
 
     attr_char_value.p_uuid       = &ble_uuid;
     attr_char_value.p_attr_md    = &attr_md;
-    attr_char_value.init_len     = sizeof(data);
+    attr_char_value.init_len     = 0;
     attr_char_value.init_offs    = 0;
     attr_char_value.max_len      = sizeof(data);
     attr_char_value.p_value      = data;
@@ -399,6 +724,11 @@ static uint32_t data_char_add(ble_dlogs_t * ble_dlogs, const ble_dlogs_init_t *
 
 /**@brief Function for adding the read data switch characteristics.
 *
+* @details Writing 1 downloads the logged records through the data characteristic. Writing 2
+*          downloads the pages of the log as stored in flash, starting with the page of the last
+*          acknowledged record: every page is sent from its header to the end of its compressed
+*          records, see dlog_flash_packet_get(). The query does not apply.
+*
 * @param[in]   ble_dlogs        Data logger service structure.
 * @param[in]   ble_dlogs_init   Information needed to initialize the service.
 *
@@ -470,339 +800,2336 @@ static uint32_t read_data_switch_char_add(ble_dlogs_t * ble_dlogs, const ble_dlo
     return NRF_SUCCESS;
 }
 
-/**@brief Function for initializing the data logger service.
+/**@brief Function for adding the download cursor characteristic.
+*
+* @details The central writes the log ID of the last record it has received (2 bytes, most
+*          significant byte first) to acknowledge the records up to it.
 *
 * @param[in]   ble_dlogs        Data logger service structure.
 * @param[in]   ble_dlogs_init   Information needed to initialize the service.
 *
 * @return      NRF_SUCCESS on success, otherwise an error code.
 */
-
-uint32_t ble_dlogs_init(ble_dlogs_t * ble_dlogs, const ble_dlogs_init_t * ble_dlogs_init)
+static uint32_t cursor_char_add(ble_dlogs_t * ble_dlogs, const ble_dlogs_init_t * ble_dlogs_init)
 {
-    uint32_t   err_code;
-    ble_uuid_t ble_uuid;
+    uint32_t            err_code;
+    ble_gatts_char_md_t char_md;
+    ble_gatts_attr_t    attr_char_value;
+    ble_uuid_t          ble_uuid;
+    ble_gatts_attr_md_t attr_md;
+    static uint8_t      cursor[2] = {0x00, 0x00};
 
-    // Add service
-    ble_uuid.type = var_receive_uuid ;
-		ble_dlogs->uuid_type= var_receive_uuid;
-    ble_uuid.uuid = GROW_PROFILE_DLOGS_SERVICE_UUID;
+    memset(&char_md, 0, sizeof(char_md));
 
-    // Initialize service structure
-    ble_dlogs->evt_handler               = ble_dlogs_init->evt_handler;
-    ble_dlogs->write_evt_handler         = write_evt_handler;
-    ble_dlogs->conn_handle               = BLE_CONN_HANDLE_INVALID;
-    ble_dlogs->is_notification_supported = ble_dlogs_init->support_notification;
-    ble_dlogs->data_logger_enable        = ble_dlogs_init->data_logger_enable;
-    ble_dlogs->read_data_switch  	       = ble_dlogs_init->read_data_switch;  
+    char_md.char_props.read          = 1;
+    char_md.char_props.write         = 1;
+    char_md.char_props.write_wo_resp = 1;
+    char_md.p_char_pf                = NULL;
+    char_md.p_user_desc_md           = NULL;
+    char_md.p_cccd_md                = NULL;
+    char_md.p_sccd_md                = NULL;
 
-    err_code = sd_ble_gatts_service_add(BLE_GATTS_SRVC_TYPE_PRIMARY, &ble_uuid, &ble_dlogs->service_handle);
-    if (err_code != NRF_SUCCESS)
-    {
-        return err_code;
-    }
+    // Adding custom UUID
+    ble_uuid.type = ble_dlogs->uuid_type;
+    ble_uuid.uuid = GROW_PROFILE_DLOGS_CURSOR_UUID;
 
-    err_code =  data_logger_enable_char_add(ble_dlogs, ble_dlogs_init); /* Add data logger enable characteristic*/
-    if (err_code != NRF_SUCCESS)
-    {
-        return err_code;
-    }
-    
-    err_code =  data_char_add(ble_dlogs, ble_dlogs_init);               /* Add data characteristic*/
-    if (err_code != NRF_SUCCESS)
-    {
-        return err_code;
-    }
-    
-    err_code =  read_data_switch_char_add(ble_dlogs, ble_dlogs_init);  /* Add read data characteristics for downloading data*/
+    memset(&attr_md, 0, sizeof(attr_md));
+
+    attr_md.read_perm  = ble_dlogs_init->dlogs_char_attr_md.read_perm;
+    attr_md.write_perm = ble_dlogs_init->dlogs_char_attr_md.write_perm;
+    attr_md.vloc       = BLE_GATTS_VLOC_USER;
+    attr_md.rd_auth    = 0;
+    attr_md.wr_auth    = 0;
+    attr_md.vlen       = 0;
+
+    memset(&attr_char_value, 0, sizeof(attr_char_value));
+
+    attr_char_value.p_uuid       = &ble_uuid;
+    attr_char_value.p_attr_md    = &attr_md;
+    attr_char_value.init_len     = sizeof(cursor);
+    attr_char_value.init_offs    = 0;
+    attr_char_value.max_len      = sizeof(cursor);
+    attr_char_value.p_value      = cursor;
+
+    err_code = sd_ble_gatts_characteristic_add(ble_dlogs->service_handle, &char_md,
+    &attr_char_value,
+    &ble_dlogs->cursor_handles);
     if (err_code != NRF_SUCCESS)
     {
         return err_code;
     }
-    
+
     return NRF_SUCCESS;
-    
 }
 
-/**@brief Function write sensor data to flash.
+/**@brief Function for adding the download query characteristic.
 *
-* @param[in]   data             Data buffer.
-* 
-*/
-void write_data_flash(uint32_t *data)
-{		
-		static uint32_t i=0;
-    static uint32_t pg_size;         												 /*size of a page*/
-    static bool first_write=true;    												 /*flag indicates whether a write is done for the first time in the flash*/
-    static unsigned char write_cycle=0;
-		buf[0]=*data;
-		buf[1]=*(data+1);
-		buf[2]=*(data+2);
-		buf[3]=*(data+3);
-		if(first_write)                                         /* for the first write cycle set the start address and erase the page*/
-    {
-        pg_size   = NRF_FICR->CODEPAGESIZE;
-        write_pg  = DATA_LOGGER_BUFFER_START_PAGE;          /* th e first page to be written for logging data*/
-        pg_end  	= DATA_LOGGER_BUFFER_END_PAGE;						/* the last page for writing data*/
-        read_pg 	= DATA_LOGGER_BUFFER_START_PAGE; 
-        write_addr = (uint32_t *)(pg_size * write_pg);
-				
-				flash_comp_evt = false;
-				sd_flash_page_erase(write_pg);
-				
-				while(flash_comp_evt!=true)	                       /*wait for the completeion of flash erase*/
-				{
-							sd_app_evt_wait();
-				}
-        first_write = false;
-    }
-    
-    if(write_pg <= pg_end)								
-    {		
-        
-        if(i < pg_size)                                    /* stay in same page if the page size(1024 bytes) is not exceeded*/
-        {		
-						flash_comp_evt = false;
-						sd_flash_write(write_addr,buf,4);      /* write four words*/
-						while(flash_comp_evt!=true)
-						{
-								sd_app_evt_wait();
-						}
-						i += 16;                                       /* for each block write 16 bytes are written to flash*/
-						write_addr+=4;                                 /* increment the address by four words*/
-				}
-        else if((++write_pg) <= pg_end)                    /* increment the page number when the current page size is exceeded*/
-        {
-						flash_comp_evt = false;
-            sd_flash_page_erase(write_pg);         /* Erase the page before writing*/
-						while(flash_comp_evt!=true)	                  /*wait for the completeion of flash erase*/
-						{
-								sd_app_evt_wait();
-								
-						}
-            write_addr = (uint32_t *)(pg_size * write_pg);
-						flash_comp_evt = false;
-            sd_flash_write(write_addr,buf,4);
-						while(flash_comp_evt != true)
-						{
-								sd_app_evt_wait();
-							
-						}
-						i = 16;															
-						write_addr+=4;
-            if((write_cycle!=0x00) & (write_pg != pg_end))  /* If cyclic buffer has been written fully atleast once and the last page is not reached, the page to be read next is next page after the current write page */
-            {
-                read_pg = write_pg + 1;
-            }
-            else                                           /* If write is still in cycle 0, the read page the buffer start page*/
-            {
-                read_pg = DATA_LOGGER_BUFFER_START_PAGE;
-            }
-        }
-        
-    }
-    if(write_pg > pg_end)
-    {
-        write_pg  = DATA_LOGGER_BUFFER_START_PAGE;        /* when the last page is reached, go back to the first page*/
-        read_pg = write_pg + 1;
-				flash_comp_evt = false;
-        sd_flash_page_erase(write_pg);
-				while(flash_comp_evt!=true)
-				{
-						sd_app_evt_wait();
-				}
-				
-        write_addr = (uint32_t *)(pg_size * write_pg);
-				flash_comp_evt = false;
-        sd_flash_write(write_addr,buf,4);
-				while(flash_comp_evt != true)
-				{
-						sd_app_evt_wait();
-				}
-				i = 16;															
-				write_addr+=4;      
-				write_cycle=0x01;                               /* if write operation reached the end of the buffer, change the cycle to 1*/
-         
-    }	
-}
-
-/**@brief Function to send data to the connected BLE central device.
+* @details The central writes the time window of the next download: the time stamps of the first
+*          and of the last record (4 bytes each, seconds since 1 January 2000, most significant
+*          byte first, 0 for no limit), followed by the stride (1 byte, every stride-th record of
+*          the window is sent). All zero downloads the whole log.
 *
 * @param[in]   ble_dlogs        Data logger service structure.
-* 
+* @param[in]   ble_dlogs_init   Information needed to initialize the service.
+*
+* @return      NRF_SUCCESS on success, otherwise an error code.
 */
-void send_data(ble_dlogs_t * ble_dlogs)
+static uint32_t query_char_add(ble_dlogs_t * ble_dlogs, const ble_dlogs_init_t * ble_dlogs_init)
 {
-    uint32_t err_code;
-    static send_state state=READ; 
-    bool exit_loop=false;
-    uint32_t data[4]={0x00,0x00,0x00,0x00};                             /* array to read data from the flash*/
+    uint32_t            err_code;
+    ble_gatts_char_md_t char_md;
+    ble_gatts_attr_t    attr_char_value;
+    ble_uuid_t          ble_uuid;
+    ble_gatts_attr_md_t attr_md;
+    static uint8_t      query[DLOG_QUERY_LEN];
 
+    memset(&char_md, 0, sizeof(char_md));
 
-    while(true)
-    {
-        switch(state)
-        {
-        case READ:
-            read_data_flash(ble_dlogs,data);														/* read data from the flash*/
-            if(done_read)                                               /* If all the data has been read set the next state to read complete*/
-            {
-                state=READ_COMPLETE;
-								break;
-            }
-						
-						err_code=send_data_to_central(ble_dlogs,data);              /* trasmit data to the connected central device*/
-						
-            if(err_code == BLE_ERROR_NO_TX_BUFFERS)
-						{
-							reread = true;
-							state  = TXMIT;
-							break;
-						}else if (err_code != NRF_SUCCESS)
-						{
-							APP_ERROR_HANDLER(err_code);
-						}
-            
-            break;
+    char_md.char_props.read          = 1;
+    char_md.char_props.write         = 1;
+    char_md.char_props.write_wo_resp = 1;
+    char_md.p_char_pf                = NULL;
+    char_md.p_user_desc_md           = NULL;
+    char_md.p_cccd_md                = NULL;
+    char_md.p_sccd_md                = NULL;
 
-        case TXMIT: 																										/* Enter this case when TX Buffer has become full */	
-            
-            while(!TX_COMPLETE)                                        	/* Wait for TX complete event*/
-            {
-                uint32_t err_code = sd_app_evt_wait();
-                APP_ERROR_CHECK(err_code);
-            }
-            state=READ;                                                	/* Set next state to READ*/															
-            break;
+    // Adding custom UUID
+    ble_uuid.type = ble_dlogs->uuid_type;
+    ble_uuid.uuid = GROW_PROFILE_DLOGS_QUERY_UUID;
 
-        case READ_COMPLETE:                                            	/* If the read is completed, exit the loop*/			
-            
-            exit_loop=true;
-            state=READ;
-            break;
+    memset(&attr_md, 0, sizeof(attr_md));
 
-        default:
-            break;
-        }
+    attr_md.read_perm  = ble_dlogs_init->dlogs_char_attr_md.read_perm;
+    attr_md.write_perm = ble_dlogs_init->dlogs_char_attr_md.write_perm;
+    attr_md.vloc       = BLE_GATTS_VLOC_USER;
+    attr_md.rd_auth    = 0;
+    attr_md.wr_auth    = 0;
+    attr_md.vlen       = 0;
 
-        if(exit_loop)
-        {
-            break;
-        }
+    memset(&attr_char_value, 0, sizeof(attr_char_value));
+
+    attr_char_value.p_uuid       = &ble_uuid;
+    attr_char_value.p_attr_md    = &attr_md;
+    attr_char_value.init_len     = sizeof(query);
+    attr_char_value.init_offs    = 0;
+    attr_char_value.max_len      = sizeof(query);
+    attr_char_value.p_value      = query;
+
+    err_code = sd_ble_gatts_characteristic_add(ble_dlogs->service_handle, &char_md,
+    &attr_char_value,
+    &ble_dlogs->query_handles);
+    if (err_code != NRF_SUCCESS)
+    {
+        return err_code;
     }
+
+    return NRF_SUCCESS;
 }
 
-/**@brief Function readin data to flash and sending to the connected BLE central device.
+/**@brief Function for adding the rollup download characteristic.
+*
+* @details The central writes 1 to download the hourly and 2 to download the daily rollups
+*          through the data characteristic. Every rollup record holds the time stamp of the start
+*          of its period (4 bytes, seconds since 1 January 2000) and the number of logged records
+*          (2 bytes), most significant byte first, followed by the lowest, highest and mean value
+*          of every channel with the bits of the profile schema. The records are sent as stored
+*          in flash, each padded with zeros to a whole number of words, a record may span two
+*          notifications.
 *
 * @param[in]   ble_dlogs        Data logger service structure.
-* @param[in]   data             Data buffer.
+* @param[in]   ble_dlogs_init   Information needed to initialize the service.
 *
 * @return      NRF_SUCCESS on success, otherwise an error code.
 */
-
-uint32_t read_data_flash(ble_dlogs_t * ble_dlogs, uint32_t * data)
+static uint32_t rollup_char_add(ble_dlogs_t * ble_dlogs, const ble_dlogs_init_t * ble_dlogs_init)
 {
-    static uint32_t pg_size;
-    static uint32_t *read_addr;
-    static uint32_t *buffer_end_addr;
-		static uint32_t *prev_addr;
-		static uint32_t prev_read_page;
-    static bool first_read=true;
-    int i;
-    pg_size = NRF_FICR->CODEPAGESIZE;
-    buffer_end_addr = (uint32_t *)(pg_size * (pg_end + 1));
-	
-		if(reread == true)											/*Check if there was a TX FULL error and data needs to be resent*/																						
-		{
-			read_addr = prev_addr;								/*Roll back the read address and read page to what they were previously*/
-			read_pg = prev_read_page;
-			reread = false;
-		}
-		
-		prev_addr = read_addr;									/*Store current address and page for future use incase of TX full error*/
-		prev_read_page = read_pg;
-
-    if(first_read)
-    {																				/*in the first read operation, set the address to be read as the first word of read page set by the write routine. i.e the oldest data*/	
-        read_addr = (uint32_t *)(pg_size * read_pg);	
-        first_read=false;
-    }
-
-    if(read_pg <= write_pg)
-    {
-        if(read_addr < write_addr)					/*if read page is below write page, send data up-to the last written address*/
+    uint32_t            err_code;
+    ble_gatts_char_md_t char_md;
+    ble_gatts_attr_t    attr_char_value;
+    ble_uuid_t          ble_uuid;
+    ble_gatts_attr_md_t attr_md;
+    static uint8_t      rollup_tier = 0x00;
+
+    memset(&char_md, 0, sizeof(char_md));
+
+    char_md.char_props.read          = 1;
+    char_md.char_props.write         = 1;
+    char_md.char_props.write_wo_resp = 1;
+    char_md.p_char_pf                = NULL;
+    char_md.p_user_desc_md           = NULL;
+    char_md.p_cccd_md                = NULL;
+    char_md.p_sccd_md                = NULL;
+
+    // Adding custom UUID
+    ble_uuid.type = ble_dlogs->uuid_type;
+    ble_uuid.uuid = GROW_PROFILE_DLOGS_ROLLUP_UUID;
+
+    memset(&attr_md, 0, sizeof(attr_md));
+
+    attr_md.read_perm  = ble_dlogs_init->dlogs_char_attr_md.read_perm;
+    attr_md.write_perm = ble_dlogs_init->dlogs_char_attr_md.write_perm;
+    attr_md.vloc       = BLE_GATTS_VLOC_USER;
+    attr_md.rd_auth    = 0;
+    attr_md.wr_auth    = 0;
+    attr_md.vlen       = 0;
+
+    memset(&attr_char_value, 0, sizeof(attr_char_value));
+
+    attr_char_value.p_uuid       = &ble_uuid;
+    attr_char_value.p_attr_md    = &attr_md;
+    attr_char_value.init_len     = sizeof(rollup_tier);
+    attr_char_value.init_offs    = 0;
+    attr_char_value.max_len      = sizeof(rollup_tier);
+    attr_char_value.p_value      = &rollup_tier;
+
+    err_code = sd_ble_gatts_characteristic_add(ble_dlogs->service_handle, &char_md,
+    &attr_char_value,
+    &ble_dlogs->rollup_handles);
+    if (err_code != NRF_SUCCESS)
+    {
+        return err_code;
+    }
+
+    return NRF_SUCCESS;
+}
+
+/**@brief Function for adding the deadband characteristic.
+*
+* @details The central writes the heartbeat (1 byte, hours) followed by the deadband of every
+*          channel of the profile schema (2 bytes each, in the units of the channel in the log
+*          record, most significant byte first). With a heartbeat other than 0 a logged record is
+*          only written to flash when a channel has changed by more than its deadband since the
+*          last record written, or when the heartbeat has passed since then. A deadband of 0
+*          writes every change of the channel, 0xFFFF ignores the channel. The rollups still
+*          receive every logged record.
+*
+* @param[in]   ble_dlogs        Data logger service structure.
+* @param[in]   ble_dlogs_init   Information needed to initialize the service.
+*
+* @return      NRF_SUCCESS on success, otherwise an error code.
+*/
+static uint32_t deadband_char_add(ble_dlogs_t * ble_dlogs, const ble_dlogs_init_t * ble_dlogs_init)
+{
+    uint32_t            err_code;
+    ble_gatts_char_md_t char_md;
+    ble_gatts_attr_t    attr_char_value;
+    ble_uuid_t          ble_uuid;
+    ble_gatts_attr_md_t attr_md;
+    static uint8_t      deadband_cfg[DLOG_DEADBAND_LEN];
+
+    memset(&char_md, 0, sizeof(char_md));
+
+    char_md.char_props.read          = 1;
+    char_md.char_props.write         = 1;
+    char_md.char_props.write_wo_resp = 1;
+    char_md.p_char_pf                = NULL;
+    char_md.p_user_desc_md           = NULL;
+    char_md.p_cccd_md                = NULL;
+    char_md.p_sccd_md                = NULL;
+
+    // Adding custom UUID
+    ble_uuid.type = ble_dlogs->uuid_type;
+    ble_uuid.uuid = GROW_PROFILE_DLOGS_DEADBAND_UUID;
+
+    memset(&attr_md, 0, sizeof(attr_md));
+
+    attr_md.read_perm  = ble_dlogs_init->dlogs_char_attr_md.read_perm;
+    attr_md.write_perm = ble_dlogs_init->dlogs_char_attr_md.write_perm;
+    attr_md.vloc       = BLE_GATTS_VLOC_USER;
+    attr_md.rd_auth    = 0;
+    attr_md.wr_auth    = 0;
+    attr_md.vlen       = 0;
+
+    memset(&attr_char_value, 0, sizeof(attr_char_value));
+
+    attr_char_value.p_uuid       = &ble_uuid;
+    attr_char_value.p_attr_md    = &attr_md;
+    attr_char_value.init_len     = sizeof(deadband_cfg);
+    attr_char_value.init_offs    = 0;
+    attr_char_value.max_len      = sizeof(deadband_cfg);
+    attr_char_value.p_value      = deadband_cfg;
+
+    err_code = sd_ble_gatts_characteristic_add(ble_dlogs->service_handle, &char_md,
+    &attr_char_value,
+    &ble_dlogs->deadband_handles);
+    if (err_code != NRF_SUCCESS)
+    {
+        return err_code;
+    }
+
+    return NRF_SUCCESS;
+}
+
+/**@brief Function for adding the logging interval characteristic.
+*
+* @details The central writes the number of minutes between logged records (2 bytes, most
+*          significant byte first, 0 is ignored) followed by a decimation factor for every
+*          channel of the profile schema (1 byte each). A channel with the factor n takes a new
+*          value in every n-th logged record and keeps its last value in the others, which costs
+*          no space in the compressed log. The rollups still receive every measured value.
+*
+* @param[in]   ble_dlogs        Data logger service structure.
+* @param[in]   ble_dlogs_init   Information needed to initialize the service.
+*
+* @return      NRF_SUCCESS on success, otherwise an error code.
+*/
+static uint32_t interval_char_add(ble_dlogs_t * ble_dlogs, const ble_dlogs_init_t * ble_dlogs_init)
+{
+    uint32_t            err_code;
+    ble_gatts_char_md_t char_md;
+    ble_gatts_attr_t    attr_char_value;
+    ble_uuid_t          ble_uuid;
+    ble_gatts_attr_md_t attr_md;
+    static uint8_t      interval_cfg[DLOG_INTERVAL_LEN];
+
+    interval_cfg[0] = (uint8_t)(ble_dlogs->interval >> 8);
+    interval_cfg[1] = (uint8_t)ble_dlogs->interval;
+    memset(&interval_cfg[2], 1, DLOG_CHANNELS);
+
+    memset(&char_md, 0, sizeof(char_md));
+
+    char_md.char_props.read          = 1;
+    char_md.char_props.write         = 1;
+    char_md.char_props.write_wo_resp = 1;
+    char_md.p_char_pf                = NULL;
+    char_md.p_user_desc_md           = NULL;
+    char_md.p_cccd_md                = NULL;
+    char_md.p_sccd_md                = NULL;
+
+    // Adding custom UUID
+    ble_uuid.type = ble_dlogs->uuid_type;
+    ble_uuid.uuid = GROW_PROFILE_DLOGS_INTERVAL_UUID;
+
+    memset(&attr_md, 0, sizeof(attr_md));
+
+    attr_md.read_perm  = ble_dlogs_init->dlogs_char_attr_md.read_perm;
+    attr_md.write_perm = ble_dlogs_init->dlogs_char_attr_md.write_perm;
+    attr_md.vloc       = BLE_GATTS_VLOC_USER;
+    attr_md.rd_auth    = 0;
+    attr_md.wr_auth    = 0;
+    attr_md.vlen       = 0;
+
+    memset(&attr_char_value, 0, sizeof(attr_char_value));
+
+    attr_char_value.p_uuid       = &ble_uuid;
+    attr_char_value.p_attr_md    = &attr_md;
+    attr_char_value.init_len     = sizeof(interval_cfg);
+    attr_char_value.init_offs    = 0;
+    attr_char_value.max_len      = sizeof(interval_cfg);
+    attr_char_value.p_value      = interval_cfg;
+
+    err_code = sd_ble_gatts_characteristic_add(ble_dlogs->service_handle, &char_md,
+    &attr_char_value,
+    &ble_dlogs->interval_handles);
+    if (err_code != NRF_SUCCESS)
+    {
+        return err_code;
+    }
+
+    return NRF_SUCCESS;
+}
+
+/**@brief Function for initializing the data logger service.
+*
+* @param[in]   ble_dlogs        Data logger service structure.
+* @param[in]   ble_dlogs_init   Information needed to initialize the service.
+*
+* @return      NRF_SUCCESS on success, otherwise an error code.
+*/
+
+uint32_t ble_dlogs_init(ble_dlogs_t * ble_dlogs, const ble_dlogs_init_t * ble_dlogs_init)
+{
+    uint32_t   err_code;
+    ble_uuid_t ble_uuid;
+
+    // Add service
+    ble_uuid.type = var_receive_uuid ;
+		ble_dlogs->uuid_type= var_receive_uuid;
+    ble_uuid.uuid = GROW_PROFILE_DLOGS_SERVICE_UUID;
+
+    // Initialize service structure
+    ble_dlogs->evt_handler               = ble_dlogs_init->evt_handler;
+    ble_dlogs->write_evt_handler         = write_evt_handler;
+    ble_dlogs->conn_handle               = BLE_CONN_HANDLE_INVALID;
+    ble_dlogs->is_notification_supported = ble_dlogs_init->support_notification;
+    ble_dlogs->data_logger_enable        = ble_dlogs_init->data_logger_enable;
+    ble_dlogs->read_data_switch  	       = ble_dlogs_init->read_data_switch;  
+    ble_dlogs->cursor                    = 0;
+    ble_dlogs->query_start               = 0;
+    ble_dlogs->query_end                 = 0;
+    ble_dlogs->query_stride              = 0;
+    ble_dlogs->rollup                    = 0;
+    ble_dlogs->heartbeat                 = 0;
+    memset(ble_dlogs->deadband, 0, sizeof(ble_dlogs->deadband));
+    ble_dlogs->interval                  = ble_dlogs_init->log_interval;
+    memset(ble_dlogs->decimation, 1, sizeof(ble_dlogs->decimation));
+
+    err_code = sd_ble_gatts_service_add(BLE_GATTS_SRVC_TYPE_PRIMARY, &ble_uuid, &ble_dlogs->service_handle);
+    if (err_code != NRF_SUCCESS)
+    {
+        return err_code;
+    }
+
+    err_code =  data_logger_enable_char_add(ble_dlogs, ble_dlogs_init); /* Add data logger enable characteristic*/
+    if (err_code != NRF_SUCCESS)
+    {
+        return err_code;
+    }
+    
+    err_code =  data_char_add(ble_dlogs, ble_dlogs_init);               /* Add data characteristic*/
+    if (err_code != NRF_SUCCESS)
+    {
+        return err_code;
+    }
+    
+    err_code =  read_data_switch_char_add(ble_dlogs, ble_dlogs_init);  /* Add read data characteristics for downloading data*/
+    if (err_code != NRF_SUCCESS)
+    {
+        return err_code;
+    }
+
+    err_code =  cursor_char_add(ble_dlogs, ble_dlogs_init);            /* Add cursor characteristic for acknowledging downloaded data*/
+    if (err_code != NRF_SUCCESS)
+    {
+        return err_code;
+    }
+
+    err_code =  query_char_add(ble_dlogs, ble_dlogs_init);             /* Add query characteristic for downloading a time window*/
+    if (err_code != NRF_SUCCESS)
+    {
+        return err_code;
+    }
+
+    err_code =  rollup_char_add(ble_dlogs, ble_dlogs_init);            /* Add rollup characteristic for downloading the rollups*/
+    if (err_code != NRF_SUCCESS)
+    {
+        return err_code;
+    }
+
+    err_code =  deadband_char_add(ble_dlogs, ble_dlogs_init);          /* Add deadband characteristic for change triggered logging*/
+    if (err_code != NRF_SUCCESS)
+    {
+        return err_code;
+    }
+
+    err_code =  interval_char_add(ble_dlogs, ble_dlogs_init);          /* Add interval characteristic for the logging cadence*/
+    if (err_code != NRF_SUCCESS)
+    {
+        return err_code;
+    }
+    
+    return NRF_SUCCESS;
+    
+}
+
+/**@brief Function for getting the page following a page of the cyclic buffer.
+*
+* @param[in]   page             Flash page number.
+*
+* @return      Next flash page number, wrapping to the first page of the buffer.
+*/
+static uint32_t dlog_next_page(uint32_t page)
+{
+    return (page < pg_end) ? (page + 1) : DATA_LOGGER_BUFFER_START_PAGE;
+}
+
+/**@brief Function for getting the page holding the oldest logged data.
+*/
+static uint32_t dlog_oldest_page(void)
+{
+    if ((write_cycle != 0x00) && (write_pg != pg_end))                  /* If cyclic buffer has been written fully atleast once, the oldest data is in the page after the current write page */
+    {
+        return write_pg + 1;
+    }
+    return DATA_LOGGER_BUFFER_START_PAGE;                               /* If write is still in cycle 0, the oldest data is in the buffer start page*/
+}
+
+/**@brief Function for checking the header of a page of the cyclic buffer.
+*
+* @param[in]   page             Flash page number.
+* @param[out]  p_seq            Sequence number of the page, may be NULL.
+*
+* @return      true if the page has a valid header, false otherwise.
+*/
+static bool dlog_page_valid(uint32_t page, uint32_t * p_seq)
+{
+    const dlog_page_header_t * p_header = (const dlog_page_header_t *)DLOG_PAGE_ADDR(page);
+
+    if ((p_header->magic != DLOG_PAGE_MAGIC) || (p_header->version != DLOG_FORMAT_VERSION))
+    {
+        return false;
+    }
+    if (p_header->crc != crc16_compute((const uint8_t *)p_header, offsetof(dlog_page_header_t, crc), NULL))
+    {
+        return false;                                                   /* header write was interrupted*/
+    }
+    if (p_seq != NULL)
+    {
+        *p_seq = p_header->seq;
+    }
+    return true;
+}
+
+/**@brief Function for getting the erase count from the header of a page of the cyclic buffer.
+*
+* @details Unlike dlog_page_valid(), a header of another format version is accepted, so that
+*          the count survives a change of the layout.
+*
+* @param[in]   page             Flash page number.
+*
+* @return      Number of times the page has been erased, 0 if the header has no erase count.
+*/
+static uint32_t dlog_page_erase_count(uint32_t page)
+{
+    const dlog_page_header_t * p_header = (const dlog_page_header_t *)DLOG_PAGE_ADDR(page);
+
+    if ((p_header->magic != DLOG_PAGE_MAGIC) ||
+        (p_header->version < DLOG_ERASE_COUNT_VERSION) ||
+        (p_header->version > 0xFF))                                     /* an older layout has the base time stamp here*/
+    {
+        return 0;
+    }
+    if (p_header->erase_count == 0xFFFFFFFF)                            /* header write was interrupted*/
+    {
+        return 0;
+    }
+    return p_header->erase_count;
+}
+
+/**@brief Function for adding the erase count of a page to the statistics of its region.
+*
+* @param[in]   p_wear           Erase statistics of the region.
+* @param[in]   page             Flash page number.
+* @param[in]   erase_count      Number of times the page has been erased.
+* @param[in]   erases           Number of erases added to the total of the region.
+*/
+static void dlog_wear_add(dlog_wear_t * p_wear, uint32_t page, uint32_t erase_count, uint32_t erases)
+{
+    p_wear->total += erases;
+    if (erase_count > p_wear->hot_count)
+    {
+        p_wear->hot_pg    = page;
+        p_wear->hot_count = erase_count;
+    }
+}
+
+/**@brief Function for setting the time a page of the cyclic buffer takes to fill.
+*
+* @param[in]   start            Time stamp the page is coded against.
+* @param[in]   end              Time stamp the following page is coded against.
+*/
+static void dlog_wear_page_time(uint32_t start, uint32_t end)
+{
+    if ((start != DLOG_TIME_INVALID) && (end != DLOG_TIME_INVALID) && (end > start))
+    {
+        log_wear.page_seconds = end - start;
+    }
+}
+
+/**@brief Function for converting the date and time of a log record to a time stamp.
+*
+* @param[in]   record           Log record.
+*
+* @return      Seconds since 1 January WIMOTO_TIME_EPOCH_YEAR, DLOG_TIME_INVALID if the record has no valid date.
+*/
+static uint32_t dlog_time_get(const uint32_t * record)
+{
+    ble_date_time_t date_time;
+    uint32_t        time;
+
+    date_time.year    = (uint16_t)(record[0] >> 16);
+    date_time.month   = (uint8_t)(record[0] >> 8);
+    date_time.day     = (uint8_t)record[0];
+    date_time.hours   = (uint8_t)(record[1] >> 24);
+    date_time.minutes = (uint8_t)(record[1] >> 16);
+    date_time.seconds = (uint8_t)(record[1] >> 8);
+
+    if (wimoto_time_from_date_time(&date_time, &time) != NRF_SUCCESS)
+    {
+        return DLOG_TIME_INVALID;                                       /* time has not been set*/
+    }
+    return time;
+}
+
+/**@brief Function for converting a time stamp to the date and time of a log record.
+*
+* @details Sets the first word and the upper three bytes of the second word of the record.
+*
+* @param[in]   time             Seconds since 1 January WIMOTO_TIME_EPOCH_YEAR.
+* @param[out]  record           Log record.
+*/
+static void dlog_time_put(uint32_t time, uint32_t * record)
+{
+    ble_date_time_t date_time;
+
+    wimoto_time_to_date_time(time, &date_time);
+    record[0] = ((uint32_t)date_time.year << 16) | ((uint32_t)date_time.month << 8) | date_time.day;
+    record[1] = ((uint32_t)date_time.hours << 24) | ((uint32_t)date_time.minutes << 16) | ((uint32_t)date_time.seconds << 8);
+}
+
+/**@brief Function for getting the sensor channels of a log record.
+*
+* @details The channels are taken from the record as described by the profile schema.
+*
+* @param[in]   record           Log record.
+* @param[out]  value            Channel values.
+*/
+static void dlog_channels_get(const uint32_t * record, uint16_t * value)
+{
+    uint32_t i;
+
+    for (i = 0; i < DLOG_CHANNELS; i++)
+    {
+        value[i] = (uint16_t)((record[dlog_schema[i].word] >> (dlog_schema[i].pos + dlog_schema[i].scale)) &
+                              ((1UL << dlog_schema[i].bits) - 1));
+    }
+}
+
+/**@brief Function for setting the sensor channels of a log record.
+*
+* @param[in]   value            Channel values.
+* @param[out]  record           Log record, the channel bits must be cleared.
+*/
+static void dlog_channels_put(const uint16_t * value, uint32_t * record)
+{
+    uint32_t i;
+
+    for (i = 0; i < DLOG_CHANNELS; i++)
+    {
+        record[dlog_schema[i].word] |= (uint32_t)value[i] << (dlog_schema[i].pos + dlog_schema[i].scale);
+    }
+}
+
+/**@brief Function for writing a variable length integer, 7 bits per byte with the top bit set
+*         in all but the last byte.
+*
+* @return      Number of bytes written.
+*/
+static uint32_t dlog_varint_put(uint32_t value, uint8_t * p_out)
+{
+    uint32_t len = 0;
+
+    while (value >= 0x80)
+    {
+        p_out[len++] = (uint8_t)(value | 0x80);
+        value >>= 7;
+    }
+    p_out[len++] = (uint8_t)value;
+    return len;
+}
+
+/**@brief Function for reading a variable length integer.
+*
+* @return      true on success, false if the integer is not complete before p_end.
+*/
+static bool dlog_varint_get(const uint8_t ** pp_in, const uint8_t * p_end, uint32_t * p_value)
+{
+    const uint8_t * p_in  = *pp_in;
+    uint32_t        value = 0;
+    uint32_t        shift = 0;
+
+    do
+    {
+        if ((p_in >= p_end) || (shift > 14))
+        {
+            return false;
+        }
+        value |= (uint32_t)(*p_in & 0x7F) << shift;
+        shift += 7;
+    } while (*p_in++ & 0x80);
+
+    *p_value = value;
+    *pp_in   = p_in;
+    return true;
+}
+
+/**@brief Function for compressing a log record.
+*
+* @details The record is stored as a code holding the time difference to the previous record
+*          and a mask of the channels which have changed, followed by the differences of the
+*          changed channels, all as variable length integers. Channel differences are taken
+*          modulo the channel width and zigzag coded so that small negative steps stay short, a
+*          changed one bit channel needs no difference at all. The log ID is implied by the
+*          position in the log. A record which cannot be coded this way (time not set or running
+*          backwards, large gap, log ID out of sequence) is stored after a DLOG_CODE_RAW byte as
+*          its date, time, log ID and channel values. All integers are at most four bytes long
+*          and the last byte is below 0x80, so no form can produce an erased flash word.
+*
+* @param[in]     record         Log record.
+* @param[in,out] p_state        Compression state, updated to the record.
+* @param[out]    p_out          Buffer of at least DLOG_MAX_CODED_SIZE bytes.
+*
+* @return        Number of bytes written to p_out.
+*/
+static uint32_t dlog_encode(const uint32_t * record, dlog_codec_state_t * p_state, uint8_t * p_out)
+{
+    uint16_t value[DLOG_CHANNELS];
+    uint32_t time = dlog_time_get(record);
+    uint32_t mask = 0;
+    uint32_t len;
+    uint32_t i;
+    uint32_t bits;
+    int32_t  diff;
+
+    dlog_channels_get(record, value);
+
+    if ((time == DLOG_TIME_INVALID) || (p_state->time == DLOG_TIME_INVALID) || (time < p_state->time) ||
+        ((time - p_state->time) > DLOG_MAX_TIME_DELTA) || ((uint16_t)record[3] != p_state->id))
+    {
+        p_out[0] = DLOG_CODE_RAW;
+        len  = 1;
+        len += dlog_varint_put(record[0] >> 16, &p_out[len]);           /* year*/
+        len += dlog_varint_put(record[0] & 0xFFFF, &p_out[len]);        /* month and day*/
+        len += dlog_varint_put(record[1] >> 8, &p_out[len]);            /* hours, minutes and seconds*/
+        len += dlog_varint_put(record[3] & 0xFFFF, &p_out[len]);        /* log ID*/
+        for (i = 0; i < DLOG_CHANNELS; i++)
+        {
+            len += dlog_varint_put(value[i], &p_out[len]);
+        }
+    }
+    else
+    {
+        for (i = 0; i < DLOG_CHANNELS; i++)
+        {
+            if (value[i] != p_state->value[i])
+            {
+                mask |= (1 << i);
+            }
+        }
+        len = dlog_varint_put(((time - p_state->time + 1) << DLOG_CHANNELS) | mask, p_out);
+        for (i = 0; i < DLOG_CHANNELS; i++)
+        {
+            bits = dlog_schema[i].bits;
+            if ((mask & (1 << i)) && (bits > 1))
+            {
+                diff = (int32_t)((uint32_t)(value[i] - p_state->value[i]) << (32 - bits)) >> (32 - bits);
+                len += dlog_varint_put(((uint32_t)diff << 1) ^ (uint32_t)(diff >> 31), &p_out[len]);
+            }
+        }
+    }
+
+    p_state->time = time;
+    memcpy(p_state->value, value, sizeof(value));
+    p_state->id = (uint16_t)record[3] + 1;
+    return len;
+}
+
+/**@brief Function for decompressing a log record.
+*
+* @param[in,out] pp_in          Compressed record, advanced past it.
+* @param[in]     p_end          End of the compressed data.
+* @param[in,out] p_state        Compression state, updated to the record.
+* @param[out]    record         Log record.
+*
+* @return        true on success, false if the record is not complete before p_end.
+*/
+static bool dlog_decode(const uint8_t ** pp_in, const uint8_t * p_end, dlog_codec_state_t * p_state, uint32_t * record)
+{
+    const uint8_t * p_in = *pp_in;
+    uint32_t        field[4];
+    uint32_t        code;
+    uint32_t        diff;
+    uint32_t        bits;
+    uint32_t        i;
+
+    if (*p_in == DLOG_CODE_RAW)
+    {
+        p_in++;
+        for (i = 0; i < 4; i++)                                         /* year, month and day, time, log ID*/
+        {
+            if (!dlog_varint_get(&p_in, p_end, &field[i]))
+            {
+                return false;
+            }
+        }
+        for (i = 0; i < DLOG_CHANNELS; i++)
+        {
+            if (!dlog_varint_get(&p_in, p_end, &code))
+            {
+                return false;
+            }
+            p_state->value[i] = (uint16_t)code;
+        }
+        record[0] = (field[0] << 16) | (field[1] & 0xFFFF);
+        record[1] = field[2] << 8;
+        record[3] = field[3] & 0xFFFF;
+        p_state->time = dlog_time_get(record);
+    }
+    else
+    {
+        if (!dlog_varint_get(&p_in, p_end, &code))
+        {
+            return false;
+        }
+        p_state->time += (code >> DLOG_CHANNELS) - 1;
+        for (i = 0; i < DLOG_CHANNELS; i++)
+        {
+            if (code & (1 << i))
+            {
+                bits = dlog_schema[i].bits;
+                if (bits == 1)
+                {
+                    diff = 1;                                           /* a one bit channel can only toggle*/
+                }
+                else if (dlog_varint_get(&p_in, p_end, &diff))
+                {
+                    diff = (diff >> 1) ^ (0 - (diff & 1));
+                }
+                else
+                {
+                    return false;
+                }
+                p_state->value[i] = (uint16_t)((p_state->value[i] + diff) & ((1UL << bits) - 1));
+            }
+        }
+        dlog_time_put(p_state->time, record);
+        record[3] = p_state->id;
+    }
+    record[2] = 0;
+    dlog_channels_put(p_state->value, record);
+
+    p_state->id = (uint16_t)record[3] + 1;
+    *pp_in      = p_in;
+    return true;
+}
+
+/**@brief Function for compressing the staged records into the flash write buffer.
+*
+* @details Records are added while they fit into the rest of the current write page. The
+*          compressed data is padded with DLOG_CODE_PAD up to a whole word.
+*
+* @return      Number of records in the write buffer, 0 if the current page is full.
+*/
+static uint32_t dlog_encode_batch(void)
+{
+    uint8_t            coded[DLOG_MAX_CODED_SIZE];
+    uint8_t           *p_buf = (uint8_t *)write_buf;
+    uint32_t           room  = pg_size - pg_offset;
+    uint32_t           len   = 0;
+    uint32_t           count = 0;
+    uint32_t           size;
+    dlog_codec_state_t state = enc_state;
+
+    if (room > sizeof(write_buf))
+    {
+        room = sizeof(write_buf);
+    }
+    write_state = enc_state;
+    while ((count < queue_count) && (count < DLOG_BATCH_RECORDS))
+    {
+        size = dlog_encode(write_queue[(queue_head + count) % DLOG_WRITE_QUEUE_SIZE], &state, coded);
+        if ((len + size) > room)                                        /* stop at the end of the page*/
+        {
+            break;
+        }
+        memcpy(&p_buf[len], coded, size);
+        len        += size;
+        write_state = state;
+        count++;
+    }
+    while ((len % sizeof(uint32_t)) != 0)
+    {
+        p_buf[len++] = DLOG_CODE_PAD;
+    }
+    write_words = len / sizeof(uint32_t);
+    return count;
+}
+
+/**@brief Function for starting the next flash operation of the data logger.
+*
+* @details Writes the header of a freshly erased page, compresses the staged records and writes
+*          them in one block, or erases the next page of the cyclic buffer when the current page
+*          cannot take another record. Records are only written once a full batch of
+*          DLOG_BATCH_RECORDS is staged, unless a flush has been requested. Nothing is done while
+*          an operation is in progress. If the flash is busy with another module (e.g. pstorage)
+*          the operation is started again on the next flash event.
+*/
+static void dlog_flash_process(void)
+{
+    uint32_t err_code;
+
+    if (flash_state != DLOG_FLASH_IDLE)
+    {
+        return;
+    }
+
+    if (header_pending)
+    {
+        flash_state = DLOG_FLASH_HEADER;
+        err_code = sd_flash_write(DLOG_PAGE_ADDR(write_pg), (uint32_t *)&page_header, DLOG_HEADER_WORDS);
+    }
+    else
+    {
+        if (queue_count == 0)
+        {
+            return;
+        }
+        if ((queue_count < DLOG_BATCH_RECORDS) && !flush_requested)    /* wait for a full batch*/
+        {
+            return;
+        }
+
+        write_count = first_write ? 0 : dlog_encode_batch();
+        if (write_count == 0)                                           /* erase the next page before writing to it*/
+        {
+            if (first_write)
+            {
+                pg_size  = NRF_FICR->CODEPAGESIZE;
+                pg_end   = DATA_LOGGER_BUFFER_END_PAGE;                 /* the last page for writing data*/
+                erase_pg = DATA_LOGGER_BUFFER_START_PAGE;               /* the first page to be written for logging data*/
+            }
+            else
+            {
+                erase_pg = dlog_next_page(write_pg);                    /* when the last page is reached, go back to the first page*/
+                if (download_active && (erase_pg == read_lock_pg))      /* the download still reads the page, keep the records staged*/
+                {
+                    return;
+                }
+            }
+            page_header.erase_count = dlog_page_erase_count(erase_pg) + 1;   /* the erase count is carried over to the new header*/
+            flash_state = DLOG_FLASH_ERASE;
+            err_code = sd_flash_page_erase(erase_pg);
+        }
+        else
+        {
+            flash_state = DLOG_FLASH_WRITE;
+            err_code = sd_flash_write(write_addr, write_buf, write_words);
+        }
+    }
+
+    if (err_code == NRF_ERROR_BUSY)                                     /* flash is in use, retry on the next flash event*/
+    {
+        flash_state = DLOG_FLASH_IDLE;
+    }
+    else if (err_code != NRF_SUCCESS)
+    {
+        flash_state = DLOG_FLASH_IDLE;
+        APP_ERROR_HANDLER(err_code);
+    }
+}
+
+/**@brief Function for updating the write and read pointers after a flash operation has completed.
+*/
+static void dlog_flash_complete(void)
+{
+    if (flash_state == DLOG_FLASH_ERASE)
+    {
+        if (first_write)
+        {
+            first_write = false;
+        }
+        else if (erase_pg == DATA_LOGGER_BUFFER_START_PAGE)
+        {
+            write_cycle = 0x01;                                         /* if write operation reached the end of the buffer, change the cycle to 1*/
+        }
+        write_pg   = erase_pg;
+        write_addr = DLOG_PAGE_ADDR(write_pg);
+        pg_offset  = 0;
+
+        if (read_pos == NULL)                                           /* reading has not started, it starts with the oldest data*/
+        {
+            read_pg = dlog_oldest_page();
+        }
+        else if (read_pg == write_pg)                                   /* unread data has been overwritten, continue reading with the oldest page*/
+        {
+            read_pg   = dlog_next_page(write_pg);
+            read_pos  = (uint8_t *)DLOG_PAGE_ADDR(read_pg);
+        }
+        if ((read_tail.pos != NULL) && (read_tail.pg == write_pg))      /* unacknowledged data has been overwritten*/
+        {
+            read_tail.pg  = dlog_next_page(write_pg);
+            read_tail.pos = (uint8_t *)DLOG_PAGE_ADDR(read_tail.pg);
+        }
+
+        dlog_wear_page_time(page_header.base.time, enc_state.time);      /* the previous page is full*/
+        dlog_wear_add(&log_wear, write_pg, page_header.erase_count, 1);
+
+        page_header.magic   = DLOG_PAGE_MAGIC;
+        page_header.seq     = next_seq++;
+        page_header.version = DLOG_FORMAT_VERSION;
+        page_header.base    = enc_state;                                /* records of the page are coded against the last record before it*/
+        page_header.crc     = crc16_compute((const uint8_t *)&page_header, offsetof(dlog_page_header_t, crc), NULL);
+        header_pending      = true;
+    }
+    else if (flash_state == DLOG_FLASH_HEADER)
+    {
+        write_addr    += DLOG_HEADER_WORDS;
+        pg_offset      = sizeof(dlog_page_header_t);
+        header_pending = false;
+    }
+    else if (flash_state == DLOG_FLASH_WRITE)
+    {
+        write_addr  += write_words;
+        pg_offset   += write_words * sizeof(uint32_t);
+        enc_state    = write_state;
+        queue_head   = (queue_head + write_count) % DLOG_WRITE_QUEUE_SIZE;
+        queue_count -= write_count;
+        if (queue_count == 0)
+        {
+            flush_requested = false;                                    /* all staged records are in flash*/
+        }
+    }
+    flash_state = DLOG_FLASH_IDLE;
+}
+
+/**@brief Function for checking the header of a page of a rollup ring.
+*
+* @param[in]   page             Flash page number.
+* @param[out]  p_seq            Sequence number of the page.
+*
+* @return      true if the page has a valid header, false otherwise.
+*/
+static bool dlog_rollup_page_valid(uint32_t page, uint32_t * p_seq)
+{
+    const dlog_rollup_header_t * p_header = (const dlog_rollup_header_t *)DLOG_PAGE_ADDR(page);
+
+    if (p_header->magic != DLOG_ROLLUP_MAGIC)
+    {
+        return false;
+    }
+    if (p_header->crc != crc16_compute((const uint8_t *)p_header, offsetof(dlog_rollup_header_t, crc), NULL))
+    {
+        return false;
+    }
+    *p_seq = p_header->seq;
+    return true;
+}
+
+/**@brief Function for getting the page following a page of a rollup ring.
+*/
+static uint32_t dlog_rollup_next_page(const dlog_rollup_t * p_rollup, uint32_t page)
+{
+    return (page < p_rollup->end_pg) ? (page + 1) : p_rollup->start_pg;
+}
+
+/**@brief Function for packing the record of a completed rollup period.
+*
+* @details The time stamp of the start of the period (4 bytes) and the number of records (2 bytes)
+*          are followed by the lowest, highest and mean value of every channel of the profile
+*          schema, each with its stored number of bits, most significant bit first. The record is
+*          padded with zero bits to a whole word.
+*
+* @param[in]   p_rollup         Rollup of the completed period.
+* @param[out]  p_buf            Buffer of rollup_words words.
+*/
+static void dlog_rollup_pack(const dlog_rollup_t * p_rollup, uint8_t * p_buf)
+{
+    uint32_t value[3];
+    uint32_t acc   = 0;
+    uint32_t nbits = 0;
+    uint32_t len   = 0;
+    uint32_t i;
+    uint32_t j;
+
+    p_buf[len++] = (uint8_t)(p_rollup->period_start >> 24);
+    p_buf[len++] = (uint8_t)(p_rollup->period_start >> 16);
+    p_buf[len++] = (uint8_t)(p_rollup->period_start >> 8);
+    p_buf[len++] = (uint8_t)(p_rollup->period_start);
+    p_buf[len++] = (uint8_t)(p_rollup->count >> 8);
+    p_buf[len++] = (uint8_t)(p_rollup->count);
+
+    for (i = 0; i < DLOG_CHANNELS; i++)
+    {
+        value[0] = p_rollup->min[i];
+        value[1] = p_rollup->max[i];
+        value[2] = (p_rollup->sum[i] + (p_rollup->count / 2)) / p_rollup->count;   /* rounded mean*/
+        for (j = 0; j < 3; j++)
+        {
+            acc    = (acc << dlog_schema[i].bits) | value[j];
+            nbits += dlog_schema[i].bits;
+            while (nbits >= 8)
+            {
+                nbits -= 8;
+                p_buf[len++] = (uint8_t)(acc >> nbits);
+            }
+        }
+    }
+    if (nbits != 0)
+    {
+        p_buf[len++] = (uint8_t)(acc << (8 - nbits));
+    }
+    while (len < (rollup_words * sizeof(uint32_t)))
+    {
+        p_buf[len++] = 0;
+    }
+}
+
+/**@brief Function for adding a log record to the hourly and daily rollups.
+*
+* @details The channel values are accumulated for the period the time stamp of the record falls
+*          in. The first record of a new period completes the previous one, its record is packed
+*          and queued to be written to the ring. Records without a valid date are not rolled up.
+*          If the record of the previous period is still waiting for the flash, the completed
+*          period is dropped.
+*
+* @param[in]   data             Log record.
+*/
+static void dlog_rollup_add(const uint32_t * data)
+{
+    uint16_t        value[DLOG_CHANNELS];
+    uint32_t        time;
+    uint32_t        start;
+    dlog_rollup_t * p_rollup;
+    uint32_t        i;
+    uint32_t        j;
+
+    time = dlog_time_get(data);
+    if (time == DLOG_TIME_INVALID)
+    {
+        return;
+    }
+    dlog_channels_get(data, value);
+
+    for (i = 0; i < DLOG_ROLLUP_TIERS; i++)
+    {
+        p_rollup = &rollup[i];
+        start    = time - (time % p_rollup->period);
+
+        if ((p_rollup->count != 0) && (start != p_rollup->period_start))   /* the record starts a new period*/
+        {
+            if (!p_rollup->pending)
+            {
+                dlog_rollup_pack(p_rollup, (uint8_t *)p_rollup->buf);
+                p_rollup->pending = true;
+            }
+            p_rollup->count = 0;
+        }
+
+        if (p_rollup->count == 0)
+        {
+            p_rollup->period_start = start;
+            for (j = 0; j < DLOG_CHANNELS; j++)
+            {
+                p_rollup->min[j] = value[j];
+                p_rollup->max[j] = value[j];
+                p_rollup->sum[j] = 0;
+            }
+        }
+        for (j = 0; j < DLOG_CHANNELS; j++)
+        {
+            if (value[j] < p_rollup->min[j])
+            {
+                p_rollup->min[j] = value[j];
+            }
+            if (value[j] > p_rollup->max[j])
+            {
+                p_rollup->max[j] = value[j];
+            }
+            p_rollup->sum[j] += value[j];
+        }
+        if (p_rollup->count < 0xFFFF)
+        {
+            p_rollup->count++;
+        }
+    }
+}
+
+/**@brief Function for starting the next flash operation of the rollup writer.
+*
+* @details Writes the record of a completed period to its ring. The next page of the ring is
+*          erased and its header written when the record does not fit into the current page. A
+*          page the download of the ring still reads is not erased. Operations rejected because
+*          the flash is busy with the data logger or another module are started again on the next
+*          flash event.
+*/
+static void dlog_rollup_process(void)
+{
+    uint32_t        err_code;
+    dlog_rollup_t * p_rollup = NULL;
+    uint32_t        seq;
+    uint32_t        i;
+
+    if (rollup_state != DLOG_FLASH_IDLE)
+    {
+        return;
+    }
+    for (i = 0; i < DLOG_ROLLUP_TIERS; i++)
+    {
+        if (rollup[i].pending)
+        {
+            p_rollup = &rollup[i];
+            break;
+        }
+    }
+    if (p_rollup == NULL)
+    {
+        return;
+    }
+    rollup_op = p_rollup;
+
+    if (p_rollup->header_pending)
+    {
+        rollup_state = DLOG_FLASH_HEADER;
+        err_code = sd_flash_write(DLOG_PAGE_ADDR(p_rollup->write_pg), (uint32_t *)&p_rollup->header,
+                                  sizeof(dlog_rollup_header_t) / sizeof(uint32_t));
+    }
+    else if ((p_rollup->offset + (rollup_words * sizeof(uint32_t))) > pg_size)  /* erase the next page before writing to it*/
+    {
+        p_rollup->erase_pg = dlog_rollup_next_page(p_rollup, p_rollup->write_pg);
+        if (download_active && (rollup_read == p_rollup) && (p_rollup->erase_pg == read_lock_pg))
+        {
+            return;                                                     /* the download still reads the page*/
+        }
+        p_rollup->header.erase_count = dlog_rollup_page_valid(p_rollup->erase_pg, &seq) ?   /* the erase count is carried over to the new header*/
+                                       (((const dlog_rollup_header_t *)DLOG_PAGE_ADDR(p_rollup->erase_pg))->erase_count + 1) : 1;
+        rollup_state = DLOG_FLASH_ERASE;
+        err_code = sd_flash_page_erase(p_rollup->erase_pg);
+    }
+    else
+    {
+        rollup_state = DLOG_FLASH_WRITE;
+        err_code = sd_flash_write((uint32_t *)((uint8_t *)DLOG_PAGE_ADDR(p_rollup->write_pg) + p_rollup->offset),
+                                  p_rollup->buf, rollup_words);
+    }
+
+    if (err_code == NRF_ERROR_BUSY)                                     /* flash is in use, retry on the next flash event*/
+    {
+        rollup_state = DLOG_FLASH_IDLE;
+    }
+    else if (err_code != NRF_SUCCESS)
+    {
+        rollup_state = DLOG_FLASH_IDLE;
+        APP_ERROR_HANDLER(err_code);
+    }
+}
+
+/**@brief Function for updating the rollup ring after a flash operation has completed.
+*/
+static void dlog_rollup_complete(void)
+{
+    if (rollup_state == DLOG_FLASH_ERASE)
+    {
+        rollup_op->write_pg = rollup_op->erase_pg;
+        rollup_op->offset   = 0;
+        dlog_wear_add(&rollup_op->wear, rollup_op->write_pg, rollup_op->header.erase_count, 1);
+
+        rollup_op->header.magic   = DLOG_ROLLUP_MAGIC;
+        rollup_op->header.seq     = rollup_op->seq++;
+        rollup_op->header.crc     = crc16_compute((const uint8_t *)&rollup_op->header, offsetof(dlog_rollup_header_t, crc), NULL);
+        rollup_op->header_pending = true;
+    }
+    else if (rollup_state == DLOG_FLASH_HEADER)
+    {
+        rollup_op->offset         = sizeof(dlog_rollup_header_t);
+        rollup_op->header_pending = false;
+    }
+    else if (rollup_state == DLOG_FLASH_WRITE)
+    {
+        rollup_op->offset += rollup_words * sizeof(uint32_t);
+        rollup_op->pending = false;
+    }
+    rollup_state = DLOG_FLASH_IDLE;
+}
+
+/**@brief Function for restoring the rollup rings from flash after a reset.
+*
+* @details The page with the highest sequence number is the write page of a ring, its records
+*          end at the first erased word at a record boundary. A ring without a valid page starts
+*          with its first page. The periods being rolled up when the reset occurred are lost. The
+*          erase statistics of a ring are summed up from its page headers.
+*/
+static void dlog_rollup_init(void)
+{
+    uint32_t        bits = 0;
+    uint32_t        seq;
+    uint32_t        page;
+    uint32_t        count;
+    bool            found;
+    dlog_rollup_t * p_rollup;
+    uint32_t        i;
+
+    for (i = 0; i < DLOG_CHANNELS; i++)
+    {
+        bits += 3 * dlog_schema[i].bits;                                /* lowest, highest and mean value*/
+    }
+    rollup_size  = 6 + ((bits + 7) / 8);
+    rollup_words = (rollup_size + 3) / 4;
+
+    for (i = 0; i < DLOG_ROLLUP_TIERS; i++)
+    {
+        p_rollup = &rollup[i];
+        found    = false;
+        memset(&p_rollup->wear, 0, sizeof(p_rollup->wear));
+        p_rollup->wear.page_seconds = p_rollup->period *                /* a page takes a record per period*/
+                                      ((pg_size - sizeof(dlog_rollup_header_t)) / (rollup_words * sizeof(uint32_t)));
+        for (page = p_rollup->start_pg; page <= p_rollup->end_pg; page++)
+        {
+            if (!dlog_rollup_page_valid(page, &seq))
+            {
+                continue;
+            }
+            count = ((const dlog_rollup_header_t *)DLOG_PAGE_ADDR(page))->erase_count;
+            dlog_wear_add(&p_rollup->wear, page, count, count);
+            if (!found || ((int32_t)(seq - p_rollup->seq) >= 0))
+            {
+                p_rollup->write_pg = page;
+                p_rollup->seq      = seq;
+                found              = true;
+            }
+        }
+        p_rollup->count          = 0;
+        p_rollup->pending        = false;
+        p_rollup->header_pending = false;
+        if (!found)                                                     /* the first record erases the first page*/
+        {
+            p_rollup->write_pg = p_rollup->end_pg;
+            p_rollup->offset   = pg_size;
+            p_rollup->seq      = 0;
+            continue;
+        }
+
+        p_rollup->seq++;
+        p_rollup->offset = sizeof(dlog_rollup_header_t);
+        while (((p_rollup->offset + (rollup_words * sizeof(uint32_t))) <= pg_size) &&
+               (*(uint32_t *)((uint8_t *)DLOG_PAGE_ADDR(p_rollup->write_pg) + p_rollup->offset) != DLOG_ERASED_WORD))
+        {
+            p_rollup->offset += rollup_words * sizeof(uint32_t);
+        }
+    }
+}
+
+/**@brief Function for holding the channels of a logged record which are not due.
+*
+* @details A channel with the decimation factor n takes a new value in every n-th logged record,
+*          in the others it is set to its value in the last record written.
+*
+* @param[in,out] data           Log record.
+*/
+static void dlog_decimate(uint32_t * data)
+{
+    uint32_t i;
+    uint32_t shift;
+    uint32_t mask;
+
+    for (i = 0; i < DLOG_CHANNELS; i++)
+    {
+        if (decimation_count[i] != 0)
+        {
+            shift = dlog_schema[i].pos + dlog_schema[i].scale;
+            mask  = ((1UL << dlog_schema[i].bits) - 1) << shift;
+            data[dlog_schema[i].word] = (data[dlog_schema[i].word] & ~mask) | ((uint32_t)deadband_ref.value[i] << shift);
+        }
+        if (++decimation_count[i] >= decimation[i])
+        {
+            decimation_count[i] = 0;
+        }
+    }
+}
+
+/**@brief Function for checking whether a record is written in deadband mode.
+*
+* @details A record is written when a channel has changed by more than its deadband since the
+*          last record written, or when the heartbeat has passed. Records without a valid time
+*          stamp, or with one before the last record written, are always written. Channel
+*          differences are compared in the units of the log record.
+*
+* @param[in]   data             Log record.
+*
+* @return      true if the record has to be written, false if it is within the deadband.
+*/
+static bool dlog_deadband_due(const uint32_t * data)
+{
+    uint16_t value[DLOG_CHANNELS];
+    uint32_t time;
+    uint32_t diff;
+    uint32_t i;
+
+    if (deadband_heartbeat == 0)                                        /* deadband mode off*/
+    {
+        return true;
+    }
+
+    time = dlog_time_get(data);
+    if ((time == DLOG_TIME_INVALID) || (deadband_ref.time == DLOG_TIME_INVALID) || (time < deadband_ref.time) ||
+        ((time - deadband_ref.time) >= ((uint32_t)deadband_heartbeat * DLOG_SECONDS_PER_HOUR)))
+    {
+        return true;
+    }
+
+    dlog_channels_get(data, value);
+    for (i = 0; i < DLOG_CHANNELS; i++)
+    {
+        diff = (value[i] > deadband_ref.value[i]) ? (value[i] - deadband_ref.value[i]) : (deadband_ref.value[i] - value[i]);
+        if ((diff << dlog_schema[i].scale) > deadband[i])
+        {
+            return true;
+        }
+    }
+    return false;
+}
+
+/**@brief Function for queueing sensor data to be written to flash.
+*
+* @details The record is copied to the write-back buffer and the function returns immediately.
+*          Once a batch of records is staged, the page erase and write operations are carried out
+*          in the background, driven by the flash events received in data_log_sys_event_handler().
+*          The record is also added to the hourly and daily rollups. Channels which are not due
+*          by their decimation factor are then set to their last value written. In deadband mode,
+*          a record which differs too little from the last record written is only added to the
+*          rollups.
+*
+* @param[in,out] data           Data buffer.
+*
+* @return      NRF_SUCCESS on success, NRF_ERROR_NO_MEM if the write-back buffer is full,
+*              NRF_ERROR_INVALID_STATE if the record is within the deadband and not written.
+*/
+uint32_t write_data_flash(uint32_t *data)
+{
+    uint32_t err_code = NRF_SUCCESS;
+    uint8_t  tail;
+
+    CRITICAL_REGION_ENTER();
+    dlog_rollup_add(data);
+    dlog_rollup_process();                                              /* write the record of a completed period*/
+    dlog_decimate(data);
+    if (!dlog_deadband_due(data))
+    {
+        err_code = NRF_ERROR_INVALID_STATE;
+    }
+    else if (queue_count < DLOG_WRITE_QUEUE_SIZE)
+    {
+        tail = (queue_head + queue_count) % DLOG_WRITE_QUEUE_SIZE;
+        memcpy(write_queue[tail], data, sizeof(write_queue[tail]));
+        queue_count++;
+        deadband_ref.time = dlog_time_get(data);                        /* the deadband is measured from this record*/
+        dlog_channels_get(data, deadband_ref.value);
+        dlog_flash_process();                                           /* start writing if the flash writer is idle*/
+    }
+    else
+    {
+        err_code = NRF_ERROR_NO_MEM;
+    }
+    CRITICAL_REGION_EXIT();
+
+    return err_code;
+}
+
+/**@brief Function for writing all records staged in RAM to flash.
+*
+* @details Starts writing the staged records without waiting for a full batch. Call repeatedly
+*          until it returns true, e.g. before the flash is read or when the supply is about to fail.
+*
+* @return      true if all records are in flash and the writer is idle, false otherwise.
+*/
+bool data_log_flush(void)
+{
+    bool flushed;
+
+    CRITICAL_REGION_ENTER();
+    if (queue_count != 0)
+    {
+        flush_requested = true;
+        dlog_flash_process();
+    }
+    flushed = ((queue_count == 0) && !header_pending && (flash_state == DLOG_FLASH_IDLE));
+    CRITICAL_REGION_EXIT();
+
+    return flushed;
+}
+
+/**@brief Function for restoring the data logger pointers from flash after a reset.
+*
+* @details The newest page of the cyclic buffer is found with a binary search over the page
+*          sequence numbers: pages written in the current lap have a sequence number not lower
+*          than the first page of the buffer, older pages and pages without a valid header are
+*          behind them. The first erased word of the newest page is then found with a binary
+*          search; compressed records never form an erased word. The records of that page are
+*          decompressed to restore the compression state. Logging continues in that page without
+*          erasing any data. The erase statistics are summed up from the page headers.
+*
+* @param[out]  p_next_id        Log ID following the newest record in flash.
+*
+* @return      true if a logged record was found, false if the buffer is empty.
+*/
+bool data_log_init(uint16_t * p_next_id)
+{
+    uint32_t        first_seq;
+    uint32_t        seq;
+    uint32_t        low;
+    uint32_t        high;
+    uint32_t        mid;
+    uint32_t        page;
+    uint32_t        count;
+    uint32_t       *p_page;
+    const uint8_t  *p_data;
+    uint32_t        record[DLOG_RECORD_WORDS];
+    bool            found = false;
+
+    pg_size  = NRF_FICR->CODEPAGESIZE;
+    pg_end   = DATA_LOGGER_BUFFER_END_PAGE;
+    read_pos = NULL;
+    read_tail.pos = NULL;
+    dlog_rollup_init();
+
+    memset(&log_wear, 0, sizeof(log_wear));
+    for (page = DATA_LOGGER_BUFFER_START_PAGE; page <= pg_end; page++)
+    {
+        count = dlog_page_erase_count(page);                            /* also counted if the page is of an older format version*/
+        if (count != 0)
+        {
+            dlog_wear_add(&log_wear, page, count, count);
+        }
+    }
+
+    if (dlog_page_valid(DATA_LOGGER_BUFFER_START_PAGE, &first_seq))
+    {
+        low  = DATA_LOGGER_BUFFER_START_PAGE;
+        high = pg_end;
+        while (low < high)                                              /* find the last page written in the current lap*/
+        {
+            mid = (low + high + 1) / 2;
+            if (dlog_page_valid(mid, &seq) && ((int32_t)(seq - first_seq) >= 0))
+            {
+                low = mid;
+            }
+            else
+            {
+                high = mid - 1;
+            }
+        }
+        write_pg    = low;
+        write_cycle = ((write_pg != pg_end) && dlog_page_valid(pg_end, NULL)) ? 0x01 : 0x00;
+    }
+    else if (dlog_page_valid(pg_end, NULL))                             /* reset while the buffer wrapped to the first page*/
+    {
+        write_pg    = pg_end;
+        write_cycle = 0x00;
+    }
+    else                                                                /* nothing logged yet, the first write erases the first page*/
+    {
+        first_write = true;
+        read_pg     = DATA_LOGGER_BUFFER_START_PAGE;
+        return false;
+    }
+
+    (void)dlog_page_valid(write_pg, &seq);
+    next_seq    = seq + 1;
+    page_header = *(const dlog_page_header_t *)DLOG_PAGE_ADDR(write_pg);     /* header of the current write page*/
+
+    page = (write_pg > DATA_LOGGER_BUFFER_START_PAGE) ? (write_pg - 1) : pg_end;
+    if (dlog_page_valid(page, &first_seq) && (first_seq == (seq - 1)))   /* the page before it was filled in one go*/
+    {
+        dlog_wear_page_time(((const dlog_page_header_t *)DLOG_PAGE_ADDR(page))->base.time, page_header.base.time);
+    }
+
+    p_page = DLOG_PAGE_ADDR(write_pg);
+    low    = DLOG_HEADER_WORDS;
+    high   = pg_size / sizeof(uint32_t);
+    while (low < high)                                                  /* find the first erased word of the page*/
+    {
+        mid = (low + high) / 2;
+        if (p_page[mid] != DLOG_ERASED_WORD)
+        {
+            low = mid + 1;
+        }
+        else
+        {
+            high = mid;
+        }
+    }
+    write_addr  = p_page + low;
+    pg_offset   = low * sizeof(uint32_t);
+    first_write = false;
+    read_pg     = dlog_oldest_page();
+
+    enc_state = ((const dlog_page_header_t *)p_page)->base;
+    p_data    = (const uint8_t *)(p_page + DLOG_HEADER_WORDS);
+    while (p_data < (const uint8_t *)write_addr)                        /* replay the records of the page*/
+    {
+        if (*p_data == DLOG_CODE_PAD)
+        {
+            p_data++;
+        }
+        else if (dlog_decode(&p_data, (const uint8_t *)write_addr, &enc_state, record))
+        {
+            found = true;
+        }
+        else
+        {
+            break;                                                      /* last write was interrupted*/
+        }
+    }
+    deadband_ref = enc_state;                                           /* the deadband continues from the newest record*/
+
+    if (!found && (seq == 0))                                           /* only the header of the first page was written*/
+    {
+        return false;
+    }
+    *p_next_id = enc_state.id;
+    return true;
+}
+
+/**@brief Function for estimating the remaining lifetime of a flash region.
+*
+* @details Every page of a region is erased once per lap through it, a lap takes the number of
+*          pages times the time a page takes to fill.
+*
+* @param[in]   p_wear           Erase statistics of the region.
+* @param[in]   pages            Number of pages of the region.
+*
+* @return      Days until the page erased most often reaches DLOG_FLASH_ENDURANCE,
+*              BLE_DLOGS_WEAR_UNKNOWN if the time a page takes to fill is not known yet.
+*/
+static uint32_t dlog_wear_days(const dlog_wear_t * p_wear, uint32_t pages)
+{
+    uint32_t left;
+    uint32_t lap;
+
+    if (p_wear->page_seconds == 0)
+    {
+        return BLE_DLOGS_WEAR_UNKNOWN;
+    }
+    if (p_wear->hot_count >= DLOG_FLASH_ENDURANCE)
+    {
+        return 0;
+    }
+    left = DLOG_FLASH_ENDURANCE - p_wear->hot_count;
+    lap  = pages * (p_wear->page_seconds / 60);                         /* minutes*/
+    if (lap > (((BLE_DLOGS_WEAR_UNKNOWN - 1) * DLOG_MINUTES_PER_DAY) / left))
+    {
+        return BLE_DLOGS_WEAR_UNKNOWN - 1;                              /* more days than the characteristic can hold*/
+    }
+    return (left * lap) / DLOG_MINUTES_PER_DAY;
+}
+
+/**@brief Function for getting the flash wear statistics of the data logger.
+*
+* @details The cyclic buffer and the rollup rings are taken into account. The fill level is the
+*          part of the cyclic buffer up to the write pointer, 100 percent once it has wrapped.
+*
+* @param[out]  p_wear           Flash wear statistics.
+*/
+void data_log_wear_get(ble_dlogs_wear_t * p_wear)
+{
+    dlog_wear_t region[1 + DLOG_ROLLUP_TIERS];
+    uint32_t    pages[1 + DLOG_ROLLUP_TIERS];
+    uint32_t    used;
+    uint32_t    days;
+    uint32_t    i;
+
+    pages[0] = DATA_LOGGER_BUFFER_END_PAGE - DATA_LOGGER_BUFFER_START_PAGE + 1;
+    for (i = 0; i < DLOG_ROLLUP_TIERS; i++)
+    {
+        pages[1 + i] = rollup[i].end_pg - rollup[i].start_pg + 1;
+    }
+
+    CRITICAL_REGION_ENTER();                                            /* the statistics change on flash events*/
+    region[0] = log_wear;
+    for (i = 0; i < DLOG_ROLLUP_TIERS; i++)
+    {
+        region[1 + i] = rollup[i].wear;
+    }
+    if (first_write)
+    {
+        used = 0;
+    }
+    else if (write_cycle != 0x00)
+    {
+        used = pages[0] * pg_size;
+    }
+    else
+    {
+        used = ((write_pg - DATA_LOGGER_BUFFER_START_PAGE) * pg_size) + pg_offset;
+    }
+    CRITICAL_REGION_EXIT();
+
+    p_wear->total_erases = 0;
+    p_wear->hot_page     = DATA_LOGGER_BUFFER_START_PAGE;
+    p_wear->hot_erases   = 0;
+    p_wear->fill         = (uint8_t)((used * 100) / (pages[0] * pg_size));
+    p_wear->lifetime     = BLE_DLOGS_WEAR_UNKNOWN;
+    for (i = 0; i < (1 + DLOG_ROLLUP_TIERS); i++)
+    {
+        p_wear->total_erases += region[i].total;
+        if (region[i].hot_count > p_wear->hot_erases)
+        {
+            p_wear->hot_page   = (uint8_t)region[i].hot_pg;
+            p_wear->hot_erases = region[i].hot_count;
+        }
+        days = dlog_wear_days(&region[i], pages[i]);                    /* the region wearing out first limits the lifetime*/
+        if (days < p_wear->lifetime)
+        {
+            p_wear->lifetime = (uint16_t)days;
+        }
+    }
+}
+
+/**@brief Function for saving the position of the reader.
+*/
+static void dlog_read_save(dlog_read_cursor_t * p_cursor)
+{
+    p_cursor->pos   = read_pos;
+    p_cursor->pg    = read_pg;
+    p_cursor->state = read_state;
+}
+
+/**@brief Function for rolling the reader back to a saved position.
+*/
+static void dlog_read_restore(const dlog_read_cursor_t * p_cursor)
+{
+    read_pos   = p_cursor->pos;
+    read_pg    = p_cursor->pg;
+    read_state = p_cursor->state;
+    done_read  = false;
+}
+
+/**@brief Function for packing a log record into a notification.
+*
+* @details The date (4 bytes), the time (3 bytes) and the log ID (2 bytes) are followed by the
+*          channels of the profile schema, each with its stored number of bits, most significant
+*          bit first and padded with zero bits to a whole byte.
+*
+* @param[in]   data             Log record.
+* @param[out]  p_buf            Buffer of DLOG_NOTIFY_MAX_LEN bytes.
+*
+* @return      Number of bytes written to p_buf.
+*/
+static uint16_t dlog_record_pack(const uint32_t * data, uint8_t * p_buf)
+{
+    uint16_t value[DLOG_CHANNELS];
+    uint32_t acc   = 0;
+    uint32_t nbits = 0;
+    uint16_t len   = 0;
+    uint32_t i;
+
+    p_buf[len++] = (uint8_t)(data[0] >> 24);                            /* date*/
+    p_buf[len++] = (uint8_t)(data[0] >> 16);
+    p_buf[len++] = (uint8_t)(data[0] >> 8);
+    p_buf[len++] = (uint8_t)(data[0]);
+    p_buf[len++] = (uint8_t)(data[1] >> 24);                            /* time*/
+    p_buf[len++] = (uint8_t)(data[1] >> 16);
+    p_buf[len++] = (uint8_t)(data[1] >> 8);
+    p_buf[len++] = (uint8_t)(data[3] >> 8);                             /* log ID*/
+    p_buf[len++] = (uint8_t)(data[3]);
+
+    dlog_channels_get(data, value);
+    for (i = 0; i < DLOG_CHANNELS; i++)
+    {
+        acc    = (acc << dlog_schema[i].bits) | value[i];
+        nbits += dlog_schema[i].bits;
+        while (nbits >= 8)
+        {
+            nbits -= 8;
+            p_buf[len++] = (uint8_t)(acc >> nbits);
+        }
+    }
+    if (nbits != 0)
+    {
+        p_buf[len++] = (uint8_t)(acc << (8 - nbits));
+    }
+    return len;
+}
+
+/**@brief Function for protecting the pages from a reader position on from the writer.
+*
+* @details Sets the oldest page the download may still read. An erase held back for the
+*          previous lock is started if it is allowed now.
+*
+* @param[in]   p_cursor         Reader position.
+*/
+static void dlog_read_lock(const dlog_read_cursor_t * p_cursor)
+{
+    CRITICAL_REGION_ENTER();
+    read_lock_pg = (p_cursor->pos != NULL) ? p_cursor->pg : dlog_oldest_page();
+    dlog_flash_process();
+    dlog_rollup_process();
+    CRITICAL_REGION_EXIT();
+}
+
+/**@brief Function for moving the read tail behind an acknowledged record.
+*
+* @details Walks the records from the read tail. If the record with the acknowledged log ID is
+*          found, the tail moves behind it, so that the next download resumes with the record
+*          after it. An unknown log ID leaves the tail where it is. The reader position is kept.
+*
+* @param[in]   ble_dlogs        Data logger service structure.
+* @param[in]   id               Log ID acknowledged by the central.
+*
+* @return      true if the tail has moved behind the record, false if the log ID is unknown.
+*/
+static bool dlog_tail_advance(ble_dlogs_t * ble_dlogs, uint16_t id)
+{
+    uint32_t           data[DLOG_RECORD_WORDS];
+    dlog_read_cursor_t reader;
+    bool               found = false;
+
+    dlog_read_save(&reader);
+    dlog_read_lock(&read_tail);                                         /* the walk starts before the reader*/
+    dlog_read_restore(&read_tail);
+    while (true)
+    {
+        (void)read_data_flash(ble_dlogs, data);
+        if (done_read)
+        {
+            break;
+        }
+        if ((uint16_t)data[3] == id)
+        {
+            dlog_read_save(&read_tail);
+            found = true;
+            break;
+        }
+    }
+    dlog_read_restore(&reader);
+    return found;
+}
+
+/**@brief Function for checking that the reader is behind an acknowledged record.
+*
+* @details The next record must have the log ID after the acknowledged one, or a later one if
+*          records have been left out in deadband mode. The reader position is kept.
+*
+* @param[in]   ble_dlogs        Data logger service structure.
+* @param[in]   id               Log ID acknowledged by the central.
+*
+* @return      true if no acknowledged record is read again, or if there is no next record.
+*/
+static bool dlog_resume_valid(ble_dlogs_t * ble_dlogs, uint16_t id)
+{
+    uint32_t           data[DLOG_RECORD_WORDS];
+    dlog_read_cursor_t reader;
+    uint16_t           skipped = 0;
+
+    dlog_read_save(&reader);
+    (void)read_data_flash(ble_dlogs, data);
+    if (!done_read)
+    {
+        skipped = (uint16_t)data[3] - (uint16_t)(id + 1);               /* log IDs wrap at 16 bits*/
+    }
+    dlog_read_restore(&reader);
+    return (skipped < 0x8000);
+}
+
+/**@brief Function for moving the reader to the start of the query window.
+*
+* @details Binary search over the page headers, from the oldest to the head page, for
+*          the last page whose base time stamp is before the start of the window. All records
+*          of the earlier pages are older than it. Pages without a valid header or time stamp
+*          are treated as not being before the start, so that the search errs towards older pages.
+*/
+static void dlog_query_seek(void)
+{
+    uint32_t pages  = pg_end - DATA_LOGGER_BUFFER_START_PAGE + 1;       /* number of pages of the cyclic buffer*/
+    uint32_t oldest = dlog_oldest_page();
+    uint32_t lo     = 0;
+    uint32_t hi;
+    uint32_t mid;
+    uint32_t page;
+    const dlog_page_header_t * p_header;
+
+    hi = (read_head_pg >= oldest) ? (read_head_pg - oldest + 1) : (read_head_pg + pages - oldest + 1);  /* number of pages of the snapshot*/
+    while (lo < hi)
+    {
+        mid  = (lo + hi) / 2;
+        page = oldest + mid;
+        if (page > pg_end)
+        {
+            page -= pages;
+        }
+        p_header = (const dlog_page_header_t *)DLOG_PAGE_ADDR(page);
+        if (dlog_page_valid(page, NULL) && (p_header->base.time != DLOG_TIME_INVALID) && (p_header->base.time < query_start))
+        {
+            lo = mid + 1;
+        }
+        else
+        {
+            hi = mid;
+        }
+    }
+
+    page = oldest + ((lo > 0) ? (lo - 1) : 0);
+    if (page > pg_end)
+    {
+        page -= pages;
+    }
+    read_pg   = page;
+    read_pos  = (uint8_t *)DLOG_PAGE_ADDR(page);
+    done_read = false;
+}
+
+/**@brief Function for reading the next record of the query window.
+*
+* @details Reads the next record with read_data_flash(). With a query, records before the start
+*          of the window and records without a valid date are skipped, done_read is set at the
+*          first record after the end of the window, and stride - 1 records are left out after
+*          every record returned.
+*
+* @param[in]   ble_dlogs        Data logger service structure.
+* @param[out]  data             Log record.
+*/
+static void dlog_query_read(ble_dlogs_t * ble_dlogs, uint32_t * data)
+{
+    uint32_t           skip[DLOG_RECORD_WORDS];
+    dlog_read_cursor_t cursor;
+    uint32_t           time;
+    uint32_t           i;
+
+    while (true)
+    {
+        (void)read_data_flash(ble_dlogs, data);
+        if (done_read || !query_active)
+        {
+            return;
+        }
+        if ((query_start == 0) && (query_end == 0))
+        {
+            break;                                                      /* decimation of the whole log*/
+        }
+        time = dlog_time_get(data);
+        if (time == DLOG_TIME_INVALID)
+        {
+            continue;
+        }
+        if ((query_end != 0) && (time > query_end))
+        {
+            done_read = true;                                           /* past the end of the window*/
+            return;
+        }
+        if (time >= query_start)
+        {
+            break;
+        }
+    }
+
+    for (i = 1; i < query_stride; i++)
+    {
+        dlog_read_save(&cursor);
+        (void)read_data_flash(ble_dlogs, skip);
+        if (done_read)
+        {
+            dlog_read_restore(&cursor);                                 /* the end is reported by the next call*/
+            break;
+        }
+    }
+}
+
+/**@brief Function for getting the next notification of a download sent straight from flash.
+*
+* @details Used for the rollup rings and the flash image of the log. The notification points
+*          into the page being read, nothing is copied or decoded. It never spans two pages and
+*          ends with the data of the page, found by the first erased word (for a rollup ring the
+*          first erased record). Pages without a valid header are skipped, the header of a rollup
+*          page is not sent. The last notification of a log page is always shorter than
+*          DLOG_NOTIFY_MAX_LEN, so that the central knows that the next one starts with a page
+*          header. A page whose data ends with a full notification is ended by sending its first
+*          erased word as well.
+*
+* @param[out]  pp_data          Flash address of the notification.
+*
+* @return      Length of the notification, 0 if all pages have been read.
+*/
+static uint16_t dlog_flash_packet_get(uint8_t ** pp_data)
+{
+    uint8_t *p_page;
+    uint8_t *p_end;
+    uint32_t slot = (rollup_read != NULL) ? (rollup_words * sizeof(uint32_t)) : sizeof(uint32_t);    /* a new record may start at every slot*/
+    uint32_t first;                                                     /* offset of the first record in the page*/
+    uint32_t avail;
+    uint32_t seq;
+    bool     valid;
+
+    while ((read_head != NULL) && (read_pos != read_head))
+    {
+        p_page = (uint8_t *)DLOG_PAGE_ADDR(read_pg);
+        first  = (rollup_read != NULL) ? sizeof(dlog_rollup_header_t) : sizeof(dlog_page_header_t);
+        p_end  = (read_pg == read_head_pg) ? read_head : (p_page + first + (((pg_size - first) / slot) * slot));
+
+        if (read_pos == p_page)                                         /* start of a page, check the header*/
+        {
+            valid = (rollup_read != NULL) ? dlog_rollup_page_valid(read_pg, &seq) : dlog_page_valid(read_pg, NULL);
+            if (!valid)
+            {
+                read_pos = p_end;                                       /* skip a page without a valid header*/
+                continue;
+            }
+            if (rollup_read != NULL)
+            {
+                read_pos += first;                                      /* the header of a rollup page is not sent*/
+            }
+        }
+
+        avail = 0;                                                      /* data following read_pos, one word more than a notification*/
+        while ((avail <= DLOG_NOTIFY_MAX_LEN) && ((read_pos + avail) < p_end))
         {
-            for(i=0;i<4;i++)
+            if (((read_pos + avail) >= (p_page + first)) &&
+                (((uint32_t)(read_pos + avail - p_page - first) % slot) == 0) &&
+                (*(uint32_t *)(read_pos + avail) == DLOG_ERASED_WORD))
             {
-                *data = *read_addr;
-                read_addr++;
-                data++;
+                break;                                                  /* end of the data of the page*/
             }
+            avail += sizeof(uint32_t);
+        }
+
+        if ((avail == 0) && (rollup_read == NULL) && (read_pos < p_end) &&
+            ((((uint32_t)(read_pos - p_page)) % DLOG_NOTIFY_MAX_LEN) == 0))
+        {
+            avail = sizeof(uint32_t);                                   /* a page ending with a full notification is ended by its first erased word*/
+        }
+        else if (avail == 0)                                            /* continue with the next page*/
+        {
+            read_pg  = (rollup_read != NULL) ? dlog_rollup_next_page(rollup_read, read_pg) : dlog_next_page(read_pg);
+            read_pos = (uint8_t *)DLOG_PAGE_ADDR(read_pg);
+            continue;
         }
-        else if(read_addr == write_addr)    /*If the read pointer has reached the current position of write pointer, set done_read*/
+        if (avail > DLOG_NOTIFY_MAX_LEN)
         {
-            done_read=true;
+            avail = DLOG_NOTIFY_MAX_LEN;
         }
+
+        *pp_data  = read_pos;
+        read_pos += avail;
+        return (uint16_t)avail;
     }
-    else
-    {																		  	/*if read page is above write page, read up-to the last memory location*/
-        if(read_addr <  buffer_end_addr)
+    return 0;
+}
+
+/**@brief Function for packing the next logged records into a notification.
+*
+* @details During a rollup or flash image download the notification is taken from flash
+*          instead, see dlog_flash_packet_get(). Only the records of the query window are packed, see
+*          dlog_query_read(). The
+*          first record is packed in full by dlog_record_pack(). The following records are
+*          appended in the compressed form of the flash log (time difference and changed channel
+*          code, channel differences) as long as they fit, each coded against the record before
+*          it. A record which can only be stored uncompressed starts the next notification.
+*
+* @param[in]   ble_dlogs        Data logger service structure.
+* @param[out]  p_buf            Buffer of DLOG_NOTIFY_MAX_LEN bytes.
+* @param[out]  pp_data          Notification, p_buf or its address in flash.
+*
+* @return      Length of the notification, 0 if all records have been read.
+*/
+static uint16_t dlog_packet_build(ble_dlogs_t * ble_dlogs, uint8_t * p_buf, uint8_t ** pp_data)
+{
+    uint32_t           data[DLOG_RECORD_WORDS];
+    uint8_t            coded[DLOG_MAX_CODED_SIZE];
+    dlog_codec_state_t state = {DLOG_TIME_INVALID, {0}, 0, 0xFFFF};
+    dlog_read_cursor_t cursor;
+    uint16_t           len;
+    uint32_t           size;
+
+    if ((rollup_read != NULL) || image_read)
+    {
+        return dlog_flash_packet_get(pp_data);
+    }
+    *pp_data = p_buf;
+
+    dlog_query_read(ble_dlogs, data);
+    if (done_read)
+    {
+        return 0;
+    }
+    len = dlog_record_pack(data, p_buf);
+    (void)dlog_encode(data, &state, coded);                             /* the following records are coded against the first one*/
+
+    while (len < DLOG_NOTIFY_MAX_LEN)
+    {
+        dlog_read_save(&cursor);
+        dlog_query_read(ble_dlogs, data);
+        if (done_read)
+        {
+            dlog_read_restore(&cursor);                                 /* the end is reported by the next call*/
+            break;
+        }
+        size = dlog_encode(data, &state, coded);
+        if ((coded[0] == DLOG_CODE_RAW) || ((len + size) > DLOG_NOTIFY_MAX_LEN))
+        {
+            dlog_read_restore(&cursor);                                 /* the record starts the next notification*/
+            break;
+        }
+        memcpy(&p_buf[len], coded, size);
+        len += size;
+    }
+    return len;
+}
+
+/**@brief Function to send data to the connected BLE central device.
+*
+* @details Starts with the record after the last one acknowledged through the cursor
+*          characteristic, so that an interrupted download resumes where the central stopped.
+*          If a query has been written, the download is limited to its time window instead and
+*          starts at the page found by dlog_query_seek().
+*          Packs the logged records into notifications and keeps all application TX buffers of
+*          the SoftDevice filled, so that several notifications go out in every connection event.
+*          When all buffers are in use the function returns, the TX complete event posts
+*          WIMOTO_EVT_DOWNLOAD and the next call continues the download. A notification rejected
+*          for lack of buffers is packed again from the same records.
+*
+*          The download sends a snapshot: the records in flash when it starts. Logging continues
+*          meanwhile, new records are written behind the head of the snapshot, and the page the
+*          download reads from is not erased until it has moved on. Records due meanwhile are
+*          logged by the main loop between the calls.
+*
+*          If a rollup ring has been selected, its records are sent from the oldest page on
+*          instead, the query and the cursor do not apply. A rollup ring and the flash image of
+*          the log are sent straight from flash without copying.
+*
+* @param[in]   ble_dlogs        Data logger service structure.
+*
+* @return      true if the download is complete, false if it has to be continued.
+*/
+bool send_data(ble_dlogs_t * ble_dlogs)
+{
+    uint32_t err_code;
+    static send_state state=READ;
+    bool exit_loop=false;
+    uint8_t  buffer[DLOG_NOTIFY_MAX_LEN];                               /* notification being sent*/
+    uint8_t *p_data;                                                    /* buffer, or the flash address of the notification*/
+    uint16_t len;
+    uint8_t  count;
+    dlog_read_cursor_t packet_start;                                    /* reader position of the first record of the notification*/
+    uint8_t  tx_seq;                                                    /* TX complete events seen before the notification was sent*/
+    bool     tail_moved;                                                /* the read tail has moved behind an acknowledged record*/
+
+    if (!download_active)                                               /* start of a download, take the snapshot*/
+    {
+        err_code = sd_ble_tx_buffer_count_get(&count);
+        APP_ERROR_CHECK(err_code);
+
+        CRITICAL_REGION_ENTER();
+        tx_buffers_free = count;
+        if ((ble_dlogs->rollup >= 1) && (ble_dlogs->rollup <= DLOG_ROLLUP_TIERS))
         {
-            for(i=0;i<4;i++)
+            rollup_read  = &rollup[ble_dlogs->rollup - 1];
+            read_head    = (uint8_t *)DLOG_PAGE_ADDR(rollup_read->write_pg) + rollup_read->offset;
+            read_head_pg = rollup_read->write_pg;
+            read_pg      = dlog_rollup_next_page(rollup_read, rollup_read->write_pg);
+            read_pos     = (uint8_t *)DLOG_PAGE_ADDR(read_pg);
+            read_lock_pg = read_pg;
+        }
+        else
+        {
+            rollup_read  = NULL;
+            image_read   = (ble_dlogs->read_data_switch == DLOG_READ_IMAGE);
+            read_head    = (uint8_t *)write_addr;
+            read_head_pg = write_pg;
+            read_lock_pg = dlog_oldest_page();
+        }
+        download_active = true;
+        CRITICAL_REGION_EXIT();
+
+        query_start  = ble_dlogs->query_start;
+        query_end    = ble_dlogs->query_end;
+        query_stride = ble_dlogs->query_stride;
+        query_active = (query_start != 0) || (query_end != 0) || (query_stride > 1);
+
+        if (rollup_read != NULL)
+        {
+            done_read = false;                                          /* the rollup ring is read from its oldest page*/
+        }
+        else if (image_read)
+        {
+            read_pg  = (read_tail.pos != NULL) ? read_tail.pg : dlog_oldest_page();   /* the page of the last acknowledged record*/
+            read_pos = (uint8_t *)DLOG_PAGE_ADDR(read_pg);
+        }
+        else if (query_active && (read_head != NULL))
+        {
+            dlog_query_seek();                                          /* start at the first page of the window*/
+        }
+        else
+        {
+            tail_moved = false;
+            if (ack_pending)                                            /* move the read tail behind the acknowledged records before resuming there*/
             {
-                *data = *read_addr;
-                read_addr++;
-                data++;
+                ack_pending = false;
+                tail_moved  = dlog_tail_advance(ble_dlogs, ack_id);
             }
+            dlog_read_restore(&read_tail);                              /* resume after the last acknowledged record*/
+            ASSERT(!tail_moved || dlog_resume_valid(ble_dlogs, ack_id));
         }
-        else
-        {																	/*After reading till the last memory, start reading from the first page*/				
-            read_pg   = DATA_LOGGER_BUFFER_START_PAGE;
-            read_addr = (uint32_t *)(pg_size * read_pg);
-            for(i=0;i<4;i++)
+        state = READ;
+    }
+
+    while(true)
+    {
+        switch(state)
+        {
+        case READ:
+            if (ack_pending && (rollup_read == NULL) && !image_read)    /* the central has acknowledged records, move the read tail behind them*/
+            {
+                ack_pending = false;
+                (void)dlog_tail_advance(ble_dlogs, ack_id);
+            }
+            if (tx_buffers_free == 0)                                   /* all TX buffers are in use*/
+            {
+                state = TXMIT;
+                break;
+            }
+
+            dlog_read_save(&packet_start);
+            dlog_read_lock(&packet_start);
+            len = dlog_packet_build(ble_dlogs, buffer, &p_data);        /* read and pack as many records as fit into one notification*/
+            if (len == 0)                                               /* If all the data has been read set the next state to read complete*/
+            {
+                state = READ_COMPLETE;
+                break;
+            }
+
+            tx_seq   = tx_complete_seq;
+            err_code = send_data_to_central(ble_dlogs, p_data, len);
+            if (err_code == NRF_SUCCESS)
+            {
+                CRITICAL_REGION_ENTER();
+                tx_buffers_free--;
+                CRITICAL_REGION_EXIT();
+            }
+            else if (err_code == BLE_ERROR_NO_TX_BUFFERS)
             {
-                *data = *read_addr;
-                read_addr++;
-                data++;
+                dlog_read_restore(&packet_start);                       /* send the same records once a buffer is free*/
+                CRITICAL_REGION_ENTER();
+                if (tx_complete_seq == tx_seq)                          /* no buffer has been freed since the send, wait for the next TX complete*/
+                {
+                    tx_buffers_free = 0;
+                }
+                CRITICAL_REGION_EXIT();
+                state = TXMIT;
+            }
+            else if (err_code == NRF_ERROR_INVALID_STATE)               /* disconnected or notifications disabled*/
+            {
+                dlog_read_restore(&packet_start);
+                state = READ_COMPLETE;
+            }
+            else
+            {
+                APP_ERROR_HANDLER(err_code);
+            }
+            break;
+
+        case TXMIT:                                                     /* Enter this case when all TX buffers are in use*/
+            if (ble_dlogs->conn_handle == BLE_CONN_HANDLE_INVALID)
+            {
+                state = READ_COMPLETE;
+            }
+            else if (tx_buffers_free == 0)
+            {
+                return false;                                           /* continued on the next TX complete event*/
             }
+            else
+            {
+                state = READ;
+            }
+            break;
+
+        case READ_COMPLETE:                                             /* If the read is completed, exit the loop*/
+            exit_loop=true;
+            state=READ;
+            break;
+
+        default:
+            break;
+        }
+
+        if(exit_loop)
+        {
+            break;
         }
     }
-    
-    return NRF_SUCCESS;
+
+    CRITICAL_REGION_ENTER();
+    download_active = false;
+    dlog_flash_process();                                               /* write the records held back by the download*/
+    dlog_rollup_process();
+    CRITICAL_REGION_EXIT();
+    if ((rollup_read != NULL) || image_read)                            /* the next download reads the logged records again*/
+    {
+        rollup_read = NULL;
+        image_read  = false;
+        read_pos    = NULL;
+        ble_dlogs->rollup = 0;
+    }
+    return true;
 }
 
-/**@brief Function to send the data to the connected central device.
+/**@brief Function readin data to flash and sending to the connected BLE central device.
+*
+* @details Decompresses the next record, starting with the oldest data when called for the
+*          first time. The compression state is loaded from the header at the start of every
+*          page, pages without a valid header are skipped. done_read is set when the read
+*          position reaches the write pointer.
+*
+* @param[in]   ble_dlogs        Data logger service structure.
+* @param[in]   data             Data buffer.
 *
-* @param[in]   ble_dlogs  Data logger service structure.
-* @param[in]   data       Data buffer.
 * @return      NRF_SUCCESS on success, otherwise an error code.
 */
 
-uint32_t send_data_to_central(ble_dlogs_t * ble_dlogs,uint32_t *data)
+uint32_t read_data_flash(ble_dlogs_t * ble_dlogs, uint32_t * data)
 {
-    uint8_t  buffer[16];
-    uint16_t len = sizeof(buffer);
-    uint32_t err_code;
+    uint32_t pages = 0;
+    uint8_t *p_page;
+    uint8_t *p_end;
+
+    if (read_head == NULL)                              /* nothing had been logged when the download started*/
+    {
+        done_read = true;
+        return NRF_SUCCESS;
+    }
+
+    if (read_pos == NULL)                               /*in the first read operation, start with the oldest page set by the write routine*/
+    {
+        read_pg  = dlog_oldest_page();
+        read_pos = (uint8_t *)DLOG_PAGE_ADDR(read_pg);
+    }
+
+    while (pages <= (pg_end - DATA_LOGGER_BUFFER_START_PAGE + 1))
+    {
+        p_page = (uint8_t *)DLOG_PAGE_ADDR(read_pg);
+        p_end  = (read_pg == read_head_pg) ? read_head : (uint8_t *)DLOG_PAGE_ADDR(read_pg + 1);
+
+        if (read_pos == read_head)                      /*If the read pointer has reached the head of the snapshot, set done_read*/
+        {
+            done_read = true;
+            return NRF_SUCCESS;
+        }
 
-    buffer[0] =  (data[0]&0xFF000000)>>24;				/*pack the data and time stamp to uint8 array*/
-    buffer[1]  = (data[0]&0x00FF0000)>>16;
-    buffer[2]  = (data[0]&0x0000FF00)>>8;
-    buffer[3]  = (data[0]&0x000000FF);
+        if (read_pos == p_page)                         /* start of a page, load the compression state from the page header*/
+        {
+            if (dlog_page_valid(read_pg, NULL))
+            {
+                read_state = ((const dlog_page_header_t *)p_page)->base;
+                read_pos  += sizeof(dlog_page_header_t);
+            }
+            else
+            {
+                read_pos = (uint8_t *)DLOG_PAGE_ADDR(read_pg + 1);  /* skip a page without a valid header*/
+            }
+        }
+        else if ((read_pos >= p_end) ||
+                 ((((uint32_t)read_pos % sizeof(uint32_t)) == 0) && (*(uint32_t *)read_pos == DLOG_ERASED_WORD)))
+        {                                               /*After reading till the end of the data in the page, continue with the next page of the cyclic buffer*/
+            read_pg  = dlog_next_page(read_pg);
+            read_pos = (uint8_t *)DLOG_PAGE_ADDR(read_pg);
+            pages++;
+        }
+        else if (*read_pos == DLOG_CODE_PAD)
+        {
+            read_pos++;
+        }
+        else if (dlog_decode((const uint8_t **)&read_pos, p_end, &read_state, data))
+        {
+            return NRF_SUCCESS;
+        }
+        else
+        {
+            read_pos = (uint8_t *)DLOG_PAGE_ADDR(read_pg + 1);      /* skip the rest of a page with an incomplete record*/
+        }
+    }
 
-    buffer[4]   = (data[1]&0xFF000000)>>24;
-    buffer[5]   = (data[1]&0x00FF0000)>>16;
-    buffer[6]   = (data[1]&0x0000FF00)>>8;
-    buffer[7]   = (data[1]&0x000000FF);
+    done_read = true;                                   /* no valid data found in the whole buffer*/
+    return NRF_SUCCESS;
+}
 
-    buffer[8]   = (data[2]&0xFF000000)>>24;
-    buffer[9]   = (data[2]&0x00FF0000)>>16;
-    buffer[10]  = (data[2]&0x0000FF00)>>8;
-    buffer[11]  = (data[2]&0x000000FF);
+/**@brief Function to send the data to the connected central device.
+*
+* @param[in]   ble_dlogs  Data logger service structure.
+* @param[in]   p_data     Packed log records.
+* @param[in]   len        Length of the packed log records.
+* @return      NRF_SUCCESS on success, otherwise an error code.
+*/
 
-    buffer[12]  = (data[3]&0xFF000000)>>24;
-    buffer[13]  = (data[3]&0x00FF0000)>>16;
-    buffer[14]  = (data[3]&0x0000FF00)>>8;
-    buffer[15]  = (data[3]&0x000000FF);
+uint32_t send_data_to_central(ble_dlogs_t * ble_dlogs, uint8_t * p_data, uint16_t len)
+{
+    uint32_t err_code;
 
     // Send the updated value of data if connected and notifying		
     if ((ble_dlogs->conn_handle != BLE_CONN_HANDLE_INVALID) && ble_dlogs->is_notification_supported)
@@ -816,7 +3143,7 @@ uint32_t send_data_to_central(ble_dlogs_t * ble_dlogs,uint32_t *data)
         hvx_params.type     = BLE_GATT_HVX_NOTIFICATION;
         hvx_params.offset   = 0;
         hvx_params.p_len    = &len;
-        hvx_params.p_data   = buffer;
+        hvx_params.p_data   = p_data;
         
         err_code = sd_ble_gatts_hvx(ble_dlogs->conn_handle, &hvx_params);
     }
@@ -834,7 +3161,9 @@ uint32_t send_data_to_central(ble_dlogs_t * ble_dlogs,uint32_t *data)
 }
 
 
-/**@brief Function to reset the datalogger enable and read data switch characteristics.
+/**@brief Function to reset the read data switch and rollup characteristics after a download.
+*
+* @details The data logger enable characteristic is left as it is, logging continues.
 *
 * @param[in]   ble_dlogs        Data logger service structure.
 *
@@ -845,54 +3174,13 @@ uint32_t reset_data_log(ble_dlogs_t * ble_dlogs)
     uint32_t err_code;
     uint16_t len = sizeof(uint8_t);
 
-    uint8_t data_logger_enable=0x00;
     uint8_t read_data_switch=0x00;
     
     // Update the service structure
-    ble_dlogs->data_logger_enable =data_logger_enable;
     ble_dlogs->read_data_switch   =read_data_switch;	
     
     
 
-    // Send the updated value of data logger enable if connected and notifying
-    if ((ble_dlogs->conn_handle != BLE_CONN_HANDLE_INVALID) && ble_dlogs->is_notification_supported)
-    {
-        ble_gatts_hvx_params_t hvx_params;
-        
-        memset(&hvx_params, 0, sizeof(hvx_params));
-        
-        
-        hvx_params.handle   = ble_dlogs->data_logger_enable_handles.value_handle;
-        hvx_params.type     = BLE_GATT_HVX_NOTIFICATION;
-        hvx_params.offset   = 0;
-        hvx_params.p_len    = &len;
-        hvx_params.p_data   = &data_logger_enable;
-        
-				TX_COMPLETE = false;																	/*Set the TX Complete flag to false before updating characteristics value*/
-        while(1)
-				{
-        err_code = sd_ble_gatts_hvx(ble_dlogs->conn_handle, &hvx_params);									/*Make sure TX BUFFERS are not full*/
-				if (err_code != BLE_ERROR_NO_TX_BUFFERS)
-					{
-						break;
-					}
-				}
-				
-    }
-    else
-    {
-        err_code = NRF_ERROR_INVALID_STATE;
-    }
-    if ((err_code != NRF_SUCCESS) &&															 
-        (err_code != NRF_ERROR_INVALID_STATE) &&
-        (err_code != BLE_ERROR_NO_TX_BUFFERS) &&
-        (err_code != BLE_ERROR_GATTS_SYS_ATTR_MISSING)
-        )
-    {
-        return err_code;
-        
-    }
-    
     // Send the updated value of read data switch if connected and notifying						
     if ((ble_dlogs->conn_handle != BLE_CONN_HANDLE_INVALID) && ble_dlogs->is_notification_supported)
     {
@@ -907,14 +3195,7 @@ uint32_t reset_data_log(ble_dlogs_t * ble_dlogs)
         hvx_params.p_len    = &len;
         hvx_params.p_data   = &read_data_switch;
         
-        while(1)
-				{
-        err_code = sd_ble_gatts_hvx(ble_dlogs->conn_handle, &hvx_params);
-				if (err_code != BLE_ERROR_NO_TX_BUFFERS)																					/*Make sure that the TX BUFFERS are not full*/
-					{	
-						break;
-					}
-				}
+        err_code = wimoto_hvx_send(ble_dlogs->conn_handle, &hvx_params);   /*queued until a TX buffer is free*/
     }
     else
     {
@@ -929,8 +3210,8 @@ uint32_t reset_data_log(ble_dlogs_t * ble_dlogs)
         return err_code;
         
     }
-		sd_ble_gatts_value_set(ble_dlogs->data_logger_enable_handles.value_handle, 0, &len, 0);  /*clear the value of data logger enable characteristics*/
 		sd_ble_gatts_value_set(ble_dlogs->read_data_handles.value_handle, 0, &len, 0);  /*clear the value of read data enable characteristics*/
+		sd_ble_gatts_value_set(ble_dlogs->rollup_handles.value_handle, 0, &len, 0);     /*clear the value of rollup characteristics*/
     done_read=false;
     return NRF_SUCCESS;
     
@@ -938,12 +3219,29 @@ uint32_t reset_data_log(ble_dlogs_t * ble_dlogs)
 /**
  * @brief Handles Flash Access Result Events 
  *
+ * @details Completes the operation started by the data logger and starts the next queued one.
+ *          A failed operation is started again. Events of flash operations started by other
+ *          modules are used to retry an operation which was rejected as busy.
+ *
  * @param[in] sys_evt System event to be handled.
  */
 void data_log_sys_event_handler(uint32_t sys_evt)
 {
-		if (sys_evt == NRF_EVT_FLASH_OPERATION_SUCCESS)
-		{ 
-				flash_comp_evt = true;
-		}
+    switch (sys_evt)
+    {
+        case NRF_EVT_FLASH_OPERATION_SUCCESS:
+            dlog_flash_complete();
+            dlog_rollup_complete();
+            break;
+
+        case NRF_EVT_FLASH_OPERATION_ERROR:
+            flash_state  = DLOG_FLASH_IDLE;                             /* repeat the failed operation*/
+            rollup_state = DLOG_FLASH_IDLE;
+            break;
+
+        default:
+            return;
+    }
+    dlog_flash_process();
+    dlog_rollup_process();
 } 
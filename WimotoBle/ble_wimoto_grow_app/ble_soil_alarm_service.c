@@ -22,18 +22,18 @@
 #include "ble_srv_common.h"
 #include "app_util.h"
 #include "wimoto.h"
+#include "wimoto_evt.h"
+#include "wimoto_hvx.h"
 #include "wimoto_sensors.h"
 #include "app_error.h"
 
 bool SOILS_CONNECTED_STATE=false;             /*This flag indicates whether a client is connected to the peripheral in soil moisture service*/
-extern bool 	  CHECK_ALARM_TIMEOUT;
 extern uint8_t	 var_receive_uuid;								/*variable to receive uuid*/
 extern uint8_t  curr_soil_mois_level;            /*variable to store current Humidity value from htu21d to broadcast*/
 bool  soil_alarm_set_changed = false;
 
 bool     				m_soils_alarm_ind_conf_pending = false;       /**< Flag to keep track of when an indication confirmation is pending.*/
-extern bool     m_temps_alarm_ind_conf_pending;
-extern bool     m_lights_alarm_ind_conf_pending;
+bool     				SOILS_READ_PENDING = false;       /**< Flag to keep track of when a read of the current soil moisture level waits for a measurement. */
 
 /**@brief Function for handling the Connect event.
 *
@@ -44,7 +44,7 @@ static void on_connect(ble_soils_t * p_soils, ble_evt_t * p_ble_evt)
 {
     p_soils->conn_handle = p_ble_evt->evt.gap_evt.conn_handle;
     SOILS_CONNECTED_STATE = true;      /*Set the flag to true so that state remains in connectable mode until disconnect*/
-		CHECK_ALARM_TIMEOUT = true;        /* set the flag to check the alarm condiction on connection*/
+		wimoto_evt_post(WIMOTO_EVT_ALARM_CHECK); /*check the alarm conditions on connection*/
 }
 
 
@@ -61,6 +61,27 @@ static void on_disconnect(ble_soils_t * p_soils, ble_evt_t * p_ble_evt)
 }
 
 
+/**@brief Function for handling the Read/Write Authorization Request event.
+*
+* @details A read of the current soil moisture level is answered by ble_soils_current_read_reply() once the main loop
+*          has taken a new measurement.
+*
+* @param[in]   p_soils     Soil Moisture Service structure.
+* @param[in]   p_ble_evt   Event received from the BLE stack.
+*/
+static void on_rw_authorize_request(ble_soils_t * p_soils, ble_evt_t * p_ble_evt)
+{
+    ble_gatts_evt_rw_authorize_request_t * p_auth_req = &p_ble_evt->evt.gatts_evt.params.authorize_request;
+
+    if ((p_auth_req->type == BLE_GATTS_AUTHORIZE_TYPE_READ) &&
+        (p_auth_req->request.read.handle == p_soils->curr_soil_mois_level_handles.value_handle))
+    {
+        SOILS_READ_PENDING = true;
+        wimoto_evt_post(WIMOTO_EVT_READ_SENSORS);    /* the measurement is taken from the main loop*/
+    }
+}
+
+
 /**@brief Function for handling write events on values.
 *
 * @details This function will be called for all write events of soil low, high values and alarm set 
@@ -68,7 +89,7 @@ static void on_disconnect(ble_soils_t * p_soils, ble_evt_t * p_ble_evt)
 */
 static void write_evt_handler(void)
 {   
-    CHECK_ALARM_TIMEOUT = true; 
+    wimoto_evt_post(WIMOTO_EVT_ALARM_CHECK);
 }
 
 static void on_soils_evt(ble_soils_t * p_soils, ble_soils_alarm_evt_t *p_evt)
@@ -302,11 +323,16 @@ void ble_soils_on_ble_evt(ble_soils_t * p_soils, ble_evt_t * p_ble_evt)
 
     case BLE_GAP_EVT_DISCONNECTED:
 				m_soils_alarm_ind_conf_pending = false;													//Clear pending confirmation flag if a disconnect occurs
+				SOILS_READ_PENDING = false;
         on_disconnect(p_soils, p_ble_evt);
         break;
 
     case BLE_GATTS_EVT_WRITE:
         on_write(p_soils, p_ble_evt);
+        break;
+
+    case BLE_GATTS_EVT_RW_AUTHORIZE_REQUEST:
+        on_rw_authorize_request(p_soils, p_ble_evt);
         break;
 		case BLE_GATTS_EVT_HVC:
             on_hvc(p_soils, p_ble_evt);
@@ -361,7 +387,7 @@ static uint32_t current_soil_mois_level_char_add(ble_soils_t * p_soils, const bl
     attr_md.read_perm  = p_soils_init->soil_mois_char_attr_md.read_perm;
     attr_md.write_perm = p_soils_init->soil_mois_char_attr_md2.write_perm;
     attr_md.vloc       = BLE_GATTS_VLOC_USER;
-    attr_md.rd_auth    = 0;
+    attr_md.rd_auth    = 1;                                   /* the value is measured when a client reads it*/
     attr_md.wr_auth    = 0;
     attr_md.vlen       = 0;
 
@@ -769,7 +795,7 @@ uint32_t ble_soils_level_alarm_check(ble_soils_t * p_soils,ble_device_t *p_devic
             hvx_params.p_len    = &len1;
             hvx_params.p_data   = &current_soil_mois_level;
 
-            err_code = sd_ble_gatts_hvx(p_soils->conn_handle, &hvx_params);
+            err_code = wimoto_hvx_send(p_soils->conn_handle, &hvx_params);
 						previous_soil_mois_level = current_soil_mois_level;
         }
         else
@@ -786,25 +812,13 @@ uint32_t ble_soils_level_alarm_check(ble_soils_t * p_soils,ble_device_t *p_devic
         if(current_soil_mois_level < p_soils->soil_mois_low_level)
         {
             alarm[0] = SET_ALARM_LOW;		      						/* Set alarm to 01 if soil moisture level is low */
-						alarm[1] = p_device->device_time_stamp_set[0];	/*capture the timestamp when alarm occured*/
-						alarm[2] = p_device->device_time_stamp_set[1];
-						alarm[3] = p_device->device_time_stamp_set[2];
-						alarm[4] = p_device->device_time_stamp_set[3];
-						alarm[5] = p_device->device_time_stamp_set[4];
-						alarm[6] = p_device->device_time_stamp_set[5];
-						alarm[7] = p_device->device_time_stamp_set[6];
+						ble_time_stamp_encode(&alarm[1]);	/*capture the timestamp when alarm occured*/
         }
 
         else if(current_soil_mois_level > p_soils->soil_mois_high_level)
         {
             alarm[0] = SET_ALARM_HIGH;		    						/* Set alarm to 02 if soil moisture level is high */
-						alarm[1] = p_device->device_time_stamp_set[0];	/*capture the timestamp when alarm occured*/
-						alarm[2] = p_device->device_time_stamp_set[1];
-						alarm[3] = p_device->device_time_stamp_set[2];
-						alarm[4] = p_device->device_time_stamp_set[3];
-						alarm[5] = p_device->device_time_stamp_set[4];
-						alarm[6] = p_device->device_time_stamp_set[5];
-						alarm[7] = p_device->device_time_stamp_set[6];
+						ble_time_stamp_encode(&alarm[1]);	/*capture the timestamp when alarm occured*/
         }                                   
                                      
     }                                       
@@ -827,7 +841,7 @@ uint32_t ble_soils_level_alarm_check(ble_soils_t * p_soils,ble_device_t *p_devic
     if((alarm[0]!= 0x00)&&(p_soils->soil_mois_alarm_set == 0x01))  /*check whether the alarm sets as non zero or alarm set characteristics set as zero*/
     {		
 				//check whether the confirmation for indication is not pending
-				if((!m_temps_alarm_ind_conf_pending)&&(!m_lights_alarm_ind_conf_pending)&&(!m_soils_alarm_ind_conf_pending))
+				if(!m_soils_alarm_ind_conf_pending)
 				{
 				// Send value if connected and notifying
           if ((p_soils->conn_handle != BLE_CONN_HANDLE_INVALID) && p_soils->is_notification_supported)
@@ -842,7 +856,7 @@ uint32_t ble_soils_level_alarm_check(ble_soils_t * p_soils,ble_device_t *p_devic
             hvx_params.p_len    = &len;
             hvx_params.p_data   = alarm;
 
-            err_code = sd_ble_gatts_hvx(p_soils->conn_handle, &hvx_params);
+            err_code = wimoto_hvx_send(p_soils->conn_handle, &hvx_params);
 						p_soils->soil_alarm_with_time_stamp[0] = alarm[0];
 						if(err_code == NRF_SUCCESS)
 						{
@@ -859,6 +873,39 @@ uint32_t ble_soils_level_alarm_check(ble_soils_t * p_soils,ble_device_t *p_devic
     return err_code;
 }
 
+
+/**@brief Function for answering a pending read of the current soil moisture level.
+*
+* @details The application calls this function from the main loop after a read of the current
+*          soil moisture level was requested.
+*
+* @param[in]   p_soils    Soil Moisture Service structure.
+*
+* @return      NRF_SUCCESS on success, NRF_ERROR_INVALID_STATE if no read is pending, otherwise an error code.
+*/
+uint32_t ble_soils_current_read_reply(ble_soils_t * p_soils)
+{
+    ble_gatts_rw_authorize_reply_params_t auth_reply;
+    uint8_t                               current_value;
+
+    if (!SOILS_READ_PENDING)
+    {
+        return NRF_ERROR_INVALID_STATE;
+    }
+    SOILS_READ_PENDING = false;
+
+    current_value = read_soil_mois_level();
+
+    memset(&auth_reply, 0, sizeof(auth_reply));
+
+    auth_reply.type                    = BLE_GATTS_AUTHORIZE_TYPE_READ;
+    auth_reply.params.read.gatt_status = BLE_GATT_STATUS_SUCCESS;
+    auth_reply.params.read.len         = sizeof(current_value);
+    auth_reply.params.read.p_data      = &current_value;       /* the stack copies the value to the characteristic*/
+
+    return sd_ble_gatts_rw_authorize_reply(p_soils->conn_handle, &auth_reply);
+}
+
 /**@brief Function to read soil moisture level from sensor interfaced to ADC.
 *
 * @param[in]   void
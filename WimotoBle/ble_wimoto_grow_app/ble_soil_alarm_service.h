@@ -131,6 +131,14 @@ void ble_soils_on_ble_evt(ble_soils_t * p_soils, ble_evt_t * p_ble_evt);
 
 uint32_t ble_soils_level_alarm_check(ble_soils_t *,ble_device_t *);
 
+/**@brief Function for answering a pending read of the current soil moisture level with a new measurement.
+*
+* @param[in]   p_soils    Soil Moisture Service structure.
+*
+* @return      NRF_SUCCESS on success, NRF_ERROR_INVALID_STATE if no read is pending, otherwise an error code.
+*/
+uint32_t ble_soils_current_read_reply(ble_soils_t *);
+
 /**@brief Function to read soil moisture level from sensor interfaced to ADC.
 *
 * @param[in]   void
@@ -25,17 +25,17 @@
 #include "ble_srv_common.h"
 #include "app_util.h"
 #include "wimoto.h"
+#include "wimoto_evt.h"
+#include "wimoto_hvx.h"
 #include "wimoto_sensors.h"
 
 bool     	   TEMPS_CONNECTED_STATE=false;  /*Indicates whether the temperature service is connected or not*/
-extern bool  CHECK_ALARM_TIMEOUT;
 extern       uint8_t	 var_receive_uuid;						/*variable to receive uuid*/
 extern       uint8_t temperature[2];                /*variable to store current temperature value to broadcast*/
 bool  			 temp_alarm_set_changed = false;
 
 bool     				m_temps_alarm_ind_conf_pending = false;       /**< Flag to keep track of when an indication confirmation is pending. */
-extern bool     m_lights_alarm_ind_conf_pending;
-extern bool     m_soils_alarm_ind_conf_pending;
+bool     				TEMPS_READ_PENDING = false;       /**< Flag to keep track of when a read of the current temperature waits for a measurement. */
 
 /**@brief Function for handling the Connect event.
 *
@@ -46,7 +46,7 @@ static void on_connect(ble_temps_t * p_temps, ble_evt_t * p_ble_evt)
 {
     p_temps->conn_handle = p_ble_evt->evt.gap_evt.conn_handle;
     TEMPS_CONNECTED_STATE = true;  /*Set the flag to true so that state remains in connectable mode until disconnect*/
-		CHECK_ALARM_TIMEOUT = true;    /* set the flag to check the alarm condiction on connection*/
+		wimoto_evt_post(WIMOTO_EVT_ALARM_CHECK); /*check the alarm conditions on connection*/
 }
 
 
@@ -63,6 +63,27 @@ static void on_disconnect(ble_temps_t * p_temps, ble_evt_t * p_ble_evt)
 }
 
 
+/**@brief Function for handling the Read/Write Authorization Request event.
+*
+* @details A read of the current temperature is answered by ble_temps_current_read_reply() once the main loop
+*          has taken a new measurement.
+*
+* @param[in]   p_temps     Temperature Service structure.
+* @param[in]   p_ble_evt   Event received from the BLE stack.
+*/
+static void on_rw_authorize_request(ble_temps_t * p_temps, ble_evt_t * p_ble_evt)
+{
+    ble_gatts_evt_rw_authorize_request_t * p_auth_req = &p_ble_evt->evt.gatts_evt.params.authorize_request;
+
+    if ((p_auth_req->type == BLE_GATTS_AUTHORIZE_TYPE_READ) &&
+        (p_auth_req->request.read.handle == p_temps->current_temp_handles.value_handle))
+    {
+        TEMPS_READ_PENDING = true;
+        wimoto_evt_post(WIMOTO_EVT_READ_SENSORS);    /* the measurement is taken from the main loop*/
+    }
+}
+
+
 /**@brief Function for handling write events on values.
 *
 * @details This function will be called for all write events of temperature low, high values and alarm set 
@@ -70,7 +91,7 @@ static void on_disconnect(ble_temps_t * p_temps, ble_evt_t * p_ble_evt)
 */
 static void write_evt_handler(void)
 {   
-    CHECK_ALARM_TIMEOUT = true; 
+    wimoto_evt_post(WIMOTO_EVT_ALARM_CHECK);
 }
 
 static void on_temps_evt(ble_temps_t * p_temps, ble_temps_alarm_evt_t *p_evt)
@@ -309,11 +330,16 @@ void ble_temps_on_ble_evt(ble_temps_t * p_temps, ble_evt_t * p_ble_evt)
 
     case BLE_GAP_EVT_DISCONNECTED:
 				m_temps_alarm_ind_conf_pending = false;													//Clear pending confirmation flag if a disconnect occurs
+				TEMPS_READ_PENDING = false;
         on_disconnect(p_temps, p_ble_evt);
         break;
 
     case BLE_GATTS_EVT_WRITE:
         on_write(p_temps, p_ble_evt);
+        break;
+
+    case BLE_GATTS_EVT_RW_AUTHORIZE_REQUEST:
+        on_rw_authorize_request(p_temps, p_ble_evt);
         break;
 		case BLE_GATTS_EVT_HVC:    //Handle Value Confirmation event
             on_hvc(p_temps, p_ble_evt);
@@ -368,7 +394,7 @@ static uint32_t current_temperature_char_add(ble_temps_t * p_temps, const ble_te
     attr_md.read_perm  = p_temps_init->temperature_char_attr_md.read_perm;
     attr_md.write_perm = p_temps_init->temperature_char_attr_md2.write_perm;
     attr_md.vloc       = BLE_GATTS_VLOC_USER;
-    attr_md.rd_auth    = 0;
+    attr_md.rd_auth    = 1;                                   /* the value is measured when a client reads it*/
     attr_md.wr_auth    = 0;
     attr_md.vlen       = 0;
 
@@ -793,7 +819,7 @@ uint32_t ble_temps_level_alarm_check(ble_temps_t * p_temps,ble_device_t *p_devic
             hvx_params.p_len    = &len1;
             hvx_params.p_data   = current_temperature_array;
 
-            err_code = sd_ble_gatts_hvx(p_temps->conn_handle, &hvx_params);
+            err_code = wimoto_hvx_send(p_temps->conn_handle, &hvx_params);
 						previous_temperature = current_temperature;
         }
         else
@@ -825,25 +851,13 @@ uint32_t ble_temps_level_alarm_check(ble_temps_t * p_temps,ble_device_t *p_devic
         if(current_temperature_float < temperature_user_low_value_float)
         {   
             alarm[0] = SET_ALARM_LOW;												/*set alarm to 01 if temperature is low */
-						alarm[1] = p_device->device_time_stamp_set[0];	/*capture the timestamp when alarm occured*/
-						alarm[2] = p_device->device_time_stamp_set[1];
-						alarm[3] = p_device->device_time_stamp_set[2];
-						alarm[4] = p_device->device_time_stamp_set[3];
-						alarm[5] = p_device->device_time_stamp_set[4];
-						alarm[6] = p_device->device_time_stamp_set[5];
-						alarm[7] = p_device->device_time_stamp_set[6];
+						ble_time_stamp_encode(&alarm[1]);	/*capture the timestamp when alarm occured*/
         }
 
         else if(current_temperature_float > temperature_user_high_value_float)
         {   
             alarm[0] = SET_ALARM_HIGH;											/*set alarm to 02 if temperature is high */
-						alarm[1] = p_device->device_time_stamp_set[0];	/*capture the timestamp when alarm occured*/
-						alarm[2] = p_device->device_time_stamp_set[1];
-						alarm[3] = p_device->device_time_stamp_set[2];
-						alarm[4] = p_device->device_time_stamp_set[3];
-						alarm[5] = p_device->device_time_stamp_set[4];
-						alarm[6] = p_device->device_time_stamp_set[5];
-						alarm[7] = p_device->device_time_stamp_set[6];
+						ble_time_stamp_encode(&alarm[1]);	/*capture the timestamp when alarm occured*/
         } 
      
     }
@@ -866,7 +880,7 @@ uint32_t ble_temps_level_alarm_check(ble_temps_t * p_temps,ble_device_t *p_devic
     if((alarm[0]!= 0x00)&&(p_temps->temperature_alarm_set == 0x01))  	/*check whether the alarm sets as non zero or alarm set characteristics set as zero*/
     {	
 				//check whether the confirmation for indication is not pending
-        if((!m_temps_alarm_ind_conf_pending)&&(!m_lights_alarm_ind_conf_pending)&&(!m_soils_alarm_ind_conf_pending))
+        if(!m_temps_alarm_ind_conf_pending)
 				{
         // Send value if connected and notifying
 
@@ -882,7 +896,7 @@ uint32_t ble_temps_level_alarm_check(ble_temps_t * p_temps,ble_device_t *p_devic
             hvx_params.p_len    = &len;
             hvx_params.p_data   = alarm;
 
-            err_code = sd_ble_gatts_hvx(p_temps->conn_handle, &hvx_params);
+            err_code = wimoto_hvx_send(p_temps->conn_handle, &hvx_params);
 						p_temps->temps_alarm_with_time_stamp[0] = alarm[0];
 						if(err_code == NRF_SUCCESS)
 						{
@@ -901,7 +915,43 @@ uint32_t ble_temps_level_alarm_check(ble_temps_t * p_temps,ble_device_t *p_devic
 }
 
 
-/**@brief Function to read temperature from tmp102.
+/**@brief Function for answering a pending read of the current temperature.
+*
+* @details The application calls this function from the main loop after a read of the current
+*          temperature was requested.
+*
+* @param[in]   p_temps    Temperature Service structure.
+*
+* @return      NRF_SUCCESS on success, NRF_ERROR_INVALID_STATE if no read is pending, otherwise an error code.
+*/
+uint32_t ble_temps_current_read_reply(ble_temps_t * p_temps)
+{
+    ble_gatts_rw_authorize_reply_params_t auth_reply;
+    uint16_t                              current_value;
+    uint8_t                               current_value_array[2];
+
+    if (!TEMPS_READ_PENDING)
+    {
+        return NRF_ERROR_INVALID_STATE;
+    }
+    TEMPS_READ_PENDING = false;
+
+    current_value          = read_temperature();
+    current_value_array[0] = current_value >> 8;
+    current_value_array[1] = (uint8_t)(current_value & LOWER_BYTE_MASK);
+
+    memset(&auth_reply, 0, sizeof(auth_reply));
+
+    auth_reply.type                    = BLE_GATTS_AUTHORIZE_TYPE_READ;
+    auth_reply.params.read.gatt_status = BLE_GATT_STATUS_SUCCESS;
+    auth_reply.params.read.len         = sizeof(current_value_array);
+    auth_reply.params.read.p_data      = current_value_array;       /* the stack copies the value to the characteristic*/
+
+    return sd_ble_gatts_rw_authorize_reply(p_temps->conn_handle, &auth_reply);
+}
+
+
+/**@brief Function to read temperature from tmp102, as acquired by wimoto_sensors_acquire().
 *
 * @param[in]   void
 * @param[out]   uint16_t current_temperature.
@@ -910,9 +960,7 @@ uint16_t read_temperature()
 {
     uint16_t current_temperature;
 
-    twi_turn_ON();
-    current_temperature =get_tmp102_oneshot_temp();
-    twi_turn_OFF();
+    current_temperature =wimoto_sensors_sample()->temperature;
 		return current_temperature;
 }	
 
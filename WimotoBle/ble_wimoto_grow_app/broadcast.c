@@ -251,7 +251,7 @@ void do_temperature_measurement(uint8_t *buffer)
 {
     uint16_t current_temperature;
 
-    current_temperature = get_tmp102_oneshot_temp();        /* Read temperature from tmp102 in one shot mode*/
+    current_temperature = wimoto_sensors_sample()->temperature; /* Temperature from tmp102 in one shot mode*/
     buffer[1]           = current_temperature & 0x00FF;     /* Convert the 16 bit temperature variable to unit8 array */
     buffer[0]           = current_temperature >>8;
 
@@ -260,7 +260,7 @@ void do_temperature_measurement(uint8_t *buffer)
 void do_light_measurement(uint8_t *buffer) 
 {
     uint16_t current_light;
-    current_light      = ISL29023_get_one_time_ALS();       /* Read Light level from isl2903sensor*/
+    current_light      = wimoto_sensors_sample()->light_level; /* Light level from isl2903sensor*/
 
     buffer[1]          = current_light & 0x00FF;            /* Convert the 16 bit light value to unit8 array */
     buffer[0]          = current_light >>8;
@@ -295,6 +295,8 @@ static void advertising_init()
     ble_advdata_manuf_data_t   manuf_specific_data;
     uint8_t                    manuf_data_array[5];
 
+    (void)wimoto_sensors_acquire();                             /* Sample all the sensors at once */
+
     do_temperature_measurement(temperature);                    /* Read temperature */
 
     do_light_measurement(light_level);                          /* Read light from ISL29023 sensor*/
@@ -23,14 +23,13 @@ uint8_t ISL29023_read_register(uint8_t base_address)
     uint8_t data_buffer[1];
     data_buffer[0] = 0xFF;    /* Initializing data buffer */
 
-    if (twi_master_transfer (ISL29023_ADDRESS ,(uint8_t*)&base_address,1,TWI_ISSUE_STOP))
-    {
-
-        if (twi_master_transfer (ISL29023_ADDRESS | TWI_READ_BIT ,data_buffer ,1 ,TWI_ISSUE_STOP))
-        {
-            return  data_buffer[0];	
-        }
+    twi_master_xfer_t  xfers[2] = {{ISL29023_ADDRESS ,&base_address ,1 ,TWI_ISSUE_STOP},
+                                   {ISL29023_ADDRESS | TWI_READ_BIT ,data_buffer ,1 ,TWI_ISSUE_STOP}};
+    twi_master_chain_t chain    = {xfers ,2 ,NULL};
 
+    if (twi_master_chain_run(&chain))
+    {
+        return  data_buffer[0];	
     }
 
     return 0;
@@ -97,28 +96,56 @@ bool ISL29023_config_FSR_and_powerdown(void)
 }
 
 /**
-*@brief   Function to enable One time Ambient Light Sensing mode
+*@brief   Function to start One time Ambient Light Sensing mode without waiting for the conversion
 *@details 1.it will start ADC conversion with light sensing. It will go to the power-down mode 
 *             automatically  after one conversion is finished and keep the conversion data available 
 *             in data registers
-*         2.Returns the 16 bit value in the data register after the light sensing and conversion
-*              has been finished
+*         2.The result is read with ISL29023_collect_ALS() after ISL29023_ALS_CONVERSION_MS
+*         3.Returns a true value if the conversion has started
 */
-uint16_t ISL29023_get_one_time_ALS()
+bool ISL29023_trigger_one_time_ALS(void)
 {
-    uint8_t data_reg_LSB = 0 ,data_reg_MSB = 0 ,reg_content;
-    uint32_t combined_val;
+    uint8_t reg_content;
 
     ISL29023_write_to_reg (ISL29023_COMMAND_REG_1 , ISL29023_ENABLE_ALS_ONCE);
     reg_content = ISL29023_read_register (ISL29023_COMMAND_REG_1);
 
-    if (reg_content & ISL29023_ENABLE_ALS_ONCE) 
+    return ((reg_content & ISL29023_ENABLE_ALS_ONCE) != 0);
+}
+
+/**
+*@brief   Function to read the result of the conversion started by ISL29023_trigger_one_time_ALS()
+*@details Returns the 16 bit value in the data register, 0 on failure
+*/
+uint16_t ISL29023_collect_ALS(void)
+{
+    uint8_t data_reg_LSB = 0 ,data_reg_MSB = 0;
+    uint8_t lsb_address = ISL29023_DATA_REG_LSB ,msb_address = ISL29023_DATA_REG_MSB;
+    twi_master_xfer_t  xfers[4] = {{ISL29023_ADDRESS ,&lsb_address ,1 ,TWI_ISSUE_STOP},
+                                   {ISL29023_ADDRESS | TWI_READ_BIT ,&data_reg_LSB ,1 ,TWI_ISSUE_STOP},
+                                   {ISL29023_ADDRESS ,&msb_address ,1 ,TWI_ISSUE_STOP},
+                                   {ISL29023_ADDRESS | TWI_READ_BIT ,&data_reg_MSB ,1 ,TWI_ISSUE_STOP}};
+    twi_master_chain_t chain    = {xfers ,4 ,NULL};
+
+    if (!twi_master_chain_run(&chain))                    /* Least and Most Significant Bytes of Data Register in one go */
+    {
+        return 0;
+    }
+    return ((data_reg_MSB << 8) | data_reg_LSB);          /* Return two 8 bit data as a 16 bit data         */
+}
+
+/**
+*@brief   Function to enable One time Ambient Light Sensing mode
+*@details 1.Starts the conversion and waits for it
+*         2.Returns the 16 bit value in the data register after the light sensing and conversion
+*              has been finished
+*/
+uint16_t ISL29023_get_one_time_ALS()
+{
+    if (ISL29023_trigger_one_time_ALS()) 
     {  
-        delay_ms(90);                                     /* Integration time required for 16bit conversion */		
-        data_reg_LSB =   ISL29023_read_register (ISL29023_DATA_REG_LSB); /* Least Significant Byte of Data Register        */
-        data_reg_MSB =   ISL29023_read_register (ISL29023_DATA_REG_MSB); /* Most Significant Byte of Data Register         */ 
-        combined_val = ((data_reg_MSB << 8) | data_reg_LSB);
-        return combined_val;                                        /* Return two 8 bit data as a 16 bit data         */  
+        delay_ms(ISL29023_ALS_CONVERSION_MS);             /* Integration time required for 16bit conversion */
+        return ISL29023_collect_ALS();
     } 
 
     return 0;		                                             /* On failure return 0                            */
@@ -29,20 +29,19 @@ int16_t read_register_content(uint8_t base_Address)
     int16_t temporary_variable1 = 0;
     /* Data buffer to receive the data from temperature register                        */
     uint8_t data_buffer[2];    
+    /* Write the base address of temperature register to pointer register, then         */
+    /* receive the 16 bit data from the temperature register and store in an array      */
+    twi_master_xfer_t  xfers[2] = {{TMP102_ADDRESS ,&base_Address ,1 ,TWI_ISSUE_STOP},
+                                   {TMP102_ADDRESS | TWI_READ_BIT ,data_buffer ,2 ,TWI_ISSUE_STOP}};
+    twi_master_chain_t chain    = {xfers ,2 ,NULL};
 
-    /* Write the base address of temperature register to pointer register               */
-    if (twi_master_transfer(TMP102_ADDRESS ,(uint8_t*)&base_Address,1,TWI_ISSUE_STOP))
+    if (twi_master_chain_run(&chain))
     {
-        /* Receive the 16 bit data from the temperature register and store in an array  */				
-        if (twi_master_transfer(TMP102_ADDRESS |TWI_READ_BIT ,data_buffer,2,TWI_ISSUE_STOP))
-        {
-            /* The two 8 bit array is converted into a 16 bit variable                  */						
-            temporary_variable1 =    0;
-            temporary_variable1 = (((data_buffer[0]) << 8) & 0xFF00); 
-            temporary_variable2 =    data_buffer[1];
-            temporary_variable1 =   (temporary_variable1 | temporary_variable2); 	
-
-        }
+        /* The two 8 bit array is converted into a 16 bit variable                      */
+        temporary_variable1 =    0;
+        temporary_variable1 = (((data_buffer[0]) << 8) & 0xFF00); 
+        temporary_variable2 =    data_buffer[1];
+        temporary_variable1 =   (temporary_variable1 | temporary_variable2); 	
 
     }
 
@@ -135,23 +134,14 @@ bool config_tmp102_shutdown_mode (void)
 
 
 /**
-* @brief   This function returns the  temperature value to the calling function  using 
-*          one-shot  mode.  By writing '1' to the OS bit in  configuration  register 
-*          whenever temperature is needed.
+* @brief   This function starts a one-shot conversion without waiting for it, by 
+*          writing '1' to the OS bit in  configuration  register.
 *@features 1. Performs a write operation to the configuration register setting the 
 *             OS (ONE-SHOT) bit as '1' (setting TMP102 in ONE-SHOT MODE).
-*          2. Reads the configuration register 
-*									if OS = 0 , conversion not completed
-*										 OS = 1 , conversion complete 
-*							verify that conversion is complete.
-*          3. Read temperature register value , since it is in 12 bit format (lower 4   
-*             bits of Most Significant Byte is 0) the value is right shifted 4 times. 
-*          4. Returns the temperature value.
+*          2. Returns a true value if the conversion has started.
 */
-uint16_t get_tmp102_oneshot_temp (void)
+bool tmp102_trigger_oneshot_temp (void)
 {
-
-		int16_t tmp102_configuration_reg_val, tmp102_temperature_reg_val = 0;
     uint8_t data_buffer[3];
      
     data_buffer[0]      = TMP102_CONFIG_REG ;  /* Select configuration register             */
@@ -161,33 +151,58 @@ uint16_t get_tmp102_oneshot_temp (void)
 
     data_buffer[2]      = TMP102_CONFIG_REG_DEFAULT_LSB; /* Default Least Significant Byte  */
 
-
-
     /* Start one-shot conversion by writing OS =1                                           */
-    if (twi_master_transfer(TMP102_ADDRESS ,(uint8_t*)data_buffer,3,TWI_ISSUE_STOP))
-    {
-        delay_ms(30);    /*26 ms delay required for  one shot temperature conversion*/ 
-        tmp102_configuration_reg_val = read_register_content (TMP102_CONFIG_REG);
-        tmp102_configuration_reg_val = (tmp102_configuration_reg_val & 0x8000);
+    return twi_master_transfer(TMP102_ADDRESS ,(uint8_t*)data_buffer,3,TWI_ISSUE_STOP);
+}
 
 
-        /* Check if OS=1 or not. If OS=1, the conversion is complete                    */
-        if ((tmp102_configuration_reg_val) != 0)
-        {
-            tmp102_temperature_reg_val = read_register_content (TMP102_TEMP_REG);	
+/**
+*@brief    This function reads the temperature of the one-shot conversion started by
+*          tmp102_trigger_oneshot_temp(), at least TMP102_CONVERSION_MS later.
+*@features 1. Reads the configuration register 
+*									if OS = 0 , conversion not completed
+*										 OS = 1 , conversion complete 
+*							verify that conversion is complete.
+*          2. Read temperature register value , since it is in 12 bit format (lower 4   
+*             bits of Most Significant Byte is 0) the value is right shifted 4 times. 
+*          3. Returns the temperature value, 0 if the conversion has not completed.
+*/
+uint16_t tmp102_collect_oneshot_temp (void)
+{
+		int16_t tmp102_configuration_reg_val, tmp102_temperature_reg_val = 0;
 
-            /* Remove four '0' bits in the Least Significant Byte                       */
-            tmp102_temperature_reg_val = ((tmp102_temperature_reg_val >> 4) & 0x0FFF);
+    tmp102_configuration_reg_val = read_register_content (TMP102_CONFIG_REG);
+    tmp102_configuration_reg_val = (tmp102_configuration_reg_val & 0x8000);
 
-            /* Can be used to identify temperature while debugging                      */
-            /*temperature_in_celsius = (float)tmp102_temperature_reg_val * 0.0625;*/
-        }
+    /* Check if OS=1 or not. If OS=1, the conversion is complete                            */
+    if ((tmp102_configuration_reg_val) != 0)
+    {
+        tmp102_temperature_reg_val = read_register_content (TMP102_TEMP_REG);	
+
+        /* Remove four '0' bits in the Least Significant Byte                               */
+        tmp102_temperature_reg_val = ((tmp102_temperature_reg_val >> 4) & 0x0FFF);
 
+        /* Can be used to identify temperature while debugging                              */
+        /*temperature_in_celsius = (float)tmp102_temperature_reg_val * 0.0625;*/
     }
 
     return tmp102_temperature_reg_val ;
+}
+
 
+/**
+*@brief    This function reads temperature using one-shot mode, it starts the conversion
+*          and waits TMP102_CONVERSION_MS for it.
+*/
+uint16_t get_tmp102_oneshot_temp (void)
+{
+    if (tmp102_trigger_oneshot_temp())
+    {
+        delay_ms(TMP102_CONVERSION_MS);    /*26 ms delay required for  one shot temperature conversion*/ 
+        return tmp102_collect_oneshot_temp();
+    }
 
+    return 0;
 }
 
 
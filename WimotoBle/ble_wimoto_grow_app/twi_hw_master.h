@@ -0,0 +1,77 @@
+/** @file
+ *
+ * @brief Interrupt driven additions to the TWI master driver (twi_master.h).
+ *
+ * @details Transfers run from the TWI1 interrupt, out of a queue of transaction chains. The
+ *          queued chains run back-to-back in one powered window: TWI1 is powered up for the
+ *          first transfer and gated off once the queue has drained. twi_master_transfer() keeps
+ *          its blocking behaviour, it queues a single transfer and sleeps in sd_app_evt_wait()
+ *          until it is done, so it must only be called from main context. Once
+ *          twi_master_timeout_init() has been called, a chain which doesn't complete in time is
+ *          given up as failed, and TWI1 is recovered.
+ */
+
+#ifndef TWI_HW_MASTER_H__
+#define TWI_HW_MASTER_H__
+
+#include <stdbool.h>
+#include <stdint.h>
+#include "twi_master.h"
+
+/**@brief One transfer of a transaction chain, the fields are the twi_master_transfer() arguments. */
+typedef struct
+{
+    uint8_t                     address;                /**< Slave address, with TWI_READ_BIT set for a read. */
+    uint8_t *                   p_data;                 /**< Data to send or buffer to receive into. */
+    uint8_t                     data_length;            /**< Number of bytes, must not be 0. */
+    bool                        issue_stop_condition;   /**< Send a STOP after a write, reads always end with one. */
+} twi_master_xfer_t;
+
+typedef struct twi_master_chain_s twi_master_chain_t;
+
+/**@brief Transaction chain completion handler type, called from the TWI1 interrupt. */
+typedef void (*twi_master_chain_handler_t) (twi_master_chain_t * p_chain, bool chain_succeeded);
+
+/**@brief Transaction chain. The transfers run back-to-back and the chain stops at the first one
+ *        which fails. The chain and its buffers belong to the queue until it has completed.
+ */
+struct twi_master_chain_s
+{
+    const twi_master_xfer_t *   p_xfers;                /**< Transfers of the chain. */
+    uint8_t                     xfer_count;             /**< Number of transfers. */
+    twi_master_chain_handler_t  handler;                /**< Completion handler, may be NULL. */
+    twi_master_chain_t *        p_next;                 /**< Next chain in the queue, used by the driver. */
+    volatile bool               queued;                 /**< The chain is waiting or being transferred. */
+    bool                        succeeded;              /**< All transfers of the completed chain succeeded. */
+};
+
+/**@brief Function for queueing a transaction chain.
+ *
+ * @param[in]  p_chain  Chain to transfer, p_xfers, xfer_count and handler must be set.
+ *
+ * @return     NRF_SUCCESS, or NRF_ERROR_INVALID_PARAM if the chain is empty or still queued.
+ */
+uint32_t twi_master_chain_enqueue(twi_master_chain_t * p_chain);
+
+/**@brief Function for creating the timer which gives up a chain that doesn't complete.
+ *
+ * @details Call once after APP_TIMER_INIT(). Until then chains are not timed, which is the case
+ *          in broadcast mode.
+ *
+ * @param[in]  prescaler  Value of the RTC1 PRESCALER register.
+ *
+ * @return     NRF_SUCCESS, or the error code of app_timer_create().
+ */
+uint32_t twi_master_timeout_init(uint32_t prescaler);
+
+/**@brief Function for transferring a chain and waiting for it, from main context only.
+ *
+ * @return     true if all the transfers of the chain succeeded.
+ */
+bool twi_master_chain_run(twi_master_chain_t * p_chain);
+
+/**@brief Function for checking whether the queue has chains to transfer.
+ */
+bool twi_master_busy(void);
+
+#endif // TWI_HW_MASTER_H__
@@ -20,7 +20,7 @@
 /********************************************************************************************/
 #include <stdbool.h>
 #include <stdint.h>
-#include "twi_master.h"
+#include "twi_hw_master.h"
 #include "nrf.h"
 #include "nrf_delay.h"
 #include "nrf_gpio.h"
@@ -52,12 +52,15 @@
 #define TMP102_CONFIG_REG_DEFAULT_LSB         0xA0   /**< Default value of Least Significant Byte of Configuration register                          */
 #define TMP102_ENABLE_SD_BIT_IN_MSB           0x01   /**< Enable SD (Shut-Down) bit (used only with Most Significant Byte of Configuration Register) */ 																						                                          
 #define TMP102_ENABLE_OS_BIT_IN_MSB           0x80   /**< Enable OS (One-Shot) bit (used only with Most Significant Byte of Configuration Register)  */
+#define TMP102_CONVERSION_MS                  30     /**< One-shot conversion time, 26 ms and a margin                                               */
 																								                                            
 
 /**< Functions   */
 /*Public Functions*/
 bool      config_tmp102_shutdown_mode  (void);                     /**< Enable shut-down mode               */  
 uint16_t  get_tmp102_oneshot_temp      (void);                     /**< Get temperature using one-shot mode */          
+bool      tmp102_trigger_oneshot_temp  (void);                     /**< Start a one-shot conversion without waiting for it */
+uint16_t  tmp102_collect_oneshot_temp  (void);                     /**< Read the temperature of a finished one-shot conversion */
 
 /*Private Functions*/
 int16_t   read_register_content        (uint8_t);                  /**< Read contents of a data register    */
@@ -101,8 +104,6 @@ bool      write_to_register            (uint8_t,uint8_t,uint8_t);  /**< Write da
 /**< Functions      */
 /*Public Functions  */
 bool      TMP006_enable_powerdown_mode(void);     /**< Enable power down mode */
-uint32_t  TMP006_get_onetime_data(void);          /**< Enable continuous conversion mode then read contents of V-object & T-ambient  
-                                                       registers one time and reconfigure TMP006 in power down mode */																									 
 float     TMP006_readDieTempC(void);              /**< Calculate sensor temperature based on raw reading */
 float     TMP006_ObjTempC_conversion(void);       /**< Calculate object temperature based on raw sensor temp and thermopile voltage */
 void      do_thermopile_measurement(uint8_t*, float*);
@@ -149,11 +150,14 @@ uint16_t  TMP006_read_register(uint8_t base_address);       /**< Read the data f
 #define ISL29023_USE_16K_LUX_FSR                0x02  /**< Configure FSR of LUX as 16000 */
 #define ISL29023_USE_4K_LUX_FSR                 0x01  /**< Configure FSR of LUX as 4000 */
 #define ISL29023_USE_1K_LUX_FSR                 0x00  /**< Configure FSR of LUX as 1000 */
+#define ISL29023_ALS_CONVERSION_MS              90    /**< Integration time required for 16bit conversion */
  
 /**< Functions   */
 /*Public Functions*/
 bool          ISL29023_config_FSR_and_powerdown(void); /**< Configure the FSR reading of ISL29023 and enable power down mode*/
 uint16_t      ISL29023_get_one_time_ALS(void);         /**< Get the content of data registers using ALS once mode*/
+bool          ISL29023_trigger_one_time_ALS(void);     /**< Start an ALS once conversion without waiting for it*/
+uint16_t      ISL29023_collect_ALS(void);              /**< Read the data registers after an ALS once conversion*/
 
 /*Private Functions */
 uint8_t       ISL29023_read_register(uint8_t);         /**< Read data of register of ISL29023 */
@@ -322,6 +326,27 @@ int     one_mhz_start(void);                                             /**< St
 int     one_mhz_stop(void);																							/**< Stop 1Mhz wave*/
 
 
+/*------------------------------------------------------------------------------------------*/
+/* ACQUISITION PIPELINE														  		    */
+/*------------------------------------------------------------------------------------------*/
+/**
+*@Brief   Two-phase acquisition of the TMP102 and ISL29023 sensors
+*@Featurs 1. Starts the conversions of all the sensors at once (trigger phase)
+*         2. Sleeps until the slowest conversion has finished and reads all the results (collect phase)
+*/
+
+/**< Types        */
+typedef struct
+{
+    uint16_t temperature;                                                /**< TMP102 one-shot temperature */
+    uint16_t light_level;                                                /**< ISL29023 data registers in ALS once mode */
+} wimoto_sensors_sample_t;
+
+/**< Functions   */
+const wimoto_sensors_sample_t * wimoto_sensors_acquire(void);            /**< Acquire a new sample of all the sensors */
+const wimoto_sensors_sample_t * wimoto_sensors_sample(void);             /**< Latest sample of all the sensors */
+
+
 /********************************************************************************************/ 
 /* MODULE END*/
 /********************************************************************************************/
@@ -23,22 +23,20 @@
 #include "ble_srv_common.h"
 #include "app_util.h"
 #include "wimoto.h"
+#include "wimoto_evt.h"
+#include "wimoto_hvx.h"
 #include "wimoto_sensors.h"
 #include "ble_accelerometer_alarm_service.h"
 #include "app_error.h"
 
-extern   bool       	MOVEMENT_EVENT_FLAG;
-extern   bool 	      CLEAR_MOVE_ALARM;
 extern   uint8_t      movement_gpio_pin_val;
 bool 					        ACCELEROMETER_CONNECTED_STATE=false; /*Indicates whether the movement service is connected or not*/
 				 uint8_t      current_xyz_array[3];                /* Read value of X Y Z data*/
 extern   uint8_t	    var_receive_uuid;						/*variable to receive uuid*/
 extern 	 uint32_t     xyz_coordinates;           /*accelerometer value for broadcast*/
 static    uint8_t 		movement_alarm[8]= {0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00}; /*movement alarm with timestamp*/
-extern   bool         CENTRAL_DEVICE_CONNECTED;
 
 bool     							m_movement_alarm_ind_conf_pending = false;       /**< Flag to keep track of when an indication confirmation is pending. */
-extern bool     			m_pir_alarm_ind_conf_pending;
 /**@brief Function for handling the Connect event.
 *
 * @param[in]   p_movement  Movement Service structure.
@@ -48,7 +46,7 @@ static void on_connect(ble_movement_t * p_movement, ble_evt_t * p_ble_evt)
 {
     p_movement->conn_handle = p_ble_evt->evt.gap_evt.conn_handle;
     ACCELEROMETER_CONNECTED_STATE = true;   /*Set the flag to true so that state remains in connectable mode until disconnect*/
-		CENTRAL_DEVICE_CONNECTED  = true;
+		wimoto_evt_post(WIMOTO_EVT_CENTRAL_CONNECTED);
 }
 
 
@@ -78,22 +76,14 @@ static void write_evt_handler (ble_movement_t * p_movement, ble_movement_write_e
     case BLE_MOVEMENT_ALARM_SET_WRITE:
         if(p_movement->movement_alarm_set != 0x00)
         {
-            MOVEMENT_EVENT_FLAG = true;
-        }
-        else
-        {
-            MOVEMENT_EVENT_FLAG = false;
+            wimoto_evt_post(WIMOTO_EVT_MOVEMENT);
         }
         break;
     case BLE_MOVEMENT_ALARM_CLEAR_WRITE:
 
         if(p_movement-> movement_alarm_clear!= 0x00)
         {
-            CLEAR_MOVE_ALARM = true;
-        }
-        else
-        {
-            CLEAR_MOVE_ALARM = false;
+            wimoto_evt_post(WIMOTO_EVT_CLEAR_MOVE_ALARM);
         }
         break;
     default:
@@ -686,16 +676,12 @@ uint32_t ble_movement_alarm_check(ble_movement_t * p_movement,ble_device_t *p_de
     uint16_t len = sizeof(movement_alarm);		//length of the time stamp with alarm
     uint16_t len1 = sizeof(current_xyz_array);
 
-    twi_turn_ON();
-
-
     if(false == MMA7660_read_xyz_reg_one_time(&current_xyz))
 			return false;
 
 		//copy the current accelerometer value for broadcast
 		xyz_coordinates=current_xyz;
 
-		twi_turn_OFF();
     current_xyz_array[0] = current_xyz;
     current_xyz_array[1] = current_xyz >> 8;
     current_xyz_array[2] = current_xyz >> 16;
@@ -714,7 +700,7 @@ uint32_t ble_movement_alarm_check(ble_movement_t * p_movement,ble_device_t *p_de
         hvx_params.p_len    = &len1;
         hvx_params.p_data   = current_xyz_array;
 
-        err_code = sd_ble_gatts_hvx(p_movement->conn_handle, &hvx_params);
+        err_code = wimoto_hvx_send(p_movement->conn_handle, &hvx_params);
 
     }
     else
@@ -728,13 +714,7 @@ uint32_t ble_movement_alarm_check(ble_movement_t * p_movement,ble_device_t *p_de
         if (movement_gpio_pin_val == MOVEMENT)
         {
             movement_alarm[0] = SET_ALARM_FOR_MOVEMENT;
-						movement_alarm[1] = p_device->device_time_stamp_set[0];					/*capture the timestamp when alarm occured*/
-						movement_alarm[2] = p_device->device_time_stamp_set[1];
-						movement_alarm[3] = p_device->device_time_stamp_set[2];
-						movement_alarm[4] = p_device->device_time_stamp_set[3];
-						movement_alarm[5] = p_device->device_time_stamp_set[4];
-						movement_alarm[6] = p_device->device_time_stamp_set[5];
-						movement_alarm[7] = p_device->device_time_stamp_set[6];
+						ble_time_stamp_encode(&movement_alarm[1]);	/*capture the timestamp when alarm occured*/
             movement_gpio_pin_val = 0x01;
         }
 
@@ -742,7 +722,7 @@ uint32_t ble_movement_alarm_check(ble_movement_t * p_movement,ble_device_t *p_de
 				// Send value if connected and notifying
 				if(movement_alarm[0]!= 0x00)																			/*Sent alarm*/
 			  {		
-					 if((!m_pir_alarm_ind_conf_pending)&&(!m_movement_alarm_ind_conf_pending))   /*check whether the confirmation for indication is pending*/
+					 if(!m_movement_alarm_ind_conf_pending)   /*check whether the confirmation of the previous alarm is pending*/
 					 {
            if ((p_movement->conn_handle != BLE_CONN_HANDLE_INVALID) && p_movement->is_notification_supported)
            {
@@ -756,7 +736,7 @@ uint32_t ble_movement_alarm_check(ble_movement_t * p_movement,ble_device_t *p_de
                hvx_params.p_len    = &len;
                hvx_params.p_data   = movement_alarm;
 
-               err_code = sd_ble_gatts_hvx(p_movement->conn_handle, &hvx_params);
+               err_code = wimoto_hvx_send(p_movement->conn_handle, &hvx_params);
 						   p_movement->move_alarm_with_time_stamp[0] = movement_alarm[0];
 							 if(err_code == NRF_SUCCESS)
 							 {
@@ -793,7 +773,7 @@ uint32_t reset_alarm(ble_movement_t * p_movement)
 
     p_movement->move_alarm_with_time_stamp[0] = alarm[0];
     p_movement->movement_alarm_clear = clear_alarm;
-		if((!m_pir_alarm_ind_conf_pending)&&(!m_movement_alarm_ind_conf_pending))           /*check whether the confirmation for indication is pending*/
+		if(!m_movement_alarm_ind_conf_pending)           /*check whether the confirmation of the previous alarm is pending*/
 		{
     // Send value if connected and notifying
 
@@ -809,7 +789,7 @@ uint32_t reset_alarm(ble_movement_t * p_movement)
         hvx_params.p_len    = &len1;
         hvx_params.p_data   = alarm;
 
-        err_code = sd_ble_gatts_hvx(p_movement->conn_handle, &hvx_params);
+        err_code = wimoto_hvx_send(p_movement->conn_handle, &hvx_params);
 				if(err_code == NRF_SUCCESS)
 				{
 					m_movement_alarm_ind_conf_pending = true;
@@ -839,7 +819,7 @@ uint32_t reset_alarm(ble_movement_t * p_movement)
         hvx_params.p_len    = &len;
         hvx_params.p_data   = &clear_alarm;
 
-        err_code = sd_ble_gatts_hvx(p_movement->conn_handle, &hvx_params);
+        err_code = wimoto_hvx_send(p_movement->conn_handle, &hvx_params);
     }
     else
     {
@@ -876,7 +856,7 @@ void update_movement_alarmtimestamp_on_connect(ble_movement_t * p_movement,ble_d
 				// Send value if connected and notifying
 				if(movement_alarm[0]!= 0x00)																			/*Sent alarm*/
 			  {		
-					 if((!m_pir_alarm_ind_conf_pending)&&(!m_movement_alarm_ind_conf_pending))  /*check whether the confirmation for indication is pending*/
+					 if(!m_movement_alarm_ind_conf_pending)  /*check whether the confirmation of the previous alarm is pending*/
 					 {
            if ((p_movement->conn_handle != BLE_CONN_HANDLE_INVALID) && p_movement->is_notification_supported)
            {
@@ -890,7 +870,7 @@ void update_movement_alarmtimestamp_on_connect(ble_movement_t * p_movement,ble_d
                hvx_params.p_len    = &len;
                hvx_params.p_data   = movement_alarm;
 
-               err_code = sd_ble_gatts_hvx(p_movement->conn_handle, &hvx_params);
+               err_code = wimoto_hvx_send(p_movement->conn_handle, &hvx_params);
 						   p_movement->move_alarm_with_time_stamp[0] = movement_alarm[0];
 							 if(err_code == NRF_SUCCESS)
 							 {
@@ -925,7 +905,7 @@ void update_movement_alarmtimestamp_on_connect(ble_movement_t * p_movement,ble_d
 							hvx_params.p_len    = &len1;
 							hvx_params.p_data   = current_xyz_array;
 
-							err_code = sd_ble_gatts_hvx(p_movement->conn_handle, &hvx_params);
+							err_code = wimoto_hvx_send(p_movement->conn_handle, &hvx_params);
 
 						}
 						else
@@ -21,6 +21,9 @@
 #include "ble.h"
 #include "ble_srv_common.h"
 #include "ble_date_time.h"
+#include "ble_data_log_service.h"
+
+#define BLE_DEVICE_FLASH_WEAR_LEN   12                                   /**< Length of the flash wear characteristic. */
 
 
 /**@brief Device Management Service event type. */
@@ -86,6 +89,7 @@ typedef struct ble_device_s
     ble_gatts_char_handles_t          mma_switch_handles;            	/**< Handles for Device Firmware Update characteristic. */
     ble_gatts_char_handles_t          dfu_mode_handles;             	/**< Handles for  MMA7660 switching characteristic. */
     ble_gatts_char_handles_t          time_stamp_handles;             /**< Handles for  time stamp characteristic. */
+    ble_gatts_char_handles_t          flash_wear_handles;             /**< Handles for flash wear characteristic. */
     uint8_t												    device_dfu_mode_set;            /**< Device Firmware Update mode set **/
     uint8_t												    device_mma_switch_set;   		  	/**< mma switch set **/
     uint8_t												    device_time_stamp_set[7];       /**< time stamp set **/
@@ -115,29 +119,49 @@ uint32_t ble_device_init(ble_device_t * p_device, const ble_device_init_t * p_de
 */
 void ble_device_on_ble_evt(ble_device_t * p_device, ble_evt_t * p_ble_evt);
 
-/**@brief Function for creating a new time stamp in Device Management Service.
+/**@brief Function for setting the clock to the time set in Device Management Service.
 *
 * @details The application calls this function after the user sets a new time.
 *
 *
 * @param[in]   p_device         Device Management Service structure.
-* @param[in]   p_time_stamp     Time stamp structure.
 *
-* @return      NRF_SUCCESS on success, otherwise an error code.
+* @return      NRF_SUCCESS on success, NRF_ERROR_INVALID_DATA if the user set time is not valid.
+*/
+uint32_t create_time_stamp(ble_device_t * p_device);
+
+/**@brief Function for encoding the current time as the value of the time stamp characteristic.
+*
+* @details Also used by the alarm services to capture the time of an alarm.
+*
+* @param[out]  p_encoded        Buffer of 7 bytes, the year MSB first followed by the month, day,
+*                               hours, minutes and seconds.
+*/
+void ble_time_stamp_encode(uint8_t * p_encoded);
+
+/**@brief Function for notifying the current time to the client.
+*
+* @details The application calls this function from its time keeping timer. Reads of the time
+*          stamp characteristic are answered with the current time by the service itself.
+*
+*
+* @param[in]   p_device         Device Management Service structure.
+*
+* @return      NRF_SUCCESS on success, NRF_ERROR_INVALID_STATE if no client is connected, otherwise an error code.
 */
-void create_time_stamp(ble_device_t * p_device, ble_date_time_t * p_time_stamp);
+uint32_t ble_time_update(ble_device_t * p_device);
 
-/**@brief Function for updating time to the client.
+/**@brief Function for updating the flash wear characteristic.
 *
-* @details The application calls this function after every time update i.e, after every second.
+* @details The application calls this function after the data logger has been used.
 *
 *
 * @param[in]   p_device         Device Management Service structure.
-* @param[in]   p_time_stamp     Time stamp structure.
+* @param[in]   p_wear           Flash wear statistics of the data logger.
 *
 * @return      NRF_SUCCESS on success, otherwise an error code.
 */
-uint32_t ble_time_update(ble_device_t * p_device, ble_date_time_t *p_time_stamp);
+uint32_t ble_flash_wear_update(ble_device_t * p_device, const ble_dlogs_wear_t * p_wear);
 #endif 
 
 /** @} */
@@ -24,17 +24,17 @@
 #include "ble_srv_common.h"
 #include "app_util.h"
 #include "wimoto.h"
+#include "wimoto_evt.h"
+#include "wimoto_hvx.h"
 #include "wimoto_sensors.h"
 #include "ble_pir_alarm_service.h"
 
-extern 		bool        PIR_EVENT_FLAG;               /* Flag to indicate the event occurred on GPIO pin configured for PIR sensor*/
 bool     	        		PIR_CONNECTED_STATE = false;  /* Indicates whether the PIR service is connected or not*/
 extern 		uint8_t			var_receive_uuid;
 extern    uint8_t			curr_pir_presence;            /* water pir value for broadcast*/
 					uint8_t 		pir_alarm[8]= {0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00}; /*global variable for storing pir alarm*/
 bool                  pir_alarm_set_changed = false;
 bool     							m_pir_alarm_ind_conf_pending = false;       /**< Flag to keep track of when an indication confirmation is pending. */
-extern bool     			m_movement_alarm_ind_conf_pending;
 					
 /**@brief Function for handling the Connect event.
 *
@@ -68,7 +68,7 @@ static void on_disconnect(ble_pir_t * p_pir, ble_evt_t * p_ble_evt)
 */
 static void write_evt_handler(void)
 {   
-    PIR_EVENT_FLAG = true; 
+    wimoto_evt_post(WIMOTO_EVT_PIR);
 }
 
 static void on_pir_evt(ble_pir_t * p_pir, ble_pir_alarm_evt_t *p_evt)
@@ -541,7 +541,7 @@ uint32_t ble_pir_alarm_check(ble_pir_t * p_pir,ble_device_t *p_device)
         hvx_params.p_len    = &len;
         hvx_params.p_data   = &current_pir_state;
 
-        err_code = sd_ble_gatts_hvx(p_pir->conn_handle, &hvx_params);
+        err_code = wimoto_hvx_send(p_pir->conn_handle, &hvx_params);
     }
     else 
     {
@@ -557,13 +557,7 @@ uint32_t ble_pir_alarm_check(ble_pir_t * p_pir,ble_device_t *p_device)
         if (current_pir_state == PIR_DETECTION)
         {
             pir_alarm[0] = SET_ALARM_PIR_DETECTION;
-						pir_alarm[1]=p_device->device_time_stamp_set[0];
-						pir_alarm[2]=p_device->device_time_stamp_set[1];
-						pir_alarm[3]=p_device->device_time_stamp_set[2];
-						pir_alarm[4]=p_device->device_time_stamp_set[3];
-						pir_alarm[5]=p_device->device_time_stamp_set[4];
-						pir_alarm[6]=p_device->device_time_stamp_set[5];
-						pir_alarm[7]=p_device->device_time_stamp_set[6];
+						ble_time_stamp_encode(&pir_alarm[1]);	/*capture the timestamp when alarm occured*/
         }
      }		 
     else if(pir_alarm_set_changed)
@@ -583,7 +577,7 @@ uint32_t ble_pir_alarm_check(ble_pir_t * p_pir,ble_device_t *p_device)
 		
      if((pir_alarm[0]!= 0x00)&&(p_pir->pir_alarm_set == 0x01))  	/*check whether the alarm is on or alarmset is set as zero*/
     {	
-				if((!m_pir_alarm_ind_conf_pending)&&(!m_movement_alarm_ind_conf_pending))   /*check whether the confirmation for indication is pending*/
+				if(!m_pir_alarm_ind_conf_pending)   /*check whether the confirmation of the previous alarm is pending*/
 				{
         // Send value if connected and notifying
 
@@ -600,7 +594,7 @@ uint32_t ble_pir_alarm_check(ble_pir_t * p_pir,ble_device_t *p_device)
             hvx_params.p_len    = &len2;
             hvx_params.p_data   = pir_alarm;
 
-            err_code = sd_ble_gatts_hvx(p_pir->conn_handle, &hvx_params);
+            err_code = wimoto_hvx_send(p_pir->conn_handle, &hvx_params);
 						p_pir->pir_alarm_with_time_stamp[0] = pir_alarm[0];
 						if(err_code == NRF_SUCCESS)
 						{
@@ -634,7 +628,7 @@ uint32_t update_pir_alarmtimestamp_on_connect(ble_pir_t * p_pir,ble_device_t *p_
 		
     if((pir_alarm[0]!= 0x00)&&(p_pir->pir_alarm_set == 0x01))  	/*check whether the alarm is on or alarmset is set as zero*/
     {	
-				if((!m_pir_alarm_ind_conf_pending)&&(!m_movement_alarm_ind_conf_pending))   /*check whether the confirmation for indication is pending*/
+				if(!m_pir_alarm_ind_conf_pending)   /*check whether the confirmation of the previous alarm is pending*/
 				{
         // Send value if connected and notifying
 
@@ -650,7 +644,7 @@ uint32_t update_pir_alarmtimestamp_on_connect(ble_pir_t * p_pir,ble_device_t *p_
             hvx_params.p_len    = &len2;
             hvx_params.p_data   = pir_alarm;
 
-            err_code = sd_ble_gatts_hvx(p_pir->conn_handle, &hvx_params);
+            err_code = wimoto_hvx_send(p_pir->conn_handle, &hvx_params);
 						p_pir->pir_alarm_with_time_stamp[0] = pir_alarm[0];
 						if(err_code == NRF_SUCCESS)
 						{
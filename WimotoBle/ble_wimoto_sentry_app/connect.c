@@ -35,6 +35,7 @@
 #include "ble_conn_params.h"
 #include "softdevice_handler.h"
 #include "app_timer.h"
+#include "app_scheduler.h"
 #include "app_gpiote.h"
 #include "app_button.h"
 #include "ble_error_log.h"
@@ -44,6 +45,11 @@
 #include "ble_bas.h"
 #include "wimoto_sensors.h"
 #include "wimoto.h"
+#include "wimoto_format.h"
+#include "wimoto_time.h"
+#include "wimoto_evt.h"
+#include "wimoto_hvx.h"
+#include "twi_hw_master.h"
 #include "ble_device_mgmt_service.h"
 #include "ble_pir_alarm_service.h"
 #include "ble_accelerometer_alarm_service.h"
@@ -69,9 +75,12 @@
 #define APP_TIMER_MAX_TIMERS                 5                                          /**< Maximum number of simultaneously created timers. */
 #define APP_TIMER_OP_QUEUE_SIZE              4                                          /**< Size of timer operation queues. */
 																														 
-#define SENTRY_LEVEL_MEAS_INTERVAL           APP_TIMER_TICKS(60000, APP_TIMER_PRESCALER)/**< sentry level measurement interval (ticks). */
+#define DATA_LOG_TIMER_MAX_SECONDS           480                                        /**< Longest timeout of the data logger timer, the 24 bit RTC1 counter wraps after 512 s (seconds). */
 #define CONNECTED_MODE_TIMEOUT_INTERVAL      APP_TIMER_TICKS(30000, APP_TIMER_PRESCALER)/**< Connected mode timeout interval (ticks). */
 #define SECONDS_INTERVAL                     APP_TIMER_TICKS(1000, APP_TIMER_PRESCALER) /**< seconds measurement interval (ticks). */
+#define TIME_KEEPING_SECONDS                 30                                         /**< Interval of the time keeping timer, shorter than the 512 s wrap of the RTC1 counter (seconds). */
+#define TIME_KEEPING_INTERVAL                APP_TIMER_TICKS(TIME_KEEPING_SECONDS * 1000, APP_TIMER_PRESCALER) /**< Time keeping interval (ticks). */
+#define BATTERY_MEAS_TICKS                   ((BATTERY_MEAS_INTERVAL * 60) / TIME_KEEPING_SECONDS)        /**< Time keeping intervals between battery measurements. */
 #define BROADCAST_INTERVAL       						 APP_TIMER_TICKS(1000, APP_TIMER_PRESCALER) /**< updating interval of broadcast data*/ 
 
 #define WATER_TYPE_AS_CHARACTERISTIC         0                                          /**< Determines if water type is given as characteristic (1) or as a field of measurement (0). */
@@ -123,40 +132,27 @@ static app_timer_id_t                        delay_timer;
 
 app_gpiote_user_id_t 								         pir_measurement_gpiote;                    /**< PIR presence measurement gpiote. */
 app_gpiote_user_id_t 	                       movement_measurement_gpiote;               /**< Movement presence measurement gpiote. */
-ble_date_time_t                              m_time_stamp;                              /**< Time stamp. */
 uint8_t 																		 battery_level=0;                           /**< Battery level variable */
 ble_bas_t                             			 bas;                                       /**< Structure used to identify the battery service. */
 
 bool 																				 ENABLE_DATA_LOG = false;										/**< Flag to enable data logger */
-bool																				 ENABLE_DLOG_TIMER=false;										/**< Flag to start the data logger timer */
-bool																				 RESET_DLOG_TIMER = false;									/**< Flag to reset the data logger timer and make sure first log is 15 minutes later*/
-bool 																				 READ_DATA       = false;
+static uint32_t                              m_dlog_timer_remaining = 0;                /**< Seconds of the logging interval left after the running data logger timeout. */
+volatile bool 																				 READ_DATA       = false;
+bool 																				 DOWNLOAD_DATA     = false;                 /**< Flag to indicate that a data log download is in progress */
 bool 																				 START_DATA_READ = true;									  /**< flag to start data logging */
 bool 																				 TX_COMPLETE     = false;
-bool                                         TIME_SET          = false;                 /**< Flag to start time updation */
-bool                                         PIR_EVENT_FLAG = false;                    /**< Flag to indicate the event occurred on GPIO pin configured for PIR sensor */  
-bool                                         MOVEMENT_EVENT_FLAG = false;               /**< Event occurred on Movement/accelerometer interrupt pin */
-bool                                         CHECK_ALARM_TIMEOUT=false;                 /**< Flag to indicate whether to check for alarm conditions*/
-bool                                         DATA_LOG_CHECK=false;
-bool                                         CLEAR_MOVE_ALARM=false;
-bool                                         CENTRAL_DEVICE_CONNECTED = false;          /**<Flag to indicate when a central device is connected >**/    
-bool                                         MEAS_BATTERY_LEVEL = true;                	/**< Flag for measuring the battery level */
-bool                                         delay_complete = false;                    /**< Flag to indicate the completion of delay*/
+volatile bool                                delay_complete = false;                    /**< Flag to indicate the completion of delay*/
 
 extern bool																	 DLOGS_CONNECTED_STATE;                     /**< Specifies data logger service is connected or not */
-extern bool  																 DFU_ENABLE;                                /**< This flag indicates DFU mode is enabled/not */
-extern bool																	 LED_FLASH;																	/**< This flag indicates whether or not to flash the LED*/
 extern bool                                  DEVICE_CONNECTED_STATE;                    /**< This flag indicates device management service is in connected start or now */
 extern bool     	                           PIR_CONNECTED_STATE;                       /**< Flag indicates Passive INfrared alarm service is in connected start or now */
 extern bool                                  ACCELEROMETER_CONNECTED_STATE;             /**< Flag indicates accelerometer alarm service is in connected start or now */ 
 volatile bool                                ACTIVE_CONN_FLAG = false;                  /**<flag indicating active connection*/
-extern bool																	 MMA_SWITCH;																/**< Flag to check if the state of the MMA7660 needs to change */
 extern uint8_t															 MMA_STATUS;																/**< Flag indicating to which state the MMA7660 should switch */
 
 extern uint8_t  current_xyz_array[3];
 static dm_application_instance_t             m_app_handle;                              /**< Application identifier allocated by device manager */
 static bool                                  m_memory_access_in_progress = false;       /**< Flag to keep track of ongoing operations on persistent memory. */
-uint32_t buf[4];																																				/*buffer for flash write operation*/
 static void device_init(void);
 static void dlogs_init(void);
 static void dis_init(void);
@@ -220,81 +216,62 @@ app_error_handler(DEAD_BEEF, line_num, p_file_name);
 }
 
 
-/**@brief Function for performing a Sentry Profile parameters level measurement, and  check for the alarm condition.
+/**@brief Function for starting the data logger timer.
+*
+* @details The timer is single shot and runs for the whole logging interval, an interval longer
+*          than the RTC1 counter range is split into the fewest timeouts possible.
+*
+* @param[in]   seconds   Time until the next data log.
+*/
+static void data_log_timer_start(uint32_t seconds)
+{
+    uint32_t err_code;
+    uint32_t timeout = (seconds > DATA_LOG_TIMER_MAX_SECONDS) ? DATA_LOG_TIMER_MAX_SECONDS : seconds;
+
+    m_dlog_timer_remaining = seconds - timeout;
+    err_code = app_timer_start(sentry_measurement_timer, timeout * SECONDS_INTERVAL, NULL);
+    APP_ERROR_CHECK(err_code);
+}
+
+
+/**@brief Function for handling the data logger timer timeout, sets the flag for a data log once
+*        the logging interval has passed.
 */
 static void sentry_param_meas_timeout_handler(void * p_context)
 {
     UNUSED_PARAMETER(p_context);
-    static uint8_t minutes_count = 0x01;
-		if (RESET_DLOG_TIMER)
-		{
-				minutes_count = 0x01;
-				RESET_DLOG_TIMER = false; 
-		}
-    if (minutes_count < 0x0F)
+    if (m_dlog_timer_remaining != 0)
     {
-        minutes_count++;
+        data_log_timer_start(m_dlog_timer_remaining);     /* Continue the logging interval*/
     }
-    else 
+    else
     {
-        minutes_count =0x01;
-        DATA_LOG_CHECK=true;
+        wimoto_evt_post(WIMOTO_EVT_DATA_LOG);
+        data_log_timer_start(m_dlogs.interval * 60);
     }
 }
 
 
-/**@brief Function for performing time keeping.
+/**@brief Function for performing time keeping. Executed every TIME_KEEPING_SECONDS.
+*
+* @details The time is counted by RTC1, reading it here keeps up with the wrap of the counter.
 */
 static void real_time_timeout_handler(void * p_context)
 {
     uint32_t err_code;
-    uint8_t days_in_month[]={0,31,28,31,30,31,30,31,31,30,31,30,31};
-    static uint8_t battery_meas_timeout  = 0x00;
+    static uint16_t battery_meas_timeout = 0x00;
 
-    if((m_time_stamp.year% 4 == 0 && m_time_stamp.year%100 != 0) || m_time_stamp.year%400 == 0)
-    {
-        days_in_month[2] = 29;
-    }
-    else
-    {
-        days_in_month[2] = 28;
-    }
+    NRF_WDT->RR[0] = 0x6E524635;                          //kick the dog every time keeping interval
 
-    m_time_stamp.seconds += 1;
-		NRF_WDT->RR[0] = 0x6E524635;					//kick the dog every second
-    if (m_time_stamp.seconds > 59)
+    battery_meas_timeout++;
+    if(battery_meas_timeout >= BATTERY_MEAS_TICKS)        /*Check whether the battery measurement interval is reached*/
     {
-        m_time_stamp.seconds -= 60;
-        m_time_stamp.minutes++;
-        if (m_time_stamp.minutes > 59)
-        {
-            m_time_stamp.minutes = 0;
-            m_time_stamp.hours++;
-            if (m_time_stamp.hours > 23)
-            {
-                m_time_stamp.hours = 0;
-                m_time_stamp.day++;
-                if (m_time_stamp.day > (days_in_month[m_time_stamp.month]))	/* Increment day till days_in_month[time_stamp.month]*/
-                {
-                    m_time_stamp.day = 1;
-                    m_time_stamp.month++;
-                    if (m_time_stamp.month > 12)	
-                    {
-                        m_time_stamp.month = 1;
-                        m_time_stamp.year++;
-                    }
-                }
-            }
-        }
-				battery_meas_timeout++;
-				if(battery_meas_timeout >= BATTERY_MEAS_INTERVAL) /*Check whether the battery measurement interval is reached*/
-				{
-					battery_meas_timeout = 0;
-				  MEAS_BATTERY_LEVEL = true;                      /*Set the flag to do battery measurement in main loop*/
-				}
+        battery_meas_timeout = 0;
+        wimoto_evt_post(WIMOTO_EVT_BATTERY_MEAS);         /*Measure the battery level in main loop*/
     }
 
-    err_code= ble_time_update(&m_device, &m_time_stamp);
+    // Notify the current time to a connected client
+    err_code = ble_time_update(&m_device);
 
     if ((err_code != NRF_SUCCESS) &&
             (err_code != NRF_ERROR_INVALID_STATE) &&
@@ -304,7 +281,6 @@ static void real_time_timeout_handler(void * p_context)
     {
         APP_ERROR_HANDLER(err_code);
     }
-
 }
 
 
@@ -413,7 +389,7 @@ static void timers_init(void)
 
     // Create timers
     err_code = app_timer_create(&sentry_measurement_timer, /*Timer for sentry  measurement time-out*/
-    APP_TIMER_MODE_REPEATED,
+    APP_TIMER_MODE_SINGLE_SHOT,
     sentry_param_meas_timeout_handler);
     APP_ERROR_CHECK(err_code);
 
@@ -428,6 +404,9 @@ static void timers_init(void)
     delay_timer_timeout_handler);
     APP_ERROR_CHECK(err_code);
 
+    err_code = twi_master_timeout_init(APP_TIMER_PRESCALER);   /* Timer for giving up a stuck TWI transfer*/
+    APP_ERROR_CHECK(err_code);
+
 } 
 
 /**@brief Function for starting application timers.
@@ -436,13 +415,11 @@ static void application_timers_start(void)
 {
     uint32_t err_code;
 
-    // Start measurement time-out timer
-    //err_code = app_timer_start(sentry_measurement_timer, SENTRY_LEVEL_MEAS_INTERVAL, NULL);
-    //APP_ERROR_CHECK(err_code);
-
     // Start the time keeping timer
-    err_code = app_timer_start(real_time_timer, SECONDS_INTERVAL, NULL);
-    APP_ERROR_CHECK(err_code); 
+    err_code = app_timer_start(real_time_timer, TIME_KEEPING_INTERVAL, NULL);
+    APP_ERROR_CHECK(err_code);
+
+    wimoto_time_init(APP_TIMER_PRESCALER);              /* RTC1 is running now*/
 		
 }
 
@@ -458,20 +435,17 @@ static void gap_params_init(void)
     ble_gap_conn_params_t   gap_conn_params;
     ble_gap_conn_sec_mode_t sec_mode;
 		char deviceName[20];
-		uint8_t mac_add[3];
+		char * p_name_end;
 
     BLE_GAP_CONN_SEC_MODE_SET_OPEN(&sec_mode);
 	
 		//MAC ADDRESS CODE
-		mac_add[0] = (NRF_FICR->DEVICEADDR0 & 0x00FF0000) >> 16;
-		mac_add[1] = (NRF_FICR->DEVICEADDR0 & 0x0000FF00) >> 8;
-		mac_add[2] = (NRF_FICR->DEVICEADDR0 & 0x000000FF);
-	
-		sprintf(&deviceName[0], "%s%02x%02x%02x", &DEVICE_NAME[0], mac_add[0], mac_add[1], mac_add[2]);
+		p_name_end = wimoto_format_str(deviceName, DEVICE_NAME);
+		p_name_end = wimoto_format_hex(p_name_end, NRF_FICR->DEVICEADDR0 & 0x00FFFFFF, 6);   /* low three bytes of the device address*/
 	
 		//END MAC ADDRESS CODE
 	
-    err_code = sd_ble_gap_device_name_set(&sec_mode, (const uint8_t *)deviceName, strlen(deviceName));
+    err_code = sd_ble_gap_device_name_set(&sec_mode, (const uint8_t *)deviceName, p_name_end - deviceName);
     APP_ERROR_CHECK(err_code);
 
     err_code = sd_ble_gap_appearance_set(BLE_APPEARANCE_GENERIC_THERMOMETER);
@@ -761,6 +735,7 @@ static void dlogs_init(void)
     dlogs_init.p_report_ref         = NULL; 
     dlogs_init.data_logger_enable   = DEFAULT_ALARM_SET;
     dlogs_init.read_data_switch     = DEFAULT_ALARM_SET;
+    dlogs_init.log_interval         = DATA_LOGGER_DEFAULT_INTERVAL;
 
     err_code = ble_dlogs_init(&m_dlogs, &dlogs_init);
     APP_ERROR_CHECK(err_code);
@@ -1036,6 +1011,7 @@ static void ble_evt_dispatch(ble_evt_t * p_ble_evt)
     ble_device_on_ble_evt(&m_device, p_ble_evt);
     ble_conn_params_on_ble_evt(p_ble_evt);
     dm_ble_evt_handler(p_ble_evt);                            /*added for migrating to soft device 7.0.0 and SDK 6.1.0*/
+    wimoto_hvx_on_ble_evt(p_ble_evt);
     on_ble_evt(p_ble_evt);
 }
 
@@ -1051,6 +1027,10 @@ static void sys_evt_dispatch(uint32_t sys_evt)
 {
     pstorage_sys_event_handler(sys_evt);
 		data_log_sys_event_handler(sys_evt);                      /*added event handler for flash write operation*/
+    if (READ_DATA)
+    {
+        wimoto_evt_post(WIMOTO_EVT_READ_DATA);                /* Retry the flush before a download when the flash operation is done*/
+    }
     on_sys_evt(sys_evt);
 }
 
@@ -1088,7 +1068,7 @@ static void ble_stack_init(void)
 */
 static void pir_gpiote_evt_handler(uint32_t pins_low_to_high_mask, uint32_t pins_high_to_low_mask)
 { 
-    PIR_EVENT_FLAG=true;																					/*the flag is set when an event occurs on gpiote*/
+    wimoto_evt_post(WIMOTO_EVT_PIR);																					/*posted when an event occurs on gpiote*/
 }
 
 /**@brief event handler for  the Movement GPIOTE module.
@@ -1096,7 +1076,7 @@ static void pir_gpiote_evt_handler(uint32_t pins_low_to_high_mask, uint32_t pins
 static void movement_gpiote_evt_handler(uint32_t pins_low_to_high_mask, uint32_t pins_high_to_low_mask)
 {
     movement_gpio_pin_val = nrf_gpio_pin_read(MOVEMENT_GPIOTE_PIN);	
-    MOVEMENT_EVENT_FLAG=true;																			/*the flag is set when an event occurs on gpiote*/
+    wimoto_evt_post(WIMOTO_EVT_MOVEMENT);																			/*posted when an event occurs on gpiote*/
 }
 
 
@@ -1253,11 +1233,13 @@ static void power_manage(void)
 
 static void create_log_data(uint32_t * data)
 {
+    ble_date_time_t time_stamp;
     uint16_t current_pir_presence = 0;
     current_pir_presence = nrf_gpio_pin_read(PIR_GPIOTE_PIN);					
 
-    data[0] = (m_time_stamp.year<<16)|(m_time_stamp.month<<8)|m_time_stamp.day;				 /* First word written to memory contains date (YYYYMMDD)*/
-    data[1] = (m_time_stamp.hours<<24)|(m_time_stamp.minutes<<16)|(m_time_stamp.seconds<<8); /* Second word contains time HHMMSS*/
+    wimoto_time_date_time_get(&time_stamp);
+    data[0] = (time_stamp.year<<16)|(time_stamp.month<<8)|time_stamp.day;				 /* First word written to memory contains date (YYYYMMDD)*/
+    data[1] = (time_stamp.hours<<24)|(time_stamp.minutes<<16)|(time_stamp.seconds<<8); /* Second word contains time HHMMSS*/
     // first word is X data,second word is Y data and third word is Z data 
     data[2] = (current_xyz_array[0] << 16) | (current_xyz_array[1] << 8) | current_xyz_array[2] ;			
     data[3] = (current_pir_presence<<16) | log_id;                                                    /* Fourth word contains PIR state */
@@ -1271,17 +1253,34 @@ static void create_log_data(uint32_t * data)
 		}
 }
 
+/**@brief Function for updating the flash wear characteristic from the data logger.
+*/
+static void flash_wear_update(void)
+{
+    uint32_t         err_code;
+    ble_dlogs_wear_t wear;
+
+    data_log_wear_get(&wear);
+    err_code = ble_flash_wear_update(&m_device, &wear);
+    APP_ERROR_CHECK(err_code);
+}
+
+
 /**@brief Function for checking whether to log data.
 */
 static void data_log_check()
 {
     uint32_t log_data[4];                /*array storing the data to be logged */
 
-    if(ENABLE_DATA_LOG && !READ_DATA)									    /*if enabled, start data logging functionality*/
+    if(ENABLE_DATA_LOG)									    /*if enabled, start data logging functionality*/
     {   
 				create_log_data(log_data);                        /*create the data to be logged */
-        write_data_flash(log_data);	                      /*log the data to flash */
+        if (write_data_flash(log_data) == NRF_ERROR_INVALID_STATE)   /* Queue the data to be logged to flash */
+        {
+            log_id--;                                     /* Within the deadband, the record ID is kept for the next data log*/
+        }
     }
+    flash_wear_update();                                  /* Show the flash wear, updated by the data logger*/
 }
 
 /* Turn OFF TWI if TWI is not using , considering power optimization*/
@@ -1306,7 +1305,7 @@ void WDT_init(void)
 		NRF_WDT->CONFIG = WDT_CONFIG_HALT_Pause << WDT_CONFIG_HALT_Pos |							//pause WDT when device in debug mode
 											WDT_CONFIG_SLEEP_Run << WDT_CONFIG_SLEEP_Pos;								//continue WDT when device is in sleep mode
 		
-		NRF_WDT->CRV = 4*32768;								//set watchdog to have 2 second timeout
+		NRF_WDT->CRV = (TIME_KEEPING_SECONDS + 4)*32768;		//set watchdog to time out 4 seconds after a missed time keeping interval
 		NRF_WDT->RREN |= WDT_RREN_RR0_Msk;		//enable reload register0
 		NRF_WDT->TASKS_START = 1;							//start watchdog timer
 		
@@ -1415,123 +1414,73 @@ void reset_conn_params()
 	APP_ERROR_CHECK(err_code);
 }
 
-/**@brief Function for application main entry.
+/**@brief Function for handling the application events.
+*
+* @details Called from app_sched_execute() in the main loop for every event posted by the timer,
+*          GPIOTE and BLE handlers, so each wakeup only does the work that is pending.
+*
+* @param[in]   evt   Application event.
 */
-void connectable_mode(void)
+static void app_evt_handler(wimoto_evt_t evt)
 {
     uint32_t err_code;
-		uint16_t len = 1;
-		uint8_t val;
-
-    // Initialization.
-		get_die_revision_no();								 	/*Get silicon revision before init*/
-    ble_stack_init();
-    twi_master_init(); 
-    MMA7660_config_standby_and_initialize();
-    timers_init();
-    gpiote_init();
-    device_manager_init();
-    gap_params_init();
-	  //init_battery_level();                 	/*measure the battery level before advertisement*/
-    advertising_init();
-    services_init();
-    conn_params_init();
-    sec_params_init();
-    radio_notification_init();
-    MMA7660_enable_active_mode();
-    twi_turn_OFF();
-    application_timers_start();
-	
-		if(rev_no == 0x01){											/* Activate HFCLK workaround for PAN14 if rev 1 silicon*/
-			HFCLK_request();
-		}
-	
-		WDT_init();
-    advertising_start();
-		LED_ON(20, NULL);
-	
+    uint16_t len = 1;
+    uint8_t  val = 0;
 
-
-    // Enter main loop.
-    for (;;)
+    switch (evt)
     {
+        case WIMOTO_EVT_DFU_ENABLE:                               /* Go to the bootloader*/
+            sd_power_gpregret_set(1);                             /* Set the value of general purpose retention register to 1*/
+            err_code = sd_ble_gatts_service_changed(m_conn_handle,0x01,0x4D); /*function for service change indication*/
+            UNUSED_VARIABLE(err_code);
+            sd_nvic_SystemReset();                                /* Apply a system reset for jumping into bootloader*/
+            break;
 
-        // If the dfu enable flag is true go to the bootloader 
-        if(DFU_ENABLE)  
-        {
-             
-            sd_power_gpregret_set(1);            /* If DFU mode is enabled, set the general purpose retention register to 1*/
-     
-						err_code=sd_ble_gatts_service_changed(m_conn_handle,0x01,0x4D); /*function for service change indication*/
-						
-						sd_nvic_SystemReset();               /* Apply a system reset for jumping into bootloader*/                     
-        }          
-				if(LED_FLASH)																									/* If LED flash flag is enabled, flash the red LED*/
-				{		
-						val = 0;
-						err_code = sd_ble_gatts_value_set(m_device.dfu_mode_handles.value_handle , 0, &len, &val);
-						APP_ERROR_CHECK(err_code);
-						LED_ON(18,19);
-						LED_FLASH = false;
-						
-				}
-				if(MMA_SWITCH)
-				{	
-					err_code = NRF_SUCCESS;																				//Reset the error code//
-					twi_turn_ON();
-					if(MMA_STATUS == 0x01)
-					{
-						if(MMA7660_config_standby_and_initialize() == false)				//Turn on MMA7660. If it fails, reset characteristic to 0 indicating off.
-						{
-							val = 0;
-							err_code = sd_ble_gatts_value_set(m_device.mma_switch_handles.value_handle, 0, &len, &val);
-						}
-					}
-					if(MMA_STATUS == 0x00)
-					{
-						if(MMA7660_enable_standby_mode() == false)									//Turn off MMA7660. If it fails, reset characteristic to 1 indicating on.
-						{
-							val = 1;
-							err_code = sd_ble_gatts_value_set(m_device.mma_switch_handles.value_handle, 0, &len, &val);
-						}
-					}
-					if(err_code != NRF_SUCCESS)
-					{
-						APP_ERROR_CHECK(err_code);
-					}
-					twi_turn_OFF();
-					MMA_SWITCH = false;
-				}
-
-        // If the PIR event mode flag is true and go for alarm check condition
-        if(PIR_EVENT_FLAG)
-        {
+        case WIMOTO_EVT_LED_FLASH:                                /* Flash the red LED*/
+            err_code = sd_ble_gatts_value_set(m_device.dfu_mode_handles.value_handle , 0, &len, &val);  /* Reset characteristic value */
+            APP_ERROR_CHECK(err_code);
+            LED_ON(18,19);
+            break;
 
-            // Check whether alarm has to be send to indicate pir presence 
-            err_code = ble_pir_alarm_check(&m_pir,&m_device);             
-            if ((err_code != NRF_SUCCESS) &&									/*Passed device management service structure to pir service to get time stamp*/
+        case WIMOTO_EVT_MMA_SWITCH:
+            err_code = NRF_SUCCESS;
+            if(MMA_STATUS == 0x01)
+            {
+                if(MMA7660_config_standby_and_initialize() == false)  /* Turn on MMA7660. If it fails, reset characteristic to 0 indicating off.*/
+                {
+                    val = 0;
+                    err_code = sd_ble_gatts_value_set(m_device.mma_switch_handles.value_handle, 0, &len, &val);
+                }
+            }
+            if(MMA_STATUS == 0x00)
+            {
+                if(MMA7660_enable_standby_mode() == false)            /* Turn off MMA7660. If it fails, reset characteristic to 1 indicating on.*/
+                {
+                    val = 1;
+                    err_code = sd_ble_gatts_value_set(m_device.mma_switch_handles.value_handle, 0, &len, &val);
+                }
+            }
+            APP_ERROR_CHECK(err_code);
+            break;
+
+        case WIMOTO_EVT_PIR:                                      /* Check whether alarm has to be send to indicate pir presence*/
+            err_code = ble_pir_alarm_check(&m_pir,&m_device);     /* Passed device management service structure to pir service to get time stamp*/
+            if ((err_code != NRF_SUCCESS) &&
                     (err_code != NRF_ERROR_INVALID_STATE) &&
                     (err_code != BLE_ERROR_NO_TX_BUFFERS) &&
                     (err_code != BLE_ERROR_GATTS_SYS_ATTR_MISSING)
                     )
             {
                 APP_ERROR_HANDLER(err_code);
-            } 
-
-						//updating the advertise/broadcast data
-						if(ACTIVE_CONN_FLAG==false)               /* no active connection*/
-							advertising_init();                     
-						else																			/*an active connection exists*/
-							advertising_nonconn_init();
-            PIR_EVENT_FLAG=false;				         /* Reset the gpiote event flag*/
+            }
+            if(ACTIVE_CONN_FLAG==false)                           /* no active connection, update the advertise data*/
+                advertising_init();
+            else                                                  /* an active connection exists, update the broadcast data*/
+                advertising_nonconn_init();
+            break;
 
-        }
-				
-        // If the Movement event mode flag is true and go for alarm check condition			 
-        if(MOVEMENT_EVENT_FLAG) 
-        {
-            // Check whether alarm has to be send to indicate movement 
-            err_code = ble_movement_alarm_check(&m_movement,&m_device);   	/*Passed device management service structure to movement service to get time stamp*/         
+        case WIMOTO_EVT_MOVEMENT:                                 /* Check whether alarm has to be send to indicate movement*/
+            err_code = ble_movement_alarm_check(&m_movement,&m_device);   /* Passed device management service structure to movement service to get time stamp*/
             if ((err_code != NRF_SUCCESS) &&
                     (err_code != NRF_ERROR_INVALID_STATE) &&
                     (err_code != BLE_ERROR_NO_TX_BUFFERS) &&
@@ -1539,70 +1488,15 @@ void connectable_mode(void)
                     )
             {
                 APP_ERROR_HANDLER(err_code);
-            }  
-						delay_ms(100);
-						//updating the advertise/broadcast data
-						if(ACTIVE_CONN_FLAG==false)               /* no active connection*/
-							advertising_init();                     
-						else																			/*an active connection exists*/
-							advertising_nonconn_init();
-            MOVEMENT_EVENT_FLAG=false;					 /* Reset the gpiote event flag*/
-        }
-				
-				if (ENABLE_DLOG_TIMER)																/* If the data logger has been enabled, start the timer*/
-				{
-					err_code = app_timer_start(sentry_measurement_timer, SENTRY_LEVEL_MEAS_INTERVAL, NULL);
-					APP_ERROR_CHECK(err_code);
-					ENABLE_DLOG_TIMER = false;
-					DATA_LOG_CHECK = true;															/* Create a data log immediately upon enabling logging functionality*/
-					RESET_DLOG_TIMER = true;														/* Make sure that the timer gets reset so that first log is 15 minutes later*/
-				}
-				
-        if (DATA_LOG_CHECK)
-        {
-						data_log_check();
-            DATA_LOG_CHECK= false;
-        }
-
-
-        // If READ_DATA flag is set, start sending data to the connected device	
-        if(READ_DATA)																			                				/* If enabled, start sending data to the connected device */
-        {
-            err_code=app_timer_stop(sentry_measurement_timer);		       				  /* Stop the timers before start sending the historical data */
-            APP_ERROR_CHECK(err_code);
-            err_code=app_gpiote_user_disable(pir_measurement_gpiote);     				/* Disable the PIR gpiote*/
-            err_code=app_gpiote_user_disable(movement_measurement_gpiote);				/* Disable the movement gpiote*/
-            APP_ERROR_CHECK(err_code);
-            READ_DATA = false;
-            ENABLE_DATA_LOG = false;                                      				/* Disable data logging functionality */
-						if(((write_pg != 0) && (read_pg < (write_pg - 1))) || (read_pg > write_pg))
-						{
-							update_conn_params();																								/* Update connection parameters if there is enoguh data*/
-						}
-            send_data(&m_dlogs);																          				/* Start sending the data */	
-						if(param_updated == true)
-						{
-							reset_conn_params();																								/* Reset the conn params to maintain decent power consumption */
-							param_updated = false;																							/* Reset the flag indicating that the conn params were changed*/
-						}
-            err_code=app_gpiote_user_enable(pir_measurement_gpiote);      				/* Re-enable PIR gpiote */
-            err_code=app_gpiote_user_enable(movement_measurement_gpiote); 				/* Re-enable movement gpiote */
-            APP_ERROR_CHECK(err_code);
-            err_code=reset_data_log(&m_dlogs);									          				/* Reset the data logger enable and data read switches*/
-            APP_ERROR_CHECK(err_code);	
-        }    
+            }
+            if(ACTIVE_CONN_FLAG==false)                           /* no active connection, update the advertise data*/
+                advertising_init();
+            else                                                  /* an active connection exists, update the broadcast data*/
+                advertising_nonconn_init();
+            break;
 
-        // If TIME_SET flag is set, create new time stamp
-        if(TIME_SET)
-        {
-            create_time_stamp(&m_device, &m_time_stamp);          								/* Create new time stamp from user set time*/
-            TIME_SET = false;                                              				/* Reset the flag*/
-            
-        }                                                                 
-
-        if (CLEAR_MOVE_ALARM)	
-        {   
-            err_code = reset_alarm(&m_movement);             											/* Check whether alarm clear in movement service is set */
+        case WIMOTO_EVT_CLEAR_MOVE_ALARM:
+            err_code = reset_alarm(&m_movement);                  /* Clear the alarm in movement service*/
             if ((err_code != NRF_SUCCESS) &&
                     (err_code != NRF_ERROR_INVALID_STATE) &&
                     (err_code != BLE_ERROR_NO_TX_BUFFERS) &&
@@ -1610,18 +1504,13 @@ void connectable_mode(void)
                     )
             {
                 APP_ERROR_HANDLER(err_code);
-
             }
-						delay_ms(100);
-            CLEAR_MOVE_ALARM= false;
-        }
-				
-				if(CENTRAL_DEVICE_CONNECTED)
-				{
-					update_movement_alarmtimestamp_on_connect(&m_movement,&m_device);   		/*Function to update the last occurance of movement alarm when a central device is connected*/         
-          
-					err_code = update_pir_alarmtimestamp_on_connect(&m_pir,&m_device);     	/*Function to update the last occurance of pir alarm when a central device is connected*/                 
-            if ((err_code != NRF_SUCCESS) &&									 
+            break;
+
+        case WIMOTO_EVT_CENTRAL_CONNECTED:
+            update_movement_alarmtimestamp_on_connect(&m_movement,&m_device);   /* Update the last occurance of movement alarm when a central device is connected*/
+            err_code = update_pir_alarmtimestamp_on_connect(&m_pir,&m_device);   /* Update the last occurance of pir alarm when a central device is connected*/
+            if ((err_code != NRF_SUCCESS) &&
                     (err_code != NRF_ERROR_INVALID_STATE) &&
                     (err_code != BLE_ERROR_NO_TX_BUFFERS) &&
                     (err_code != BLE_ERROR_GATTS_SYS_ATTR_MISSING)
@@ -1629,19 +1518,116 @@ void connectable_mode(void)
             {
                 APP_ERROR_HANDLER(err_code);
             }
-						delay_ms(100);
-					CENTRAL_DEVICE_CONNECTED = false;
-					
-				}
-        if(MEAS_BATTERY_LEVEL)
-				{
-					  battery_start();		                              /* Measure battery level*/
-						MEAS_BATTERY_LEVEL = false;
-				}
-        power_manage(); 
+            break;
+
+        case WIMOTO_EVT_DLOG_TIMER_START:                         /* The data logger has been enabled or its interval changed, restart the timer*/
+            err_code = app_timer_stop(sentry_measurement_timer);
+            APP_ERROR_CHECK(err_code);
+            data_log_timer_start(m_dlogs.interval * 60);
+            wimoto_evt_post(WIMOTO_EVT_DATA_LOG);                 /* Create a data log immediately upon enabling logging functionality*/
+            break;
+
+        case WIMOTO_EVT_DATA_LOG:
+            data_log_check();
+            break;
+
+        case WIMOTO_EVT_READ_DATA:                                /* Start sending data to the connected device*/
+            if(READ_DATA && data_log_flush())                     /* Posted again by the flash events until the log is written*/
+            {
+                err_code=app_gpiote_user_disable(pir_measurement_gpiote);       /* Disable the PIR gpiote*/
+                err_code=app_gpiote_user_disable(movement_measurement_gpiote);  /* Disable the movement gpiote*/
+                APP_ERROR_CHECK(err_code);
+                READ_DATA = false;
+                DOWNLOAD_DATA = true;                             /* Logging continues while the data is sent*/
+                if(((write_pg != 0) && (read_pg < (write_pg - 1))) || (read_pg > write_pg))
+                {
+                    update_conn_params();                         /* Update connection parameters if there is enough data*/
+                }
+                wimoto_evt_post(WIMOTO_EVT_DOWNLOAD);
+            }
+            break;
+
+        case WIMOTO_EVT_DOWNLOAD:
+            if(DOWNLOAD_DATA && send_data(&m_dlogs))              /* Send the data, continued on every TX complete event*/
+            {
+                DOWNLOAD_DATA = false;
+                if(param_updated == true)
+                {
+                    reset_conn_params();                          /* Reset the conn params to maintain decent power consumption */
+                    param_updated = false;                        /* Reset the flag indicating that the conn params were changed*/
+                }
+                err_code=app_gpiote_user_enable(pir_measurement_gpiote);        /* Re-enable PIR gpiote */
+                err_code=app_gpiote_user_enable(movement_measurement_gpiote);   /* Re-enable movement gpiote */
+                APP_ERROR_CHECK(err_code);
+                err_code=reset_data_log(&m_dlogs);                /* Reset the data read switch*/
+                APP_ERROR_CHECK(err_code);
+            }
+            break;
+
+        case WIMOTO_EVT_TIME_SET:
+            (void)create_time_stamp(&m_device);                   /* Set the clock to the user set time, an invalid time is ignored*/
+            break;
 
+        case WIMOTO_EVT_BATTERY_MEAS:
+            battery_start();                                      /* Measure battery level*/
+            break;
+
+        default:
+            // No implementation needed.
+            break;
+    }
+}
+
+
+/**@brief Function for application main entry.
+*/
+void connectable_mode(void)
+{
+    uint16_t next_log_id;                  /* log ID following the newest data log in flash*/
+
+    // Initialization.
+		get_die_revision_no();								 	/*Get silicon revision before init*/
+    wimoto_evt_init(app_evt_handler);      /* Queue the application events on the scheduler*/
+    ble_stack_init();
+    if (data_log_init(&next_log_id))       /* Restore the data logger pointers from flash*/
+    {
+        log_id = next_log_id;              /* Continue the record ID of the last data log*/
     }
+    twi_master_init(); 
+    MMA7660_config_standby_and_initialize();
+    timers_init();
+    gpiote_init();
+    device_manager_init();
+    gap_params_init();
+	  //init_battery_level();                 	/*measure the battery level before advertisement*/
+    advertising_init();
+    services_init();
+    flash_wear_update();
+    conn_params_init();
+    sec_params_init();
+    radio_notification_init();
+    MMA7660_enable_active_mode();
+    twi_turn_OFF();
+    application_timers_start();
+	
+		if(rev_no == 0x01){											/* Activate HFCLK workaround for PAN14 if rev 1 silicon*/
+			HFCLK_request();
+		}
+	
+		WDT_init();
+    advertising_start();
+		LED_ON(20, NULL);
+	
 
+
+    wimoto_evt_post(WIMOTO_EVT_BATTERY_MEAS);             /* Measure the battery level at start up*/
+
+    // Enter main loop.
+    for (;;)
+    {
+        app_sched_execute();                                  /* Handle the pending application events*/
+        power_manage();                                       /* Switch to a low power state*/
+    }
 }
 
 
@@ -82,14 +82,13 @@ uint8_t MMA7660_read_register(uint8_t base_address)
     uint8_t data_buffer[1];
     data_buffer[0] = 0xFF;             /* Initializing data buffer */
 
-    if (twi_master_transfer (MMA7660FC_ADDRESS ,(uint8_t*)&base_address ,1 ,TWI_DONT_ISSUE_STOP))
-    {
-
-        if (twi_master_transfer (MMA7660FC_ADDRESS | TWI_READ_BIT ,data_buffer ,1 ,TWI_ISSUE_STOP))
-        {
-            return data_buffer[0];	
-        }
+    twi_master_xfer_t  xfers[2] = {{MMA7660FC_ADDRESS ,&base_address ,1 ,TWI_DONT_ISSUE_STOP},
+                                   {MMA7660FC_ADDRESS | TWI_READ_BIT ,data_buffer ,1 ,TWI_ISSUE_STOP}};
+    twi_master_chain_t chain    = {xfers ,2 ,NULL};
 
+    if (twi_master_chain_run(&chain))
+    {
+        return data_buffer[0];	
     }
 
     return 0;
@@ -172,43 +171,21 @@ bool MMA7660_config_standby_and_initialize()
 */
 bool MMA7660_read_xyz_reg_one_time(uint32_t * ptr_to_Reg_val)
 {
-    uint8_t X_buff = 0,Y_buff = 0,Z_buff = 0;
-    bool state1 = true ,state2 = true ,state3 = true;
-
-    while(state1)                                        /*after enabling active mode read x,y,z registers */
-    {
-        X_buff = MMA7660_read_register (MMA7660_XOUT_REG);
-
-        if(X_buff & MMA7660_ALERT_BIT_SET_CHECK) 
-        state1 = true;                            /* If alert bit set re=read the register */
-        else 
-        state1 = false;
-
-    }
+    uint8_t base_address = MMA7660_XOUT_REG;
+    uint8_t xyz_buff[3];                                 /* X, Y and Z registers, read with auto-increment */
+    twi_master_xfer_t  xfers[2] = {{MMA7660FC_ADDRESS ,&base_address ,1 ,TWI_DONT_ISSUE_STOP},
+                                   {MMA7660FC_ADDRESS | TWI_READ_BIT ,xyz_buff ,3 ,TWI_ISSUE_STOP}};
+    twi_master_chain_t chain    = {xfers ,2 ,NULL};
 
-    while(state2)
+    do                                                   /*after enabling active mode read x,y,z registers */
     {
-        Y_buff = MMA7660_read_register(MMA7660_YOUT_REG);
-
-        if(Y_buff & MMA7660_ALERT_BIT_SET_CHECK) 
-        state2 = true;                           /* If alert bit set re=read the register */
-        else 
-        state2 = false;
-
-    }
-
-    while(state3)
-    {
-        Z_buff = MMA7660_read_register (MMA7660_ZOUT_REG);
-
-        if(Z_buff & MMA7660_ALERT_BIT_SET_CHECK) 
-        state3 = true;                           /* If alert bit set re=read the register */       
-        else  
-        state3 = false;
-
-    }
+        if (!twi_master_chain_run(&chain))
+        {
+            return false;
+        }
+    } while((xyz_buff[0] | xyz_buff[1] | xyz_buff[2]) & MMA7660_ALERT_BIT_SET_CHECK);   /* If alert bit set re-read the registers */
 
-    * ptr_to_Reg_val= ((X_buff << 16) | ( Y_buff <<8) | Z_buff);    /* 32 bit result is returned */
+    * ptr_to_Reg_val= ((xyz_buff[0] << 16) | ( xyz_buff[1] <<8) | xyz_buff[2]);    /* 32 bit result is returned */
 
     return true;
 
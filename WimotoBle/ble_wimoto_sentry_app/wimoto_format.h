@@ -0,0 +1,52 @@
+/** @file
+ *
+ * @brief Integer formatting of device names and characteristic values.
+ *
+ * @details Replaces sprintf() and the float string conversions, so neither the printf nor the
+ *          soft-float library is linked in. Multi-byte values are stored MSB first, as the other
+ *          characteristics of the services.
+ */
+
+#ifndef WIMOTO_FORMAT_H__
+#define WIMOTO_FORMAT_H__
+
+#include <stdint.h>
+
+/**@brief Function for copying a string without its terminating null character.
+ *
+ * @param[out]  p_dest   Destination buffer.
+ * @param[in]   p_str    Null terminated string.
+ *
+ * @return      Pointer to the character after the copied string.
+ */
+char * wimoto_format_str(char * p_dest, const char * p_str);
+
+/**@brief Function for writing the low digits of a value as lower case hexadecimal characters,
+ *        zero padded and without a terminating null character.
+ *
+ * @param[out]  p_dest   Destination buffer.
+ * @param[in]   value    Value to write.
+ * @param[in]   digits   Number of hexadecimal digits, at most 8.
+ *
+ * @return      Pointer to the character after the last digit.
+ */
+char * wimoto_format_hex(char * p_dest, uint32_t value, uint8_t digits);
+
+/**@brief Function for encoding a value as a signed 16 bit characteristic value, MSB first.
+ *
+ * @details Values outside of the int16_t range are saturated.
+ *
+ * @param[in]   value       Value to encode.
+ * @param[out]  p_encoded   Buffer of 2 bytes.
+ */
+void wimoto_encode_int16(int32_t value, uint8_t * p_encoded);
+
+/**@brief Function for decoding a signed 16 bit characteristic value, MSB first.
+ *
+ * @param[in]   p_encoded   Buffer of 2 bytes.
+ *
+ * @return      Decoded value.
+ */
+int16_t wimoto_decode_int16(const uint8_t * p_encoded);
+
+#endif // WIMOTO_FORMAT_H__
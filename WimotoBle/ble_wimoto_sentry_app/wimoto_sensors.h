@@ -20,7 +20,7 @@
 /********************************************************************************************/
 #include <stdbool.h>
 #include <stdint.h>
-#include "twi_master.h"
+#include "twi_hw_master.h"
 #include "nrf.h"
 #include "nrf_delay.h"
 #include "nrf_gpio.h"
@@ -101,8 +101,6 @@ bool      write_to_register            (uint8_t,uint8_t,uint8_t);  /**< Write da
 /**< Functions      */
 /*Public Functions  */
 bool      TMP006_enable_powerdown_mode(void);     /**< Enable power down mode */
-uint32_t  TMP006_get_onetime_data(void);          /**< Enable continuous conversion mode then read contents of V-object & T-ambient  
-                                                       registers one time and reconfigure TMP006 in power down mode */																									 
 float     TMP006_readDieTempC(void);              /**< Calculate sensor temperature based on raw reading */
 float     TMP006_ObjTempC_conversion(void);       /**< Calculate object temperature based on raw sensor temp and thermopile voltage */
 void      do_thermopile_measurement(uint8_t*, float*);
@@ -0,0 +1,72 @@
+/** @file
+ *
+ * @brief Time keeping on the RTC1 counter of the application timer.
+ *
+ * @details The time is held as the number of seconds since 1 January WIMOTO_TIME_EPOCH_YEAR and
+ *          brought up to date from the ticks RTC1 counted since it was last read, so no timer has
+ *          to wake the CPU every second. The date and time are only worked out when a time stamp
+ *          is needed.
+ */
+
+#ifndef WIMOTO_TIME_H__
+#define WIMOTO_TIME_H__
+
+#include <stdint.h>
+#include "ble_date_time.h"
+
+#define WIMOTO_TIME_EPOCH_YEAR      2000        /**< The time counts the seconds from 1 January of this year. */
+#define WIMOTO_TIME_MAX_YEAR        2099        /**< Last year that can be set. */
+
+/**@brief Function for starting the time keeping.
+ *
+ * @details Call after the first application timer is started, RTC1 only counts while a timer
+ *          is running. The date is not valid until wimoto_time_set() is called.
+ *
+ * @param[in]   prescaler   Value of the RTC1 PRESCALER register.
+ */
+void wimoto_time_init(uint32_t prescaler);
+
+/**@brief Function for setting the date and time.
+ *
+ * @param[in]   p_date_time   New date and time.
+ *
+ * @return      NRF_SUCCESS on success, NRF_ERROR_INVALID_DATA if the date or time is not valid.
+ */
+uint32_t wimoto_time_set(const ble_date_time_t * p_date_time);
+
+/**@brief Function for getting the time.
+ *
+ * @details Has to be called at least once within every wrap of the 24 bit RTC1 counter
+ *          (512 s at prescaler 0), the application does it from a repeated timer.
+ *
+ * @return      Seconds since 1 January WIMOTO_TIME_EPOCH_YEAR, or since wimoto_time_init() while
+ *              the date is not set.
+ */
+uint32_t wimoto_time_get(void);
+
+/**@brief Function for converting a date and time to the seconds since the epoch.
+ *
+ * @param[in]   p_date_time   Date and time.
+ * @param[out]  p_time        Seconds since 1 January WIMOTO_TIME_EPOCH_YEAR.
+ *
+ * @return      NRF_SUCCESS on success, NRF_ERROR_INVALID_DATA if the date or time is not valid.
+ */
+uint32_t wimoto_time_from_date_time(const ble_date_time_t * p_date_time, uint32_t * p_time);
+
+/**@brief Function for converting the seconds since the epoch to a date and time.
+ *
+ * @param[in]   time          Seconds since 1 January WIMOTO_TIME_EPOCH_YEAR.
+ * @param[out]  p_date_time   Date and time.
+ */
+void wimoto_time_to_date_time(uint32_t time, ble_date_time_t * p_date_time);
+
+/**@brief Function for getting the date and time.
+ *
+ * @details While the date is not set, the year, month and day are 0 and the time of day counts
+ *          from wimoto_time_init().
+ *
+ * @param[out]  p_date_time   Current date and time.
+ */
+void wimoto_time_date_time_get(ble_date_time_t * p_date_time);
+
+#endif // WIMOTO_TIME_H__
@@ -33,11 +33,13 @@
 #include "softdevice_handler.h"
 #include "ble_bas.h"
 #include "battery.h"
+#include "ble_data_log_service.h"
 #include "app_util.h"
 
 #define ADC_REF_VOLTAGE_IN_MILLIVOLTS        1200                                      /**< Reference voltage (in milli volts) used by ADC while doing conversion. */
 #define ADC_PRE_SCALING_COMPENSATION         3                                         /**< The ADC is configured to use VDD with 1/3 prescaling as input. And hence the result of conversion is to be multiplied by 3 to get the actual value of the battery voltage.*/
 #define DIODE_FWD_VOLT_DROP_MILLIVOLTS       0                                        /**< Typical forward voltage drop of the diode (Part no: SD103ATW-7-F) that is connected in series with the voltage supply. This is the voltage drop when the forward current is 1mA. Source: Data sheet of 'SURFACE MOUNT SCHOTTKY BARRIER DIODE ARRAY' available at www.diodes.com. */
+#define LOW_BATTERY_LEVEL_PERCENT            10                                        /**< Battery level (in percent) below which the staged data logs are written to flash. */
 /** No diode, therefore 0 DIODE_FWD_VOLT_DROP_MILLIVOLTS
 **/
 
@@ -91,6 +93,11 @@ void battery_start(void)
     percentage_batt_lvl     = battery_level_in_percent(batt_lvl_in_milli_volts);
 		battery_lvl             = percentage_batt_lvl;                         /*save battery level data  to a global variable for broadcasting*/  
 		
+    if (percentage_batt_lvl <= LOW_BATTERY_LEVEL_PERCENT)
+    {
+        (void)data_log_flush();                                                 /*commit the staged data logs before the supply fails*/
+    }
+
     err_code = ble_bas_battery_level_update(&bas, percentage_batt_lvl);
     if (
             (err_code != NRF_SUCCESS)
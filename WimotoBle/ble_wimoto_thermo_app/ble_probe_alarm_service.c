@@ -22,17 +22,17 @@
 #include "ble_srv_common.h"
 #include "app_util.h"
 #include "wimoto.h"
+#include "wimoto_evt.h"
+#include "wimoto_hvx.h"
 #include "wimoto_sensors.h"
 #include "app_error.h"
 
 bool 	PROBES_CONNECTED_STATE=false;      /*This flag indicates whether a client is connected to the peripheral in probe temperature service*/
-extern bool 	 		CHECK_ALARM_TIMEOUT;
 extern uint8_t	 	var_receive_uuid;										/*variable to receive uuid*/
 extern uint8_t	  curr_probe_temp_level[2];   /*variable to store current probe temperature to broadcast*/
-extern bool       CHECK_ALARM_TIMEOUT;
 bool              probe_alarm_set_changed = false;
 bool     					m_probes_alarm_ind_conf_pending = false;       /**< Flag to keep track of when an indication confirmation is pending. */
-extern bool     	m_thermops_alarm_ind_conf_pending;
+bool     				PROBES_READ_PENDING = false;       /**< Flag to keep track of when a read of the current probe temperature waits for a measurement. */
 
 /**@brief Function for handling the Connect event.
 *
@@ -43,7 +43,7 @@ static void on_connect(ble_probes_t * p_probes, ble_evt_t * p_ble_evt)
 {
     p_probes->conn_handle = p_ble_evt->evt.gap_evt.conn_handle;
     PROBES_CONNECTED_STATE = true;      /*Set the flag to true so that state remains in connectable mode until disconnected*/
-		CHECK_ALARM_TIMEOUT    = true;      /*set the flag to check alarm condition on connect*/
+		wimoto_evt_post(WIMOTO_EVT_ALARM_CHECK); /*check the alarm conditions on connection*/
 }
 
 
@@ -60,6 +60,27 @@ static void on_disconnect(ble_probes_t * p_probes, ble_evt_t * p_ble_evt)
 }
 
 
+/**@brief Function for handling the Read/Write Authorization Request event.
+*
+* @details A read of the current probe temperature is answered by ble_probes_current_read_reply() once the main loop
+*          has taken a new measurement.
+*
+* @param[in]   p_probes    Probe Temperature Service structure.
+* @param[in]   p_ble_evt   Event received from the BLE stack.
+*/
+static void on_rw_authorize_request(ble_probes_t * p_probes, ble_evt_t * p_ble_evt)
+{
+    ble_gatts_evt_rw_authorize_request_t * p_auth_req = &p_ble_evt->evt.gatts_evt.params.authorize_request;
+
+    if ((p_auth_req->type == BLE_GATTS_AUTHORIZE_TYPE_READ) &&
+        (p_auth_req->request.read.handle == p_probes->curr_probe_temp_level_handles.value_handle))
+    {
+        PROBES_READ_PENDING = true;
+        wimoto_evt_post(WIMOTO_EVT_READ_SENSORS);    /* the measurement is taken from the main loop*/
+    }
+}
+
+
 /**@brief Function for handling write events on values.
 *
 * @details This function will be called for all write events of probe temperature low, high values and alarm set 
@@ -67,7 +88,7 @@ static void on_disconnect(ble_probes_t * p_probes, ble_evt_t * p_ble_evt)
 */
 static void write_evt_handler(void)
 {   
-    CHECK_ALARM_TIMEOUT = true; 
+    wimoto_evt_post(WIMOTO_EVT_ALARM_CHECK);
 }
 
 static void on_probes_evt(ble_probes_t * p_probes, ble_probes_alarm_evt_t *p_evt)
@@ -305,11 +326,16 @@ void ble_probes_on_ble_evt(ble_probes_t * p_probes, ble_evt_t * p_ble_evt)
 
     case BLE_GAP_EVT_DISCONNECTED:
 				m_probes_alarm_ind_conf_pending = false;													//Clear pending confirmation flag if a disconnect occurs
+				PROBES_READ_PENDING = false;
         on_disconnect(p_probes, p_ble_evt);
         break;
 
     case BLE_GATTS_EVT_WRITE:
         on_write(p_probes, p_ble_evt);
+        break;
+
+    case BLE_GATTS_EVT_RW_AUTHORIZE_REQUEST:
+        on_rw_authorize_request(p_probes, p_ble_evt);
         break;
 		case BLE_GATTS_EVT_HVC:
             on_hvc(p_probes, p_ble_evt);
@@ -365,7 +391,7 @@ static uint32_t current_probe_temp_level_char_add(ble_probes_t * p_probes, const
     attr_md.read_perm  = p_probes_init->probe_temp_char_attr_md.read_perm;
     attr_md.write_perm = p_probes_init->probe_temp_char_attr_md2.write_perm;
     attr_md.vloc       = BLE_GATTS_VLOC_USER;
-    attr_md.rd_auth    = 0;
+    attr_md.rd_auth    = 1;                                   /* the value is measured when a client reads it*/
     attr_md.wr_auth    = 0;
     attr_md.vlen       = 0;
 
@@ -782,7 +808,7 @@ uint32_t ble_probes_level_alarm_check(ble_probes_t * p_probes,ble_device_t *p_de
             hvx_params.p_len    = &len1;
             hvx_params.p_data   = current_probe_temp_level_array;
 
-            err_code = sd_ble_gatts_hvx(p_probes->conn_handle, &hvx_params);
+            err_code = wimoto_hvx_send(p_probes->conn_handle, &hvx_params);
 						previous_probe_temp_level = current_probe_temp_level;
 					
         }
@@ -809,25 +835,13 @@ uint32_t ble_probes_level_alarm_check(ble_probes_t * p_probes,ble_device_t *p_de
         if(current_probe_temp_level < probe_temp_low_value)
         {
             alarm[0] = SET_ALARM_LOW;		           				  /*set alarm to 01 if probe temperature level is low */
-						alarm[1] = p_device->device_time_stamp_set[0];	/*capture the timestamp of occurance of alarm*/
-						alarm[2] = p_device->device_time_stamp_set[1];
-						alarm[3] = p_device->device_time_stamp_set[2];
-						alarm[4] = p_device->device_time_stamp_set[3];
-						alarm[5] = p_device->device_time_stamp_set[4];
-						alarm[6] = p_device->device_time_stamp_set[5];
-						alarm[7] = p_device->device_time_stamp_set[6];
+						ble_time_stamp_encode(&alarm[1]);	/*capture the timestamp of occurance of alarm*/
         }
 
         else if(current_probe_temp_level > probe_temp_high_value )
         {
             alarm[0] = SET_ALARM_HIGH;		                  /*set alarm to 02 if probe temperature level is high */
-						alarm[1] = p_device->device_time_stamp_set[0];	/*capture the timestamp of occurance of alarm*/
-						alarm[2] = p_device->device_time_stamp_set[1];
-						alarm[3] = p_device->device_time_stamp_set[2];
-						alarm[4] = p_device->device_time_stamp_set[3];
-						alarm[5] = p_device->device_time_stamp_set[4];
-						alarm[6] = p_device->device_time_stamp_set[5];
-						alarm[7] = p_device->device_time_stamp_set[6];
+						ble_time_stamp_encode(&alarm[1]);	/*capture the timestamp of occurance of alarm*/
         } 
 
     }
@@ -850,7 +864,7 @@ uint32_t ble_probes_level_alarm_check(ble_probes_t * p_probes,ble_device_t *p_de
     if((alarm[0]!= 0x00)&&(p_probes->probe_temp_alarm_set == 0x01))  /*check whether the alarm sets as non zero or alarm set characteristics set as zero*/
     {		
 				//check whether confrmation for indication is not pending
-				if((!m_thermops_alarm_ind_conf_pending)&&(!m_probes_alarm_ind_conf_pending))
+				if(!m_probes_alarm_ind_conf_pending)
 				{
         // Send value if connected and notifying
 
@@ -866,7 +880,7 @@ uint32_t ble_probes_level_alarm_check(ble_probes_t * p_probes,ble_device_t *p_de
             hvx_params.p_len    = &len;
             hvx_params.p_data   = alarm;
 
-            err_code = sd_ble_gatts_hvx(p_probes->conn_handle, &hvx_params);
+            err_code = wimoto_hvx_send(p_probes->conn_handle, &hvx_params);
 						p_probes->probe_alarm_with_time_stamp[0] = alarm[0];
 						if(err_code == NRF_SUCCESS)
 						{
@@ -883,6 +897,42 @@ uint32_t ble_probes_level_alarm_check(ble_probes_t * p_probes,ble_device_t *p_de
     return err_code;
 }
 
+
+/**@brief Function for answering a pending read of the current probe temperature.
+*
+* @details The application calls this function from the main loop after a read of the current
+*          probe temperature was requested.
+*
+* @param[in]   p_probes    Probe Temperature Service structure.
+*
+* @return      NRF_SUCCESS on success, NRF_ERROR_INVALID_STATE if no read is pending, otherwise an error code.
+*/
+uint32_t ble_probes_current_read_reply(ble_probes_t * p_probes)
+{
+    ble_gatts_rw_authorize_reply_params_t auth_reply;
+    uint16_t                              current_value;
+    uint8_t                               current_value_array[2];
+
+    if (!PROBES_READ_PENDING)
+    {
+        return NRF_ERROR_INVALID_STATE;
+    }
+    PROBES_READ_PENDING = false;
+
+    current_value          = read_probe_temp_level();
+    current_value_array[0] = current_value >> 8;
+    current_value_array[1] = (uint8_t)(current_value & LOWER_BYTE_MASK);
+
+    memset(&auth_reply, 0, sizeof(auth_reply));
+
+    auth_reply.type                    = BLE_GATTS_AUTHORIZE_TYPE_READ;
+    auth_reply.params.read.gatt_status = BLE_GATT_STATUS_SUCCESS;
+    auth_reply.params.read.len         = sizeof(current_value_array);
+    auth_reply.params.read.p_data      = current_value_array;       /* the stack copies the value to the characteristic*/
+
+    return sd_ble_gatts_rw_authorize_reply(p_probes->conn_handle, &auth_reply);
+}
+
 /**@brief Function to read probe temperature level from sensor interfaced to ADC.
 *
 * @param[in]   void
@@ -128,6 +128,14 @@ void ble_probes_on_ble_evt(ble_probes_t * p_probes, ble_evt_t * p_ble_evt);
 */
 
 uint32_t ble_probes_level_alarm_check(ble_probes_t *,ble_device_t *);
+
+/**@brief Function for answering a pending read of the current probe temperature with a new measurement.
+*
+* @param[in]   p_probes    Probe Temperature Service structure.
+*
+* @return      NRF_SUCCESS on success, NRF_ERROR_INVALID_STATE if no read is pending, otherwise an error code.
+*/
+uint32_t ble_probes_current_read_reply(ble_probes_t *);
 float convert_probe_level_to_float(uint16_t);
 
 uint16_t read_probe_temp_level(void);											/**@brief Function for reading probe temperature from sensor **/
@@ -26,19 +26,20 @@
 #include "ble_srv_common.h"
 #include "app_util.h"
 #include "wimoto.h"
+#include "wimoto_evt.h"
+#include "wimoto_hvx.h"
 #include "wimoto_sensors.h"
+#include "wimoto_format.h"
 #include "app_error.h"
 
 bool     	      	THERMOPS_CONNECTED_STATE=false;  /*Indicates whether the thermopile service is connected or not*/
-extern bool 	  	CHECK_ALARM_TIMEOUT;
 uint8_t         	current_thermopile_temp_store[THERMOP_CHAR_SIZE];
 extern uint8_t	 	var_receive_uuid;									/*variable to receive uuid*/
-extern uint8_t		thermopile[5];                    /*variable to store current Thermopile temperature to broadcast*/
-extern bool       CHECK_ALARM_TIMEOUT;							
+extern uint8_t		thermopile[THERMOP_CHAR_SIZE];                    /*variable to store current Thermopile temperature to broadcast*/
 bool              thermop_alarm_set_changed = false;
 
 bool     				m_thermops_alarm_ind_conf_pending = false;       /**< Flag to keep track of when an indication confirmation is pending. */
-extern bool     m_probes_alarm_ind_conf_pending;
+bool     				THERMOPS_READ_PENDING = false;       /**< Flag to keep track of when a read of the current thermopile temperature waits for a measurement. */
 
 /**@brief Function for handling the Connect event.
 *
@@ -49,7 +50,7 @@ static void on_connect(ble_thermops_t * p_thermops, ble_evt_t * p_ble_evt)
 {
     p_thermops->conn_handle  = p_ble_evt->evt.gap_evt.conn_handle;
     THERMOPS_CONNECTED_STATE = true;  /*Set the flag to true so that state remains in connectable mode until disconnect*/
-		CHECK_ALARM_TIMEOUT      = true;  /*set the flag to check alarm condition on connect*/
+		wimoto_evt_post(WIMOTO_EVT_ALARM_CHECK); /*check the alarm conditions on connection*/
 }
 
 
@@ -66,6 +67,27 @@ static void on_disconnect(ble_thermops_t * p_thermops, ble_evt_t * p_ble_evt)
 }
 
 
+/**@brief Function for handling the Read/Write Authorization Request event.
+*
+* @details A read of the current thermopile temperature is answered by ble_thermops_current_read_reply() once the main loop
+*          has taken a new measurement.
+*
+* @param[in]   p_thermops   Thermopile Service structure.
+* @param[in]   p_ble_evt    Event received from the BLE stack.
+*/
+static void on_rw_authorize_request(ble_thermops_t * p_thermops, ble_evt_t * p_ble_evt)
+{
+    ble_gatts_evt_rw_authorize_request_t * p_auth_req = &p_ble_evt->evt.gatts_evt.params.authorize_request;
+
+    if ((p_auth_req->type == BLE_GATTS_AUTHORIZE_TYPE_READ) &&
+        (p_auth_req->request.read.handle == p_thermops->current_thermop_handles.value_handle))
+    {
+        THERMOPS_READ_PENDING = true;
+        wimoto_evt_post(WIMOTO_EVT_READ_SENSORS);    /* the measurement is taken from the main loop*/
+    }
+}
+
+
 /**@brief Function for handling write events on values.
 *
 * @details This function will be called for all write events of temperature low, high values and alarm set 
@@ -73,7 +95,7 @@ static void on_disconnect(ble_thermops_t * p_thermops, ble_evt_t * p_ble_evt)
 */
 static void write_evt_handler(void)
 {   
-    CHECK_ALARM_TIMEOUT = true; 
+    wimoto_evt_post(WIMOTO_EVT_ALARM_CHECK);
 }
 
 static void on_thermops_evt(ble_thermops_t * p_thermops, ble_thermops_alarm_evt_t *p_evt)
@@ -265,15 +287,12 @@ static void on_write(ble_thermops_t * p_thermops, ble_evt_t * p_ble_evt)
     if (
             (p_evt_write->handle == p_thermops->thermop_low_level_handles.value_handle) 
             && 
-            (p_evt_write->len == 5)
+            (p_evt_write->len == THERMOP_CHAR_SIZE)
             )
     {
         // update the temperature service structure
         p_thermops->thermo_thermopile_low_level[0] =   p_evt_write->data[0];
         p_thermops->thermo_thermopile_low_level[1] =   p_evt_write->data[1];
-        p_thermops->thermo_thermopile_low_level[2] =   p_evt_write->data[2];
-        p_thermops->thermo_thermopile_low_level[3] =   p_evt_write->data[3];
-        p_thermops->thermo_thermopile_low_level[4] =   p_evt_write->data[4];
 
         // call application event handler
         p_thermops->write_evt_handler();
@@ -283,15 +302,12 @@ static void on_write(ble_thermops_t * p_thermops, ble_evt_t * p_ble_evt)
     if (
             (p_evt_write->handle == p_thermops->thermop_high_level_handles.value_handle) 
             && 
-            (p_evt_write->len == 5)
+            (p_evt_write->len == THERMOP_CHAR_SIZE)
             )
     {
         // update the temperature service structure
         p_thermops->thermo_thermopile_high_level[0] =   p_evt_write->data[0];
         p_thermops->thermo_thermopile_high_level[1] =   p_evt_write->data[1];
-        p_thermops->thermo_thermopile_high_level[2] =   p_evt_write->data[2];
-        p_thermops->thermo_thermopile_high_level[3] =   p_evt_write->data[3];
-        p_thermops->thermo_thermopile_high_level[4] =   p_evt_write->data[4];
 
         // call application event handler
         p_thermops->write_evt_handler();
@@ -342,11 +358,16 @@ void ble_thermops_on_ble_evt(ble_thermops_t * p_thermops, ble_evt_t * p_ble_evt)
 
     case BLE_GAP_EVT_DISCONNECTED:
 				m_thermops_alarm_ind_conf_pending = false;															//Clear pending confirmation flag if a disconnect occurs
+				THERMOPS_READ_PENDING = false;
         on_disconnect(p_thermops, p_ble_evt);
         break;
 
     case BLE_GATTS_EVT_WRITE:
         on_write(p_thermops, p_ble_evt);
+        break;
+
+    case BLE_GATTS_EVT_RW_AUTHORIZE_REQUEST:
+        on_rw_authorize_request(p_thermops, p_ble_evt);
         break;
 		case BLE_GATTS_EVT_HVC:
             on_hvc(p_thermops, p_ble_evt);
@@ -374,7 +395,7 @@ static uint32_t current_thermopile_char_add(ble_thermops_t * p_thermops, const b
     ble_gatts_attr_t    attr_char_value;
     ble_uuid_t          ble_uuid;
     ble_gatts_attr_md_t attr_md;
-    static uint8_t      current_thermopile[5];
+    static uint8_t      current_thermopile[THERMOP_CHAR_SIZE];
 
     if (p_thermops->is_notification_supported)
     {
@@ -402,7 +423,7 @@ static uint32_t current_thermopile_char_add(ble_thermops_t * p_thermops, const b
     attr_md.read_perm  = p_thermops_init->thermopile_char_attr_md.read_perm;
     attr_md.write_perm = p_thermops_init->thermopile_char_attr_md2.write_perm;
     attr_md.vloc       = BLE_GATTS_VLOC_USER;
-    attr_md.rd_auth    = 0;
+    attr_md.rd_auth    = 1;                                   /* the value is measured when a client reads it*/
     attr_md.wr_auth    = 0;
     attr_md.vlen       = 0;
 
@@ -441,7 +462,7 @@ static uint32_t thermopile_low_value_char_add(ble_thermops_t * p_thermops, const
     ble_gatts_attr_t    attr_char_value;
     ble_uuid_t          ble_uuid;
     ble_gatts_attr_md_t attr_md;
-    static uint8_t      thermo_thermopile_low_level[5];
+    static uint8_t      thermo_thermopile_low_level[THERMOP_CHAR_SIZE];
 
     // Add Thermopile low value characteristic
     memset(&char_md, 0, sizeof(char_md));
@@ -468,9 +489,6 @@ static uint32_t thermopile_low_value_char_add(ble_thermops_t * p_thermops, const
     attr_md.wr_auth    = 0;
     attr_md.vlen       = 0;
 
-    thermo_thermopile_low_level[4] = p_thermops_init->thermo_thermopile_low_level[4];
-    thermo_thermopile_low_level[3] = p_thermops_init->thermo_thermopile_low_level[3];
-    thermo_thermopile_low_level[2] = p_thermops_init->thermo_thermopile_low_level[2];		
     thermo_thermopile_low_level[1] = p_thermops_init->thermo_thermopile_low_level[1];
     thermo_thermopile_low_level[0] = p_thermops_init->thermo_thermopile_low_level[0];		
     memset(&attr_char_value, 0, sizeof(attr_char_value));
@@ -509,7 +527,7 @@ static uint32_t thermopile_high_value_char_add(ble_thermops_t * p_thermops, cons
     ble_gatts_attr_t    attr_char_value;
     ble_uuid_t          ble_uuid;
     ble_gatts_attr_md_t attr_md;
-    static uint8_t      thermo_thermopile_high_level[5];
+    static uint8_t      thermo_thermopile_high_level[THERMOP_CHAR_SIZE];
 
 
     memset(&char_md, 0, sizeof(char_md));
@@ -536,9 +554,6 @@ static uint32_t thermopile_high_value_char_add(ble_thermops_t * p_thermops, cons
     attr_md.wr_auth    = 0;
     attr_md.vlen       = 0;
 
-    thermo_thermopile_high_level[4] = p_thermops_init->thermo_thermopile_high_level[4];
-    thermo_thermopile_high_level[3] = p_thermops_init->thermo_thermopile_high_level[3];  /*Default values for thermopile high value*/
-    thermo_thermopile_high_level[2] = p_thermops_init->thermo_thermopile_high_level[2];	
     thermo_thermopile_high_level[1] = p_thermops_init->thermo_thermopile_high_level[1];  /*Default values for thermopile high value*/
     thermo_thermopile_high_level[0] = p_thermops_init->thermo_thermopile_high_level[0];	
 
@@ -737,15 +752,9 @@ uint32_t ble_thermops_init(ble_thermops_t * p_thermops, const ble_thermops_init_
     p_thermops->is_notification_supported = p_thermops_init->support_notification;
 
 
-    p_thermops->thermo_thermopile_high_level[4] = p_thermops_init->thermo_thermopile_high_level[4];
-    p_thermops->thermo_thermopile_high_level[3] = p_thermops_init->thermo_thermopile_high_level[3];  /*Default values for thermopile high value*/
-    p_thermops->thermo_thermopile_high_level[2] = p_thermops_init->thermo_thermopile_high_level[2];	
     p_thermops->thermo_thermopile_high_level[1] = p_thermops_init->thermo_thermopile_high_level[1];  /*Default values for thermopile high value*/
     p_thermops->thermo_thermopile_high_level[0] = p_thermops_init->thermo_thermopile_high_level[0];	
 
-    p_thermops->thermo_thermopile_low_level[4] = p_thermops_init->thermo_thermopile_low_level[4];
-    p_thermops->thermo_thermopile_low_level[3] = p_thermops_init->thermo_thermopile_low_level[3];
-    p_thermops->thermo_thermopile_low_level[2] = p_thermops_init->thermo_thermopile_low_level[2];		
     p_thermops->thermo_thermopile_low_level[1] = p_thermops_init->thermo_thermopile_low_level[1];
     p_thermops->thermo_thermopile_low_level[0] = p_thermops_init->thermo_thermopile_low_level[0];		
 
@@ -804,14 +813,14 @@ uint32_t ble_thermops_init(ble_thermops_t * p_thermops, const ble_thermops_init_
 uint32_t ble_thermops_level_alarm_check(ble_thermops_t * p_thermops,ble_device_t *p_device)
 {
     uint32_t err_code = NRF_SUCCESS;
-    float current_thermopile;
+    int32_t current_thermopile;
     uint8_t  current_thermopile_array[THERMOP_CHAR_SIZE];
-	  float thermopile_low_value;		
-    float thermopile_high_value;		
+	  int32_t thermopile_low_value;		
+    int32_t thermopile_high_value;		
 	
 		
 		
-    static float  previous_thermopile = 0x00;
+    static int32_t  previous_thermopile = 0x00;
 	
     static uint8_t alarm[8]= {0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00};
 
@@ -843,7 +852,7 @@ uint32_t ble_thermops_level_alarm_check(ble_thermops_t * p_thermops,ble_device_t
             hvx_params.p_len    = &len1;
             hvx_params.p_data   = current_thermopile_array;
 
-            err_code = sd_ble_gatts_hvx(p_thermops->conn_handle, &hvx_params);
+            err_code = wimoto_hvx_send(p_thermops->conn_handle, &hvx_params);
 						previous_thermopile = current_thermopile;
         }
         else
@@ -853,10 +862,10 @@ uint32_t ble_thermops_level_alarm_check(ble_thermops_t * p_thermops,ble_device_t
     }		
 
     /*Get the thermopile low value set by the user from the service */
-    thermopile_low_value  = stof((char *)(p_thermops->thermo_thermopile_low_level));
+    thermopile_low_value  = wimoto_decode_int16(p_thermops->thermo_thermopile_low_level);
 
     /*Get the thermopile high value set by the user from the service */
-    thermopile_high_value = stof(((char *)p_thermops->thermo_thermopile_high_level));
+    thermopile_high_value = wimoto_decode_int16(p_thermops->thermo_thermopile_high_level);
 
    
 		/*Check whether the thermopile temperature is out of range if alarm is set by user */		
@@ -865,25 +874,13 @@ uint32_t ble_thermops_level_alarm_check(ble_thermops_t * p_thermops,ble_device_t
 			  if(current_thermopile < thermopile_low_value)
         {
             alarm[0] = SET_ALARM_THERMOP_LOW;		               /*set alarm to 01 if thermopile is low*/
-						alarm[1]=p_device->device_time_stamp_set[0];       /*capture the current timestamp when alarm occured*/
-				    alarm[2]=p_device->device_time_stamp_set[1];
-				    alarm[3]=p_device->device_time_stamp_set[2];
-				    alarm[4]=p_device->device_time_stamp_set[3];
-				    alarm[5]=p_device->device_time_stamp_set[4];
-				    alarm[6]=p_device->device_time_stamp_set[5];
-				    alarm[7]=p_device->device_time_stamp_set[6];
+						ble_time_stamp_encode(&alarm[1]);	/*capture the current timestamp when alarm occured*/
 				}
 
         else if(current_thermopile > thermopile_high_value)
         {
             alarm[0] = SET_ALARM_THERMOP_HIGH;									//set alarm to 02 if thermopile is high
-						alarm[1]=p_device->device_time_stamp_set[0];       //capture the current timestamp when alarm occured
-				    alarm[2]=p_device->device_time_stamp_set[1];
-				    alarm[3]=p_device->device_time_stamp_set[2];
-				    alarm[4]=p_device->device_time_stamp_set[3];
-				    alarm[5]=p_device->device_time_stamp_set[4];
-				    alarm[6]=p_device->device_time_stamp_set[5];
-				    alarm[7]=p_device->device_time_stamp_set[6];
+						ble_time_stamp_encode(&alarm[1]);	//capture the current timestamp when alarm occured
 				} 
 
     }
@@ -907,7 +904,7 @@ uint32_t ble_thermops_level_alarm_check(ble_thermops_t * p_thermops,ble_device_t
     if((alarm[0]!= 0x00)&&(p_thermops->thermo_thermopile_alarm_set == 0x01)) /*check whether the alarm  is tripped and  alarm set characteristics in ON*/
     {	
 				//check whether confrmation for indication is not pending
-				if((!m_thermops_alarm_ind_conf_pending)&&(!m_probes_alarm_ind_conf_pending))
+				if(!m_thermops_alarm_ind_conf_pending)
 				{
 				// Send value if connected and notifying
 
@@ -925,7 +922,7 @@ uint32_t ble_thermops_level_alarm_check(ble_thermops_t * p_thermops,ble_device_t
             hvx_params.p_len    = &len;
             hvx_params.p_data   = alarm;
 
-            err_code = sd_ble_gatts_hvx(p_thermops->conn_handle, &hvx_params);
+            err_code = wimoto_hvx_send(p_thermops->conn_handle, &hvx_params);
 						p_thermops->thermo_alarm_with_time_stamp[0] = alarm[0];
 						if(err_code == NRF_SUCCESS)
 						{
@@ -944,16 +941,44 @@ uint32_t ble_thermops_level_alarm_check(ble_thermops_t * p_thermops,ble_device_t
 
 }
 
+
+/**@brief Function for answering a pending read of the current thermopile temperature.
+*
+* @details The application calls this function from the main loop after a read of the current
+*          thermopile temperature was requested and the thermopile conversion is read.
+*
+* @param[in]   p_thermops    Thermopile Service structure.
+*
+* @return      NRF_SUCCESS on success, NRF_ERROR_INVALID_STATE if no read is pending, otherwise an error code.
+*/
+uint32_t ble_thermops_current_read_reply(ble_thermops_t * p_thermops)
+{
+    ble_gatts_rw_authorize_reply_params_t auth_reply;
+
+    if (!THERMOPS_READ_PENDING)
+    {
+        return NRF_ERROR_INVALID_STATE;
+    }
+    THERMOPS_READ_PENDING = false;
+
+    memset(&auth_reply, 0, sizeof(auth_reply));
+
+    auth_reply.type                    = BLE_GATTS_AUTHORIZE_TYPE_READ;
+    auth_reply.params.read.gatt_status = BLE_GATT_STATUS_SUCCESS;
+    auth_reply.params.read.len         = THERMOP_CHAR_SIZE;
+    auth_reply.params.read.p_data      = current_thermopile_temp_store;       /* the stack copies the value to the characteristic*/
+
+    return sd_ble_gatts_rw_authorize_reply(p_thermops->conn_handle, &auth_reply);
+}
+
 /**@brief Function to read thermopile from tmp006.
 *
 * @param[out]   uint8_t *buffer 
-* @param[out]   float *fTemp
+* @param[out]   int32_t *p_temp   thermopile temperature in 0.01 degC
 */
-void read_thermopile_connectable(uint8_t *buffer, float *fTemp)   
+void read_thermopile_connectable(uint8_t *buffer, int32_t *p_temp)   
 {
-    twi_turn_ON();
-    do_thermopile_measurement(buffer, fTemp);
-    twi_turn_OFF();
+    do_thermopile_measurement(buffer, p_temp);
     return;
 }	
 
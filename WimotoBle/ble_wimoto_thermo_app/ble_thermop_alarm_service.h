@@ -68,8 +68,8 @@ typedef struct
     ble_thermops_write_evt_handler_t write_evt_handler;
     bool                          support_notification;              /**< TRUE if notification of Thermopile Level measurement is supported. */
     ble_srv_report_ref_t *        p_report_ref;                      /**< If not NULL, a Report Reference descriptor with the specified value will be added to the Thermopile Level characteristic */
-    uint8_t                       thermo_thermopile_low_level[5];  /**< thermopile low level */
-    uint8_t                       thermo_thermopile_high_level[5]; /**< thermopile high level */
+    uint8_t                       thermo_thermopile_low_level[2];  /**< thermopile low level, 0.01 degC MSB first */
+    uint8_t                       thermo_thermopile_high_level[2]; /**< thermopile high level, 0.01 degC MSB first */
     uint8_t												thermo_thermopile_alarm_set;     /** Alarm set for thermopile **/
     uint8_t												thermo_alarm_with_time_stamp[8];  /** Alarm for thermopile with time stamp**/
     ble_srv_cccd_security_mode_t  thermopile_char_attr_md;          /**< Initial security level for Thermopile characteristics attribute */
@@ -91,8 +91,8 @@ typedef struct ble_thermops_s
     ble_gatts_char_handles_t      thermo_thermop_alarm_handles;      	/**< Handles for thermopile alarm characteristic. */
     ble_gatts_char_handles_t      switch_mode_handles;      	/**< Handles for thermopile alarm characteristic. */
     uint16_t                      report_ref_handle;              	/**< Handle of the Report Reference descriptor. */
-    uint8_t                       thermo_thermopile_low_level[5];   	/**< thermopile low level for alarm for thermopile Service. */
-    uint8_t                       thermo_thermopile_high_level[5];   /**< thermopile high level for alarm for thermopile Service. */
+    uint8_t                       thermo_thermopile_low_level[2];   	/**< thermopile low level for alarm for thermopile Service, 0.01 degC MSB first. */
+    uint8_t                       thermo_thermopile_high_level[2];   /**< thermopile high level for alarm for thermopile Service, 0.01 degC MSB first. */
     uint8_t						            thermo_thermopile_alarm_set;   	/** Alarm set for thermopile **/
     uint8_t						            thermo_alarm_with_time_stamp[8];  /** Alarm for thermopile with time stamp**/
     uint16_t                      conn_handle;                    /**< Handle of the current connection (as provided by the BLE stack, is BLE_CONN_HANDLE_INVALID if not in a connection). */
@@ -142,12 +142,18 @@ void ble_thermops_on_ble_evt(ble_thermops_t * p_bas, ble_evt_t * p_ble_evt);
 */
 uint32_t ble_thermops_level_alarm_check(ble_thermops_t *,ble_device_t *);
 
+/**@brief Function for answering a pending read of the current thermopile temperature with a new measurement.
+*
+* @param[in]   p_thermops    Thermopile Service structure.
+*
+* @return      NRF_SUCCESS on success, NRF_ERROR_INVALID_STATE if no read is pending, otherwise an error code.
+*/
+uint32_t ble_thermops_current_read_reply(ble_thermops_t *);
+
 
 //uint32_t read_thermopile(void);									 /** Function for reading thermopile from sensor **/
-void read_thermopile_connectable(uint8_t *, float *);
+void read_thermopile_connectable(uint8_t *, int32_t *);
 static uint8_t  do_battery_measurement(void);						 /*funtion for taking the battery measurement*/
-//float    convert_thermopile_to_float(uint16_t );  /*function for converting 12-bit thermopile to float*/
-float stof(char*);
 #endif 
 
 /** @} */
@@ -30,6 +30,7 @@
 #include "nrf_temp.h"
 #include "twi_master.h"
 #include "app_timer.h"
+#include "app_gpiote.h"
 #include "wimoto_sensors.h"
 #include "wimoto.h"
 #include "ble_thermop_alarm_service.h"
@@ -56,6 +57,7 @@ static bool                                  m_memory_access_in_progress = false
 #define APP_TIMER_PRESCALER                  0                                          /**< Value of the RTC1 PRESCALER register. */
 #define APP_TIMER_MAX_TIMERS                 3                                          /**< Maximum number of simultaneously created timers. */
 #define APP_TIMER_OP_QUEUE_SIZE              4                                          /**< Size of timer operation queues. */
+#define APP_GPIOTE_MAX_USERS                 1                                          /**< Maximum number of users of the GPIOTE handler. */
 static ble_thermops_t                        m_thermops;                                /**< Structure used to identify the temperature value service. */
 static ble_probes_t                          m_probes;                                  /**< Structure used to identify the humidity alarm service. */
 static ble_dlogs_t                           m_dlogs;																	  /**< Structure used to identify the data logger service. */
@@ -76,6 +78,9 @@ extern ble_bas_t                             			 bas;
 
 extern bool 	  BROADCAST_MODE;
 static volatile bool m_do_update = false;
+static volatile bool m_thermopile_ready = false;                                         /**< Thermopile conversion is ready (DRDY)*/
+static bool          m_thermopile_converting = false;                                    /**< Thermopile conversion is in progress*/
+static app_gpiote_user_id_t m_thermopile_drdy_gpiote;                                    /**< Thermopile data ready gpiote*/
 
 /*****************************************************************************
 * Error Handling Functions
@@ -228,26 +233,23 @@ static void advertising_init()
     ble_advdata_t              advdata;
     ble_advdata_service_data_t service_data[1];
     uint8_t                    flags = BLE_GAP_ADV_FLAG_BR_EDR_NOT_SUPPORTED;
-    uint8_t				             thermopile[5];    
+    uint8_t				             thermopile[THERMOP_CHAR_SIZE];    
     uint8_t				             curr_probe_temp_level;      
-    float 									 	 fTemp;
+    int32_t 									 	 temp;
     ble_advdata_manuf_data_t   manuf_specific_data;
-    uint8_t                    manuf_data_array[6];
+    uint8_t                    manuf_data_array[3];
 
     uint8_t battery              = do_battery_measurement();
     service_data[0].service_uuid = BLE_UUID_BATTERY_SERVICE;
     service_data[0].data.p_data  = &battery;
     service_data[0].data.size    = sizeof(battery);
 
-		do_thermopile_measurement(thermopile, &fTemp);                          /*read thermopile temperature*/
+		do_thermopile_measurement(thermopile, &temp);                          /*read thermopile temperature*/
 		do_probe_temp_measurement(&curr_probe_temp_level);                      /*read probe temperature*/
 
     manuf_data_array[0] = thermopile[0];
     manuf_data_array[1] = thermopile[1];
-    manuf_data_array[2] = thermopile[2];
-    manuf_data_array[3] = thermopile[3];
-    manuf_data_array[4] = thermopile[4];
-    manuf_data_array[5] = curr_probe_temp_level;
+    manuf_data_array[2] = curr_probe_temp_level;
 
     manuf_specific_data.company_identifier = COMPANY_IDENTIFER;             /*COMPANY IDENTIFIER */
     manuf_specific_data.data.p_data = manuf_data_array;
@@ -285,6 +287,32 @@ void radio_notification_callback(bool is_radio_active)
 }
 
 
+/**@brief event handler for the thermopile data ready GPIOTE module.
+*/
+static void thermopile_drdy_evt_handler(uint32_t pins_low_to_high_mask, uint32_t pins_high_to_low_mask)
+{
+    m_thermopile_ready = true;
+}
+
+
+/**@brief Function for initializing the GPIOTE handler module for the thermopile DRDY pin.
+*/
+static void gpiote_init(void)
+{
+    uint32_t err_code;
+
+    APP_GPIOTE_INIT(APP_GPIOTE_MAX_USERS);
+
+    nrf_gpio_cfg_input(TMP006_DRDY_GPIOTE_PIN, NRF_GPIO_PIN_PULLUP);
+
+    err_code = app_gpiote_user_register(&m_thermopile_drdy_gpiote, NULL, TMP006_DRDY_PINS_HIGH_TO_LOW_MASK, thermopile_drdy_evt_handler);
+    APP_ERROR_CHECK(err_code);
+
+    err_code = app_gpiote_user_enable(m_thermopile_drdy_gpiote);
+    APP_ERROR_CHECK(err_code);
+}
+
+
 /**@brief Initialize Radio Notification event handler.
 */
 static void radio_notification_init(void)
@@ -413,6 +441,7 @@ void broadcast_mode(void)
         ble_stack_init();
         twi_master_init(); 						  			/*configure twi*/
         adc_init();                           /*Initialize ADC*/
+        gpiote_init();                        /*Initialize the thermopile DRDY event*/
         radio_notification_init();
         gap_params_init();              			/*Initialize Bluetooth Stack parameters*/
         advertising_init();             
@@ -423,14 +452,26 @@ void broadcast_mode(void)
         {
             if (m_do_update)                 	   
             {
-                twi_turn_ON();
-                advertising_init();       			/*Advertising is done only if radio is active */
-                twi_turn_OFF();
+                if (!m_thermopile_converting)
+                {
+                    twi_turn_ON();
+                    m_thermopile_converting = TMP006_trigger_conversion();  /*the advertising data is updated once the conversion is ready*/
+                    m_thermopile_ready      = !m_thermopile_converting;     /*no conversion, update with the previous thermopile temperature*/
+                    twi_turn_OFF();
+                }
+                else
+                {
+                    m_thermopile_ready = true;                              /*DRDY missed, the conversion is over by the next advertising event*/
+                }
                 m_do_update = false;
             }
-            else
+            if (m_thermopile_ready)
             {
-                twi_turn_OFF();									/*Switch OFF twi when radio is off*/		
+                twi_turn_ON();
+                advertising_init();       			/*Advertising is done only if radio is active */
+                twi_turn_OFF();
+                m_thermopile_converting = false;
+                m_thermopile_ready      = false;
             }
             // Switch to a low power state until an event is available for the application
             err_code = sd_app_evt_wait();
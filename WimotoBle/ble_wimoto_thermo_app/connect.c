@@ -36,6 +36,7 @@
 #include "ble_conn_params.h"
 #include "softdevice_handler.h"
 #include "app_timer.h"
+#include "app_scheduler.h"
 #include "app_gpiote.h"
 #include "app_button.h"
 #include "ble_error_log.h"
@@ -45,6 +46,11 @@
 #include "ble_bas.h"
 #include "wimoto_sensors.h"
 #include "wimoto.h"
+#include "wimoto_format.h"
+#include "wimoto_time.h"
+#include "wimoto_evt.h"
+#include "wimoto_hvx.h"
+#include "twi_hw_master.h"
 #include "ble_device_mgmt_service.h"
 #include "battery.h"
 #include "boards.h"
@@ -69,12 +75,15 @@ static bool                                  m_memory_access_in_progress = false
 #define APP_ADV_TIMEOUT_IN_SECONDS           0x0000                                     /**< The advertising timeout in units of seconds. */
 
 #define APP_TIMER_PRESCALER                  0                                          /**< Value of the RTC1 PRESCALER register. */
-#define APP_TIMER_MAX_TIMERS                 5                                          /**< Maximum number of simultaneously created timers. */
+#define APP_TIMER_MAX_TIMERS                 5                                          /**< Maximum number of simultaneously created timers: four in timers_init and one in ble_conn_params. */
 #define APP_TIMER_OP_QUEUE_SIZE              4                                          /**< Size of timer operation queues. */
 																														
-#define THERMOPILE_LEVEL_MEAS_INTERVAL       APP_TIMER_TICKS(60000, APP_TIMER_PRESCALER)/**< temperature level measurement interval (ticks). */
+#define DATA_LOG_TIMER_MAX_SECONDS           480                                        /**< Longest timeout of the data logger timer, the 24 bit RTC1 counter wraps after 512 s (seconds). */
 #define CONNECTED_MODE_TIMEOUT_INTERVAL      APP_TIMER_TICKS(30000, APP_TIMER_PRESCALER)/**< Connected mode timeout interval (ticks). */
 #define SECONDS_INTERVAL                     APP_TIMER_TICKS(1000, APP_TIMER_PRESCALER) /**< seconds measurement interval (ticks). */
+#define TIME_KEEPING_SECONDS                 30                                         /**< Interval of the time keeping timer, shorter than the 512 s wrap of the RTC1 counter (seconds). */
+#define TIME_KEEPING_INTERVAL                APP_TIMER_TICKS(TIME_KEEPING_SECONDS * 1000, APP_TIMER_PRESCALER) /**< Time keeping interval (ticks). */
+#define BATTERY_MEAS_TICKS                   ((BATTERY_MEAS_INTERVAL * 60) / TIME_KEEPING_SECONDS)        /**< Time keeping intervals between battery measurements. */
 #define BROADCAST_INTERVAL       						 APP_TIMER_TICKS(1000, APP_TIMER_PRESCALER) /**< updating interval of broadcast data*/ 
 
 #define THERMOP_TYPE_AS_CHARACTERISTIC       0                                          /**< Determines if temperature type is given as characteristic (1) or as a field of measurement (0). */
@@ -98,6 +107,7 @@ static bool                                  m_memory_access_in_progress = false
 #define MAX_CONN_PARAMS_UPDATE_COUNT         3                                          /**< Number of attempts before giving up the connection parameter negotiation. */
 
 #define APP_GPIOTE_MAX_USERS                 1                                          /**< Maximum number of users of the GPIOTE handler. */
+#define THERMOPILE_DRDY_TIMEOUT              APP_TIMER_TICKS(TMP006_CONVERSION_TIME_MS + 250, APP_TIMER_PRESCALER) /**< Check the thermopile even if DRDY is missed, a little after the conversion is due. */
 
 #define BUTTON_DETECTION_DELAY               APP_TIMER_TICKS(50, APP_TIMER_PRESCALER)   /**< Delay from a GPIOTE event until a button is reported as pushed (in number of timer ticks). */
 
@@ -128,29 +138,23 @@ static ble_device_t                          m_device;
 
 static app_timer_id_t                        thermop_measurement_timer;                 /**< thermo measurement timer. */
 static app_timer_id_t                        real_time_timer;                           /**< Time keeping timer. */
-static app_timer_id_t                        delay_timer;                               /**< Timer for implementing delay. */
+static app_timer_id_t                        thermopile_drdy_timer;                     /**< Fallback for a missed thermopile data ready event. */
+static app_gpiote_user_id_t                  thermopile_drdy_gpiote;                    /**< Thermopile data ready gpiote. */
 
 uint8_t 							                       battery_level=0; 
-ble_date_time_t                              m_time_stamp;                              /**< Time stamp. */
 ble_bas_t                             			 bas;                                       /**< Structure used to identify the battery service. */
 
 bool 																				 ENABLE_DATA_LOG=false;											/**< Flag to enable data logger */
-bool																				 ENABLE_DLOG_TIMER=false;										/**< Flag to start the data logger timer */
-bool																				 RESET_DLOG_TIMER = false;									/**< Flag to reset the data logger timer and make sure first log is 15 minutes later*/
-bool 																				 READ_DATA=false; 										      /**< Flag to enable data logger reading */
+static uint32_t                              m_dlog_timer_remaining = 0;                /**< Seconds of the logging interval left after the running data logger timeout. */
+volatile bool 																				 READ_DATA=false; 										      /**< Flag to enable data logger reading */
+bool 																				 DOWNLOAD_DATA     = false;                 /**< Flag to indicate that a data log download is in progress */
 bool 																				 START_DATA_READ=true;											/**< flag to start data logging*/
 bool 																				 TX_COMPLETE=false;				      						/**< flag to indicate transmission complete*/ 
-bool                                         TIME_SET = false;                          /**< flag to indicate user set time*/
-bool                                         CHECK_ALARM_TIMEOUT = false;               /**< Flag to indicate whether to check for alarm conditions*/
-bool                                         DATA_LOG_CHECK=false;                      /**< Flag to indicate whether to check for data logging*/
-bool                                         MEAS_BATTERY_LEVEL = true;                /**< Flag for measuring the battery level */
-bool                                         delay_complete = false;                    /**< Flag to indicate the completion of delay*/
 
 extern bool                                  THERMOPS_CONNECTED_STATE;                  /**< This flag indicates thermopile temperature service is in connected start or now*/
 extern bool                                  PROBES_CONNECTED_STATE;                    /**< This flag indicates probe temperature service is in connected start or now*/
+extern bool                                  THERMOPS_READ_PENDING;                     /**< This flag indicates a client read of the current thermopile temperature*/
 extern bool																	 DLOGS_CONNECTED_STATE;                     /**< This flag indicates data logger is connected/not*/
-extern bool  																 DFU_ENABLE;                                /**< This flag indicates DFU mode is connected/not*/
-extern bool																	 LED_FLASH;																	/**< This flag indicates whether or not to flash the LED*/
 extern bool                                  DEVICE_CONNECTED_STATE;                    /**< This flag indicates device management service is in connected start or now*/
 bool                                         ACTIVE_CONN_FLAG = false;                  /**<flag indicating active connection*/
 
@@ -161,8 +165,7 @@ extern uint8_t  current_thermopile_temp_store[THERMOP_CHAR_SIZE];
 
 static uint8_t															 rev_no;																		/**<Revision number of silicon*/
 
-uint32_t buf[4];  													 					/*buffer for flash write operation*/
-uint8_t	 thermopile[5];    														/*variable to store current Thermopile temperature to broadcast*/
+uint8_t	 thermopile[THERMOP_CHAR_SIZE];    														/*variable to store current Thermopile temperature to broadcast*/
 uint8_t	 curr_probe_temp_level[2];										/*variable to store current probe temperature to broadcast*/
 uint8_t  battery_lvl;                                 /*battery level for broadcasting*/
 uint16_t									 log_id = 0x00;																/* Record ID for data logs*/
@@ -236,32 +239,91 @@ app_error_handler(DEAD_BEEF, line_num, p_file_name);
 }
 
 
+/**@brief Function for starting a thermopile conversion, thermopile_check() runs once it is ready.
+*
+* @details TMP006 signals the end of the conversion on DRDY. The fallback timer runs the check if
+*          the DRDY event is missed.
+*/
+static void thermopile_trigger(void)
+{
+    uint32_t err_code;
+
+    if (TMP006_trigger_conversion() == false)
+    {
+        wimoto_evt_post(WIMOTO_EVT_THERMOPILE_READY);                 /*no conversion, check with the previous thermopile temperature*/
+        return;
+    }
+    err_code = app_timer_start(thermopile_drdy_timer, THERMOPILE_DRDY_TIMEOUT, NULL);
+    APP_ERROR_CHECK(err_code);
+}
+
+
 /**@brief Function for performing check for the alarm condition.
+*
+* @details The thermopile is checked by thermopile_check() once its conversion is ready.
 */
 static void alarm_check(void)
 {
     uint32_t err_code;
 
-    err_code = ble_thermops_level_alarm_check(&m_thermops,&m_device);  /*check whether the thermopile temperature is out of range*/
-    if ((err_code != NRF_SUCCESS) &&																	 /*passed device management service structure for getting time stamp in thermopile service*/	
+    thermopile_trigger();                                             /*start the thermopile conversion*/
+    err_code = ble_probes_level_alarm_check(&m_probes,&m_device);   /*check whether the probe temperature is out of range*/
+    if ((err_code != NRF_SUCCESS) &&																/*passed device management service structure for getting time stamp in probe level service*/
             (err_code != NRF_ERROR_INVALID_STATE) &&
             (err_code != BLE_ERROR_NO_TX_BUFFERS) &&
             (err_code != BLE_ERROR_GATTS_SYS_ATTR_MISSING)
             )
+    {
+        APP_ERROR_HANDLER(err_code);
+    } 
+
+}		
+
+
+/**@brief Function for answering the reads of the current values with a new measurement.
+*
+* @details The services request the measurement when a client reads a current value, so a
+*          client does not have to wait for the next alarm_check() to see a new value.
+*/
+static void current_read(void)
+{
+    uint32_t err_code;
+
+    err_code = ble_probes_current_read_reply(&m_probes);          /* Answer a pending read of the current probe temperature*/
+    if ((err_code != NRF_SUCCESS) && (err_code != NRF_ERROR_INVALID_STATE))
     {
         APP_ERROR_HANDLER(err_code);
     }
-		delay_ms(100);																							 
-    err_code = ble_probes_level_alarm_check(&m_probes,&m_device);   /*check whether the probe temperature is out of range*/
-    if ((err_code != NRF_SUCCESS) &&																/*passed device management service structure for getting time stamp in probe level service*/
+    if (THERMOPS_READ_PENDING)
+    {
+        thermopile_trigger();                                         /* the read is answered by thermopile_check()*/
+    }
+}
+
+
+/**@brief Function for performing check for the thermopile alarm condition, on the DRDY event.
+*/
+static void thermopile_check(void)
+{
+    uint32_t err_code;
+
+    err_code = app_timer_stop(thermopile_drdy_timer);                 /*DRDY has come, or the fallback has run*/
+    APP_ERROR_CHECK(err_code);
+
+    err_code = ble_thermops_level_alarm_check(&m_thermops,&m_device);  /*read the thermopile conversion and check whether it is out of range*/
+    if ((err_code != NRF_SUCCESS) &&																	 /*passed device management service structure for getting time stamp in thermopile service*/	
             (err_code != NRF_ERROR_INVALID_STATE) &&
             (err_code != BLE_ERROR_NO_TX_BUFFERS) &&
             (err_code != BLE_ERROR_GATTS_SYS_ATTR_MISSING)
             )
     {
         APP_ERROR_HANDLER(err_code);
-    } 
-		delay_ms(100);																							 
+    }
+    err_code = ble_thermops_current_read_reply(&m_thermops);     /* Answer a pending read of the current thermopile temperature*/
+    if ((err_code != NRF_SUCCESS) && (err_code != NRF_ERROR_INVALID_STATE))
+    {
+        APP_ERROR_HANDLER(err_code);
+    }
 		//updating the advertise/broadcast data
 		if(ACTIVE_CONN_FLAG==false)               /* no active connection*/
 			advertising_init();                     
@@ -271,98 +333,63 @@ static void alarm_check(void)
 }		
 
 
-/**@brief Function for performing a thermo parmaters level measurement, and  check for the alarm condition.
+/**@brief Function for starting the data logger timer.
+*
+* @details The timer is single shot and runs for the whole logging interval, an interval longer
+*          than the RTC1 counter range is split into the fewest timeouts possible.
+*
+* @param[in]   seconds   Time until the next data log.
 */
+static void data_log_timer_start(uint32_t seconds)
+{
+    uint32_t err_code;
+    uint32_t timeout = (seconds > DATA_LOG_TIMER_MAX_SECONDS) ? DATA_LOG_TIMER_MAX_SECONDS : seconds;
+
+    m_dlog_timer_remaining = seconds - timeout;
+    err_code = app_timer_start(thermop_measurement_timer, timeout * SECONDS_INTERVAL, NULL);
+    APP_ERROR_CHECK(err_code);
+}
+
 
+/**@brief Function for handling the data logger timer timeout, sets the flag for a data log once
+*        the logging interval has passed.
+*/
 static void thermo_param_meas_timeout_handler(void * p_context)
 {
     UNUSED_PARAMETER(p_context);
-    static uint8_t minutes_count = 0x01;
-		if (RESET_DLOG_TIMER)
-		{
-				minutes_count = 0x01;
-				RESET_DLOG_TIMER = false; 
-		}
-    if (minutes_count < 0x0F)
+    if (m_dlog_timer_remaining != 0)
     {
-        minutes_count++;
+        data_log_timer_start(m_dlog_timer_remaining);     /* Continue the logging interval*/
     }
-    else 
+    else
     {
-        minutes_count =0x01;
-        DATA_LOG_CHECK=true;
+        wimoto_evt_post(WIMOTO_EVT_DATA_LOG);
+        data_log_timer_start(m_dlogs.interval * 60);
     }
-
-
 }
 
 
-/**@brief Function for performing time keeping.
+/**@brief Function for performing time keeping. Executed every TIME_KEEPING_SECONDS.
+*
+* @details The time is counted by RTC1, reading it here keeps up with the wrap of the counter.
 */
 static void real_time_timeout_handler(void * p_context)
 {
     uint32_t err_code;
-    static uint8_t battery_meas_timeout  = 0x00;
-		static uint8_t sensor_meas_timeout = 0x00;
-	
-    // Store days in months to an aaray
-    uint8_t days_in_month[]={0,31,28,31,30,31,30,31,31,30,31,30,31};
+    static uint16_t battery_meas_timeout = 0x00;
 
-    // Check for leap year
-    if((m_time_stamp.year% 4 == 0 && m_time_stamp.year%100 != 0) || m_time_stamp.year%400 == 0)
-    {
-        days_in_month[2] = 29;
-    }
-    else
-    {
-        days_in_month[2] = 28;
-    }
-		
-		if(sensor_meas_timeout < 0x1e){
-			sensor_meas_timeout++;
-		}
-		else
-		{
-			sensor_meas_timeout = 0x00;
-			CHECK_ALARM_TIMEOUT = true;
-		}
+    NRF_WDT->RR[0] = 0x6E524635;                          //kick the dog every time keeping interval
+    wimoto_evt_post(WIMOTO_EVT_ALARM_CHECK);              /*Check the alarm conditions in main loop*/
 
-    // Increment time stamp
-    m_time_stamp.seconds += 1;
-		NRF_WDT->RR[0] = 0x6E524635;					//kick the dog every second
-    if (m_time_stamp.seconds > 59)
+    battery_meas_timeout++;
+    if(battery_meas_timeout >= BATTERY_MEAS_TICKS)        /*Check whether the battery measurement interval is reached*/
     {
-        m_time_stamp.seconds -= 60;
-        m_time_stamp.minutes++;
-        if (m_time_stamp.minutes > 59)
-        {
-            m_time_stamp.minutes = 0;
-            m_time_stamp.hours++;
-            if (m_time_stamp.hours > 23)
-            {
-                m_time_stamp.hours = 0;
-                m_time_stamp.day++;
-                if (m_time_stamp.day > (days_in_month[m_time_stamp.month]))	
-                {
-                    m_time_stamp.day = 1;
-                    m_time_stamp.month++;
-                    if (m_time_stamp.month > 12)	
-                    {
-                        m_time_stamp.month = 1;
-                        m_time_stamp.year++;
-                    }
-                }
-            }
-        }
-				battery_meas_timeout++;
-				if(battery_meas_timeout >= BATTERY_MEAS_INTERVAL) /*Check whether the battery measurement interval is reached*/
-				{
-					battery_meas_timeout = 0;
-				  MEAS_BATTERY_LEVEL = true;                      /*Set the flag to do battery measurement in main loop*/
-				}
+        battery_meas_timeout = 0;
+        wimoto_evt_post(WIMOTO_EVT_BATTERY_MEAS);         /*Measure the battery level in main loop*/
     }
-    // Update time to the user
-    err_code= ble_time_update(&m_device, &m_time_stamp);
+
+    // Notify the current time to a connected client
+    err_code = ble_time_update(&m_device);
 
     if ((err_code != NRF_SUCCESS) &&
             (err_code != NRF_ERROR_INVALID_STATE) &&
@@ -413,16 +440,13 @@ static void advertising_nonconn_init(void)
     ble_advdata_t              advdata;
     uint8_t                    flags = BLE_GAP_ADV_FLAG_BR_EDR_NOT_SUPPORTED;
     ble_advdata_manuf_data_t   manuf_specific_data;
-    uint8_t                    manuf_data_array[8];
+    uint8_t                    manuf_data_array[5];
 
     manuf_data_array[0] = thermopile[0];
     manuf_data_array[1] = thermopile[1];
-    manuf_data_array[2] = thermopile[2];
-    manuf_data_array[3] = thermopile[3];
-    manuf_data_array[4] = thermopile[4];
-    manuf_data_array[5] = curr_probe_temp_level[0];
-		manuf_data_array[6] = curr_probe_temp_level[1];
-		manuf_data_array[7]	= battery_lvl;
+    manuf_data_array[2] = curr_probe_temp_level[0];
+		manuf_data_array[3] = curr_probe_temp_level[1];
+		manuf_data_array[4]	= battery_lvl;
 	
     manuf_specific_data.company_identifier = COMPANY_IDENTIFER;             /*COMPANY IDENTIFIER */
     manuf_specific_data.data.p_data = manuf_data_array;
@@ -441,33 +465,13 @@ static void advertising_nonconn_init(void)
 	
 }
 
-/**@brief Time out handler for the delay timer.
+/**@brief Function for handling the timeout of a thermopile conversion whose DRDY event was missed.
 */
-static void delay_timer_timeout_handler(void * p_context)
+static void thermopile_drdy_timeout_handler(void * p_context)
 {
-  delay_complete = true;                    /*Set the flag to indicate that the delay is complete*/
+    wimoto_evt_post(WIMOTO_EVT_THERMOPILE_READY);         /*read the thermopile as if DRDY had come*/
 }
 
-/**@brief Function for implementing non blocking delay.
-*/
-
-void delay_ms(uint32_t time_ms)
-{
-	  uint32_t err_code;
-
-    delay_complete = false;
-
-    // Start timer
-    err_code = app_timer_start(delay_timer, APP_TIMER_TICKS(time_ms, APP_TIMER_PRESCALER), NULL);
-    APP_ERROR_CHECK(err_code);
-	
-    //wait till the delay timer timeouts
-	  while(delay_complete == false)
-		{
-       uint32_t err_code = sd_app_evt_wait();
-       APP_ERROR_CHECK(err_code);
-		}
-}
 
 /**@brief Function for the Timer initialization.
 *
@@ -482,7 +486,7 @@ static void timers_init(void)
 
     // Create timers
     err_code = app_timer_create(&thermop_measurement_timer,    /*Timer for climate parameters measurement timeout*/
-    APP_TIMER_MODE_REPEATED,
+    APP_TIMER_MODE_SINGLE_SHOT,
     thermo_param_meas_timeout_handler);
     APP_ERROR_CHECK(err_code);
 
@@ -491,10 +495,13 @@ static void timers_init(void)
     APP_TIMER_MODE_REPEATED,
     real_time_timeout_handler);
     APP_ERROR_CHECK(err_code);
-	
-	  err_code = app_timer_create(&delay_timer,         /* Timer for implemeting delay(ms)*/
+
+    err_code = app_timer_create(&thermopile_drdy_timer, /* Timer for a missed thermopile data ready*/
     APP_TIMER_MODE_SINGLE_SHOT,
-    delay_timer_timeout_handler);
+    thermopile_drdy_timeout_handler);
+    APP_ERROR_CHECK(err_code);
+
+    err_code = twi_master_timeout_init(APP_TIMER_PRESCALER);   /* Timer for giving up a stuck TWI transfer*/
     APP_ERROR_CHECK(err_code);
 
 } 
@@ -506,14 +513,12 @@ static void application_timers_start(void)
 {
     uint32_t err_code;
 
-    // Start application timers
-    //err_code = app_timer_start(thermop_measurement_timer, THERMOPILE_LEVEL_MEAS_INTERVAL, NULL);
-    //APP_ERROR_CHECK(err_code);
-
     // Start the time keeping timer
-    err_code = app_timer_start(real_time_timer, SECONDS_INTERVAL, NULL);
+    err_code = app_timer_start(real_time_timer, TIME_KEEPING_INTERVAL, NULL);
     APP_ERROR_CHECK(err_code);
 
+    wimoto_time_init(APP_TIMER_PRESCALER);              /* RTC1 is running now*/
+
 }
 
 
@@ -528,20 +533,17 @@ static void gap_params_init(void)
     ble_gap_conn_params_t   gap_conn_params;
     ble_gap_conn_sec_mode_t sec_mode;
 		char deviceName[20];
-		uint8_t mac_add[3];
+		char * p_name_end;
 		
     BLE_GAP_CONN_SEC_MODE_SET_OPEN(&sec_mode);
 	
 		//MAC ADDRESS CODE
-		mac_add[0] = (NRF_FICR->DEVICEADDR0 & 0x00FF0000) >> 16;
-		mac_add[1] = (NRF_FICR->DEVICEADDR0 & 0x0000FF00) >> 8;
-		mac_add[2] = (NRF_FICR->DEVICEADDR0 & 0x000000FF);
-	
-		sprintf(&deviceName[0], "%s%02x%02x%02x", &DEVICE_NAME[0], mac_add[0], mac_add[1], mac_add[2]);
+		p_name_end = wimoto_format_str(deviceName, DEVICE_NAME);
+		p_name_end = wimoto_format_hex(p_name_end, NRF_FICR->DEVICEADDR0 & 0x00FFFFFF, 6);   /* low three bytes of the device address*/
 	
 		//END MAC ADDRESS CODE
 
-    err_code = sd_ble_gap_device_name_set(&sec_mode, (const uint8_t *)deviceName, strlen(deviceName));
+    err_code = sd_ble_gap_device_name_set(&sec_mode, (const uint8_t *)deviceName, p_name_end - deviceName);
     APP_ERROR_CHECK(err_code);
 
     err_code = sd_ble_gap_appearance_set(BLE_APPEARANCE_GENERIC_THERMOMETER);
@@ -595,16 +597,13 @@ static void advertising_init(void)
 		ble_advdata_t              advdata1;
 		ble_advdata_t              advdata2;	/*variable to set the scan response data*/
     ble_advdata_manuf_data_t   manuf_specific_data;
-    uint8_t                    manuf_data_array[8];
+    uint8_t                    manuf_data_array[5];
 
     manuf_data_array[0] = thermopile[0];
     manuf_data_array[1] = thermopile[1];
-    manuf_data_array[2] = thermopile[2];
-    manuf_data_array[3] = thermopile[3];
-    manuf_data_array[4] = thermopile[4];
-    manuf_data_array[5] = curr_probe_temp_level[0];
-		manuf_data_array[6] = curr_probe_temp_level[1];
-		manuf_data_array[7] = battery_lvl;
+    manuf_data_array[2] = curr_probe_temp_level[0];
+		manuf_data_array[3] = curr_probe_temp_level[1];
+		manuf_data_array[4] = battery_lvl;
 		
     manuf_specific_data.company_identifier = COMPANY_IDENTIFER;             /*COMPANY IDENTIFIER */
     manuf_specific_data.data.p_data = manuf_data_array;
@@ -709,17 +708,8 @@ static void thermops_init(void)
     thermops_init.p_report_ref         = NULL; 
 
     /* Set the default low value and high value of temperature alarm*/
-    thermops_init.thermo_thermopile_low_level[0]    = THERMOP_DEFAULT_LOW_VALUE;
-    thermops_init.thermo_thermopile_low_level[1]    = THERMOP_DEFAULT_LOW_VALUE;
-    thermops_init.thermo_thermopile_low_level[2]    = PERIOD;
-    thermops_init.thermo_thermopile_low_level[3]    = THERMOP_DEFAULT_LOW_VALUE;
-    thermops_init.thermo_thermopile_low_level[4]    = THERMOP_DEFAULT_LOW_VALUE;
-
-    thermops_init.thermo_thermopile_high_level[0]   = THERMOP_DEFAULT_HIGH_VALUE;
-    thermops_init.thermo_thermopile_high_level[1]   = THERMOP_DEFAULT_HIGH_VALUE;
-    thermops_init.thermo_thermopile_high_level[2]   = PERIOD;
-    thermops_init.thermo_thermopile_high_level[3]   = THERMOP_DEFAULT_HIGH_VALUE;
-    thermops_init.thermo_thermopile_high_level[4]   = THERMOP_DEFAULT_HIGH_VALUE;                                                       
+    wimoto_encode_int16(THERMOP_DEFAULT_LOW_VALUE, thermops_init.thermo_thermopile_low_level);
+    wimoto_encode_int16(THERMOP_DEFAULT_HIGH_VALUE, thermops_init.thermo_thermopile_high_level);                                                       
     thermops_init.thermo_thermopile_alarm_set       = DEFAULT_ALARM_SET;
 		
 		//initializing thermopile alarm with time stamp characteristics
@@ -852,6 +842,7 @@ static void dlogs_init(void)
     dlogs_init.p_report_ref         = NULL; 
     dlogs_init.data_logger_enable   = DEFAULT_ALARM_SET;
     dlogs_init.read_data_switch     = DEFAULT_ALARM_SET;
+    dlogs_init.log_interval         = DATA_LOGGER_DEFAULT_INTERVAL;
 
     err_code = ble_dlogs_init(&m_dlogs, &dlogs_init);
     APP_ERROR_CHECK(err_code);
@@ -1117,6 +1108,10 @@ static void sys_evt_dispatch(uint32_t sys_evt)
 {
     pstorage_sys_event_handler(sys_evt);
 		data_log_sys_event_handler(sys_evt);                   /*added event handler for flash write operation*/
+    if (READ_DATA)
+    {
+        wimoto_evt_post(WIMOTO_EVT_READ_DATA);                /* Retry the flush before a download when the flash operation is done*/
+    }
     on_sys_evt(sys_evt);
 }
 
@@ -1137,6 +1132,7 @@ static void ble_evt_dispatch(ble_evt_t * p_ble_evt)
     ble_device_on_ble_evt(&m_device, p_ble_evt);
     ble_conn_params_on_ble_evt(p_ble_evt);
     dm_ble_evt_handler(p_ble_evt);                     /*added for migrating to soft device 7.0.0 and SDK 6.1.0*/
+    wimoto_hvx_on_ble_evt(p_ble_evt);
     on_ble_evt(p_ble_evt);
 }
 
@@ -1172,11 +1168,33 @@ static void ble_stack_init(void)
 
 
 
+/**@brief event handler for the thermopile data ready GPIOTE module.
+*/
+static void thermopile_drdy_evt_handler(uint32_t pins_low_to_high_mask, uint32_t pins_high_to_low_mask)
+{
+    wimoto_evt_post(WIMOTO_EVT_THERMOPILE_READY);																		/*posted when TMP006 pulls DRDY low*/
+}
+
+
 /**@brief Function for initializing the GPIOTE handler module.
 */
 static void gpiote_init(void)
 {
+    uint32_t err_code;
+
     APP_GPIOTE_INIT(APP_GPIOTE_MAX_USERS);
+
+    // Configure GPIO pin as input which is connected to the open drain DRDY pin of TMP006
+    nrf_gpio_cfg_input(TMP006_DRDY_GPIOTE_PIN, NRF_GPIO_PIN_PULLUP);
+
+    err_code = app_gpiote_user_register(&thermopile_drdy_gpiote, 
+    NULL, 
+    TMP006_DRDY_PINS_HIGH_TO_LOW_MASK, 
+    thermopile_drdy_evt_handler);   /* Register the gpiote user for the thermopile*/
+    APP_ERROR_CHECK(err_code);
+
+    err_code = app_gpiote_user_enable(thermopile_drdy_gpiote);         /* Enable the registered user */
+    APP_ERROR_CHECK(err_code);
 }
 
 
@@ -1245,13 +1263,15 @@ static void power_manage(void)
 */
 static void create_log_data(uint32_t * data)
 {
+    ble_date_time_t time_stamp;
     uint16_t current_probe_temp_level;
 
     current_probe_temp_level=read_probe_temp_level();
 
-    data[0]=(m_time_stamp.year<<16)|(m_time_stamp.month<<8)|m_time_stamp.day;			/*firt word writeen to memory contains date (YYYYMMDD)*/
-    data[1]=(m_time_stamp.hours<<24)|(m_time_stamp.minutes<<16)|(m_time_stamp.seconds<<8)|current_thermopile_temp_store[0]; 	/*second word contains time and first char of IR temp*/
-    data[2]=current_thermopile_temp_store[1]<<24|current_thermopile_temp_store[2]<<16|current_thermopile_temp_store[3]<<8|current_thermopile_temp_store[4]; /*third word contains last four char of ir temp*/
+    wimoto_time_date_time_get(&time_stamp);
+    data[0]=(time_stamp.year<<16)|(time_stamp.month<<8)|time_stamp.day;			/*firt word writeen to memory contains date (YYYYMMDD)*/
+    data[1]=(time_stamp.hours<<24)|(time_stamp.minutes<<16)|(time_stamp.seconds<<8); 	/*second word contains time*/
+    data[2]=(uint16_t)(wimoto_decode_int16(current_thermopile_temp_store) + TMP006_ZERO_CELSIUS_X100); /*third word contains ir temp in 0.01 K, so it is never negative*/
     data[3]= (current_probe_temp_level<<16)|log_id; 	                                          /*fourth word contains probe temp and log id*/
 	
 		if(log_id == 0xFFFF)
@@ -1265,17 +1285,34 @@ static void create_log_data(uint32_t * data)
 }
 
 
+/**@brief Function for updating the flash wear characteristic from the data logger.
+*/
+static void flash_wear_update(void)
+{
+    uint32_t         err_code;
+    ble_dlogs_wear_t wear;
+
+    data_log_wear_get(&wear);
+    err_code = ble_flash_wear_update(&m_device, &wear);
+    APP_ERROR_CHECK(err_code);
+}
+
+
 /**@brief Function for checking whether to log data.
 */
 static void data_log_check()
 {
     uint32_t log_data[4];                                 /*array storing the data to be logged */
 
-    if(ENABLE_DATA_LOG && !READ_DATA)									    /*if enabled, start data logging functionality*/
+    if(ENABLE_DATA_LOG)									    /*if enabled, start data logging functionality*/
     {   
         create_log_data(log_data);                        /*create the data to be logged */
-        write_data_flash(log_data);	                      /*log the data to flash */
+        if (write_data_flash(log_data) == NRF_ERROR_INVALID_STATE)   /* Queue the data to be logged to flash */
+        {
+            log_id--;                                     /* Within the deadband, the record ID is kept for the next data log*/
+        }
     }
+    flash_wear_update();                                  /* Show the flash wear, updated by the data logger*/
 }
 
 
@@ -1350,7 +1387,7 @@ void WDT_init(void)
 		NRF_WDT->CONFIG = WDT_CONFIG_HALT_Pause << WDT_CONFIG_HALT_Pos |							//pause WDT when device in debug mode
 											WDT_CONFIG_SLEEP_Run << WDT_CONFIG_SLEEP_Pos;								//continue WDT when device is in sleep mode
 		
-		NRF_WDT->CRV = 4*32768;								//set watchdog to have 2 second timeout
+		NRF_WDT->CRV = (TIME_KEEPING_SECONDS + 4)*32768;		//set watchdog to time out 4 seconds after a missed time keeping interval
 		NRF_WDT->RREN |= WDT_RREN_RR0_Msk;		//enable reload register0
 		NRF_WDT->TASKS_START = 1;							//start watchdog timer
 		
@@ -1459,16 +1496,112 @@ void reset_conn_params()
 	APP_ERROR_CHECK(err_code);
 }
 
+/**@brief Function for handling the application events.
+*
+* @details Called from app_sched_execute() in the main loop for every event posted by the timer,
+*          GPIOTE and BLE handlers, so each wakeup only does the work that is pending.
+*
+* @param[in]   evt   Application event.
+*/
+static void app_evt_handler(wimoto_evt_t evt)
+{
+    uint32_t err_code;
+    uint16_t len = 1;
+    uint8_t  val = 0;
+
+    switch (evt)
+    {
+        case WIMOTO_EVT_DFU_ENABLE:                               /* Go to the bootloader*/
+            sd_power_gpregret_set(1);                             /* Set the value of general purpose retention register to 1*/
+            err_code = sd_ble_gatts_service_changed(m_conn_handle,0x01,0x4D); /*function for service change indication*/
+            UNUSED_VARIABLE(err_code);
+            sd_nvic_SystemReset();                                /* Apply a system reset for jumping into bootloader*/
+            break;
+
+        case WIMOTO_EVT_LED_FLASH:                                /* Flash the red LED*/
+            err_code = sd_ble_gatts_value_set(m_device.dfu_mode_handles.value_handle , 0, &len, &val);  /* Reset characteristic value */
+            APP_ERROR_CHECK(err_code);
+            LED_ON(18,19);
+            break;
+
+        case WIMOTO_EVT_DLOG_TIMER_START:                         /* The data logger has been enabled or its interval changed, restart the timer*/
+            err_code = app_timer_stop(thermop_measurement_timer);
+            APP_ERROR_CHECK(err_code);
+            data_log_timer_start(m_dlogs.interval * 60);
+            wimoto_evt_post(WIMOTO_EVT_DATA_LOG);                 /* Create a data log immediately upon enabling logging functionality*/
+            break;
+
+        case WIMOTO_EVT_DATA_LOG:
+            data_log_check();
+            break;
+
+        case WIMOTO_EVT_READ_DATA:                                /* Start sending data to the connected device*/
+            if(READ_DATA && data_log_flush())                     /* Posted again by the flash events until the log is written*/
+            {
+                READ_DATA = false;
+                DOWNLOAD_DATA = true;                             /* Logging continues while the data is sent*/
+                if(((write_pg != 0) && (read_pg < (write_pg - 1))) || (read_pg > write_pg))
+                {
+                    update_conn_params();                         /* Update connection parameters if there is enough data*/
+                }
+                wimoto_evt_post(WIMOTO_EVT_DOWNLOAD);
+            }
+            break;
+
+        case WIMOTO_EVT_DOWNLOAD:
+            if(DOWNLOAD_DATA && send_data(&m_dlogs))              /* Send the data, continued on every TX complete event*/
+            {
+                DOWNLOAD_DATA = false;
+                if(param_updated == true)
+                {
+                    reset_conn_params();                          /* Reset the conn params to maintain decent power consumption */
+                    param_updated = false;                        /* Reset the flag indicating that the conn params were changed*/
+                }
+                err_code=reset_data_log(&m_dlogs);                /* Reset the data read switch*/
+                APP_ERROR_CHECK(err_code);
+            }
+            break;
+
+        case WIMOTO_EVT_TIME_SET:
+            (void)create_time_stamp(&m_device);                   /* Set the clock to the user set time, an invalid time is ignored*/
+            break;
+
+        case WIMOTO_EVT_ALARM_CHECK:
+            alarm_check();                                        /* Checks for alarm in all services*/
+            break;
+
+        case WIMOTO_EVT_READ_SENSORS:                             /* A client read a current value*/
+            current_read();
+            break;
+
+        case WIMOTO_EVT_THERMOPILE_READY:                         /* Check the thermopile once its conversion is ready*/
+            thermopile_check();
+            break;
+
+        case WIMOTO_EVT_BATTERY_MEAS:
+            battery_start();                                      /* Measure battery level*/
+            break;
+
+        default:
+            // No implementation needed.
+            break;
+    }
+}
+
+
 /**@brief Function for application main entry.
 */
 void connectable_mode(void)
 {    
-    uint32_t err_code;
-		uint16_t len = 1;
-		uint8_t	 val = 0;
+    uint16_t next_log_id;                  /* log ID following the newest data log in flash*/
     // Initialize.
 		get_die_revision_no();								 /*Get silicon revision before init*/
+    wimoto_evt_init(app_evt_handler);      /* Queue the application events on the scheduler*/
     ble_stack_init();
+    if (data_log_init(&next_log_id))       /* Restore the data logger pointers from flash*/
+    {
+        log_id = next_log_id;              /* Continue the record ID of the last data log*/
+    }
     twi_master_init();                     /*configure twi*/
 		timers_init();
     gpiote_init();
@@ -1477,6 +1610,7 @@ void connectable_mode(void)
 		//init_battery_level();                  /*measure the battery level before advertisement*/
     advertising_init();
     services_init();
+    flash_wear_update();
     conn_params_init();
     sec_params_init();
     radio_notification_init();
@@ -1493,78 +1627,13 @@ void connectable_mode(void)
     advertising_start();
 		LED_ON(20, NULL);
 
-    // Enter main loop.
-     for (;;)
-    {  
-
-        if(DFU_ENABLE)                                              /*If the dfu enable flag is true go to the bootloader*/ 
-        {
-            sd_power_gpregret_set(1);                              /*If DFU mode is enabled , set the value of general purpose retention register to 1*/
-            
-						err_code=sd_ble_gatts_service_changed(m_conn_handle,0x01,0x4D); /*function for service change indication*/
-					
-						sd_nvic_SystemReset();                                 /*Apply a system reset for jumping into bootloader*/
-        }
-				if(LED_FLASH)																					/* If LED flash flag is enabled, flash the red LED*/
-				{		
-						val = 0;
-						err_code = sd_ble_gatts_value_set(m_device.dfu_mode_handles.value_handle , 0, &len, &val);
-						APP_ERROR_CHECK(err_code);
-						LED_ON(18,19);
-						LED_FLASH = false;	
-				}
-				if (ENABLE_DLOG_TIMER)																/* If the data logger has been enabled, start the timer*/
-				{
-					err_code = app_timer_start(thermop_measurement_timer, THERMOPILE_LEVEL_MEAS_INTERVAL, NULL);
-					APP_ERROR_CHECK(err_code);
-					ENABLE_DLOG_TIMER = false;
-					DATA_LOG_CHECK = true;															/* Create a data log immediately upon enabling logging functionality*/
-					RESET_DLOG_TIMER = true;														/* Make sure that the timer gets reset so that first log is 15 minutes later*/
-				}
-        if (DATA_LOG_CHECK)
-        {
-            data_log_check();
-            DATA_LOG_CHECK= false;
-        }
-
-        if(READ_DATA)																			      /*If enabled, start sending data to the connected device*/
-        {
-            err_code=app_timer_stop(thermop_measurement_timer);/*stop the timers before start sending the historical data*/
-            APP_ERROR_CHECK(err_code);
-            READ_DATA=false;
-            ENABLE_DATA_LOG = false;                           /* Disable data logging functionality */
-						if(((write_pg != 0) && (read_pg < (write_pg - 1))) || (read_pg > write_pg))
-						{
-							update_conn_params();															/* UPDATE CONNECTION PARAMETERS, THIS NEEDS TO BECOME CONDITIONAL THOUGH*/
-						}
-            send_data(&m_dlogs);																/*start sending the data*/
-						if(param_updated == true)
-						{
-							reset_conn_params();															/* Reset the conn params to maintain decent power consumption */
-							param_updated = false;														/* Reset the flag indicating that the conn params were changed*/
-						}
-            err_code=reset_data_log(&m_dlogs);									/*reset the data logger enable and data read switches*/
-            APP_ERROR_CHECK(err_code);	
-        }
-
-        if(TIME_SET)
-        {
-            create_time_stamp(&m_device, &m_time_stamp);      /* Create new time stamp from user set time*/
-            TIME_SET = false;                                 /* Reset the flag*/
-        }
+    wimoto_evt_post(WIMOTO_EVT_BATTERY_MEAS);             /* Measure the battery level at start up*/
 
-        if (CHECK_ALARM_TIMEOUT)                              /*Check for sensor measurement time-out*/
-        {
-            alarm_check();                                    /* Checks for alarm in all services*/
-            CHECK_ALARM_TIMEOUT=false;                        /* Reset the flag*/
-        }
-				
-				if(MEAS_BATTERY_LEVEL)
-				{
-					  battery_start();		                              /* Measure battery level*/
-						MEAS_BATTERY_LEVEL = false;
-				}
-        power_manage(); 
+    // Enter main loop.
+    for (;;)
+    {
+        app_sched_execute();                                  /* Handle the pending application events*/
+        power_manage();                                       /* Switch to a low power state*/
     }
 }
 
@@ -7,6 +7,7 @@
 
 #include "wimoto_sensors.h"
 #include "wimoto.h"
+#include "wimoto_format.h"
 
 /********************************************************************************************/
 /* PRIVATE FUNCTIONS																		*/
@@ -24,15 +25,14 @@ uint16_t TMP006_read_register(uint8_t base_address)
     data_buffer[0] = 0x00;    /* Initializing data buffers */
     data_buffer[1] = 0x00;		/* Initializing data buffers */
 
-    if (twi_master_transfer (TMP006_ADDRESS ,(uint8_t*)&base_address ,1 ,TWI_ISSUE_STOP))
-    {
-
-        if (twi_master_transfer (TMP006_ADDRESS | TWI_READ_BIT ,data_buffer ,2 ,TWI_ISSUE_STOP))
-        {
-            temporary_variable = ((data_buffer[0] << 8) | data_buffer[1]); 
-            return temporary_variable;	
-        }
+    twi_master_xfer_t  xfers[2] = {{TMP006_ADDRESS ,&base_address ,1 ,TWI_ISSUE_STOP},
+                                   {TMP006_ADDRESS | TWI_READ_BIT ,data_buffer ,2 ,TWI_ISSUE_STOP}};
+    twi_master_chain_t chain    = {xfers ,2 ,NULL};
 
+    if (twi_master_chain_run(&chain))
+    {
+        temporary_variable = ((data_buffer[0] << 8) | data_buffer[1]); 
+        return temporary_variable;	
     }
 
     return 0;
@@ -100,37 +100,6 @@ bool TMP006_enable_powerdown_mode()
 }
 
 
-/**
-*@brief   Function to read the value of V-object & T-ambient registers one time
-*@details 1.Initially the function enables continuous conversion mode
-*         2.So TMP006 starts conversion and data will be available in V-object & T-ambient registers,
-*            these two 16 bit data are read and combined together to form a 32 bit value
-*         3.Switches TMP006 back to power down mode for power considerations
-*         4.Returns the 32 bit value 
-*/
-
-uint32_t TMP006_get_onetime_data()
-{
-    uint16_t ambient_reg_val = 0,vobj_reg_val = 0;
-    uint32_t combined_val = 0;
-
-    if (false == TMP006_enable_continuous_conversion()) return 0;
-
-    delay_ms(1100);
-    ambient_reg_val =   TMP006_read_register (TMP006_T_AMBIENT_REG);
-    /* bits 0 and 1 of T-ambient register is '0' by default so they have to be ignored */
-    ambient_reg_val =  ((ambient_reg_val >> 2) & 0x3FFF);
-
-    vobj_reg_val =   TMP006_read_register (TMP006_V_OBJ_REG);
-    /* 31-16 bits of temporary_variable3 represents T-ambient register and 15-0 bits represents V-object register */
-    combined_val = ((ambient_reg_val << 16) | vobj_reg_val);
-
-    if (false == TMP006_enable_powerdown_mode()) return 0;
-
-    return(combined_val);
-
-}
-
 /**
 *@brief   Function to read the value of V-object register one time
 *@details 1.Initially the function enables continuous conversion mode
@@ -191,266 +160,146 @@ int16_t readRawVoltage()
     return raw;
 }
 
-// Calculate object temperature based on raw sensor temp and thermopile voltage
-float TMP006_ObjTempC_conversion() 
+/**
+*@brief   Function to compute the integer square root of a 64 bit value
+*@details 1.Digit-by-digit (binary restoring) method, two bits of the radicand per step
+*         2.Needs only shifts, adds and compares, so no division runs on the Cortex-M0
+*         3.Returns floor(sqrt(value))
+*/
+static uint32_t TMP006_isqrt(uint64_t value)
 {
-    static float previous_val = 0;
-    if (false == TMP006_enable_continuous_conversion()) 
-    {	
-        return previous_val;
-    }
-		twi_turn_OFF();
-    delay_ms(1100);
-		twi_turn_ON();
-
-    volatile float Tdie = readRawDieTemperature();
-    volatile float Vobj = readRawVoltage();
-    Vobj *= 156.25; // 156.25 nV per LSB
-    Vobj /= 1000000000; // nV -> V
-    Tdie *= 0.03125; // convert to celsius
-    Tdie += 273.15; // convert to kelvin
-
-    // Equations for calculating temperature found in section 5.1 in the user guide
-    volatile float tdie_tref = Tdie - TMP006_TREF;
-    volatile float S = (1 + (TMP006_A1*tdie_tref) + (TMP006_A2*tdie_tref*tdie_tref));
-    S *= TMP006_S0;
-    S /= 10000000;
-    S /= 10000000;
-
-    volatile float Vos = (TMP006_B0 + (TMP006_B1*tdie_tref) +(TMP006_B2*tdie_tref*tdie_tref));
-
-    volatile float fVobj = (Vobj - Vos) + (TMP006_C2*(Vobj-Vos)*(Vobj-Vos));
-
-    volatile float Tobj = sqrt(sqrt((Tdie * Tdie * Tdie * Tdie) + (fVobj/S)));
+    uint64_t root = 0;
+    uint64_t bit  = (uint64_t)1 << 62;
 
-    Tobj -= 273.15; // Kelvin -> *C
-
-    if (false == TMP006_enable_powerdown_mode())
-    {	
-        return previous_val;
+    while (bit > value)
+    {
+        bit >>= 2;
     }
 
-    previous_val= Tobj;
-
-    return Tobj;
+    while (bit != 0)
+    {
+        if (value >= root + bit)
+        {
+            value -= root + bit;
+            root   = (root >> 1) + bit;
+        }
+        else
+        {
+            root >>= 1;
+        }
+        bit >>= 2;
+    }
 
+    return (uint32_t)root;
 }
 
-// Caculate sensor temperature based on raw reading
-float TMP006_readDieTempC(void) 
-{
-    float Tdie = TMP006_get_t_ambient_data();
-    Tdie *= 0.03125; // convert to Celsius
-    return Tdie;
-}
-/*-----------------------------------------------------------------------------
-*  Function:	convert
-*  Brief:		converting int value to char
-*  Parameter:	None
-*  Return:		None
------------------------------------------------------------------------------*/
-void convert (int value, unsigned char * dest)
+/**
+*@brief   Function to calculate the object temperature from the raw T-ambient and V-object registers
+*@details 1.Evaluates the equations of section 5.1 of the TMP006 user guide in integer arithmetic:
+*            S = S0(1 + A1(Tdie-Tref) + A2(Tdie-Tref)^2), Vos = B0 + B1(Tdie-Tref) + B2(Tdie-Tref)^2,
+*            f(Vobj) = (Vobj-Vos) + C2(Vobj-Vos)^2, Tobj = (Tdie^4 + f(Vobj)/S)^(1/4)
+*         2.Voltages are carried in pV, S as ppm of S0 and Tobj^4 in K^4, all in 64 bit
+*         3.The fourth root is taken as two integer square roots, leaving 19 fraction bits
+*         4.raw_die is the T-ambient register shifted right by 2 (1/32 degC per LSB)
+*         5.Returns the object temperature in 0.01 degC
+*/
+int32_t TMP006_calc_obj_temp(int16_t raw_die, int16_t raw_vobj)
 {
-    unsigned char digit = 0;
-    unsigned char flag = 0;
-
-    while (value>= 1000000000)
-    {
-        digit++;
-        value -=1000000000;
-    }
-    if(digit || flag)
-    {
-        *dest = digit+48;
-        digit=0;
-        dest++;
-        flag=1;
-    }
-    while (value>= 100000000)
+    int64_t  dt = raw_die - TMP006_TREF_RAW;                        /* Tdie - Tref in 1/32 K                 */
+    int64_t  tdie;
+    int64_t  tdie2;
+    int64_t  s_ppm;
+    int64_t  vos;
+    int64_t  vdiff;
+    int64_t  vdiff_nv;
+    int64_t  fvobj;
+    int64_t  tobj4;
+    uint32_t root;
+
+    /* S in ppm of S0, Vos in pV; the 1/32 K steps of dt are folded into the divisors */
+    s_ppm = ((int64_t)1000000 * 102400 + (int64_t)TMP006_A1_PPM * 3200 * dt + TMP006_A2_PPM_X100 * dt * dt) / 102400;
+    vos   = ((int64_t)TMP006_B0_PV * 1024 + (int64_t)TMP006_B1_PV * 32 * dt + TMP006_B2_PV * dt * dt) / 1024;
+
+    vdiff    = (int64_t)raw_vobj * TMP006_VOBJ_PV_PER_LSB - vos;
+    vdiff_nv = vdiff / 1000;
+    fvobj    = vdiff + (vdiff_nv * vdiff_nv * TMP006_C2_X10) / 10000000;
+
+    /* Tdie in 1/800 K is exact for 1/32 degC steps; Tdie^2 is kept in K^2 with 8 fraction bits */
+    tdie  = (int64_t)raw_die * 25 + TMP006_ZERO_CELSIUS_X800;
+    tdie2 = (tdie * tdie) / 2500;
+    tobj4 = ((tdie2 * tdie2) >> 16) + (fvobj * (1000000000 / TMP006_S0_X10)) / s_ppm;
+
+    if (tobj4 <= 0)
     {
-        digit++;
-        value -=100000000;
+        return -TMP006_ZERO_CELSIUS_X100;
     }
-    if(digit || flag)
+    if (tobj4 >= ((int64_t)1 << 44))
     {
-        *dest = digit+48;
-        digit=0;
-        dest++;
-        flag=1;
+        tobj4 = ((int64_t)1 << 44) - 1;
     }
-    while (value>= 10000000)
-    {
-        digit++;
-        value -=10000000;
-    }
-    if(digit || flag)
-    {
-        *dest = digit+48;
-        digit=0;
-        dest++;
-        flag=1;
-    }
-    while (value>= 1000000)
-    {
-        digit++;
-        value -=1000000;
-    }
-    if(digit || flag)
-    {
-        *dest = digit+48;
-        digit=0;
-        dest++;
-        flag=1;
-    }
-    while (value>= 100000)
-    {
-        digit++;
-        value -=100000;
-    }
-    if(digit || flag)
-    {
-        *dest = digit+48;
-        digit=0;
-        dest++;
-        flag=1;
-    }
-    while (value>= 10000)
-    {
-        digit++;
-        value -=10000;
-    }
-    if(digit || flag)
-    {
-        *dest = digit+48;
-        digit=0;
-        dest++;
-        flag=1;
-    }
-    while (value>= 1000)
-    {
-        digit++;
-        value -=1000;
-    }
-    if(digit || flag)
-    {
-        *dest = digit+48;
-        digit=0;
-        dest++;
-        flag=1;
-    }
-    while (value >= 100)
-    {
-        digit++;
-        value -=100;
-    }
-    if(digit || flag)
-    {
-        *dest = digit+48;
-        digit=0;
-        dest++;
-        flag=1;
-    }
-    while (value >= 10)
-    {
-        digit++;
-        value -=10;
-    }
-    if(digit || flag)
-    {
-        *dest = digit+48;
-        digit=0;
-        dest++;
-        flag=1;
-    }
-    *dest= value+48;
-    dest++;
-    *dest=0;
-    return;
+
+    root = TMP006_isqrt((uint64_t)tobj4 << 20);                     /* Tobj^2 with 10 fraction bits          */
+    root = TMP006_isqrt((uint64_t)root << 28);                      /* Tobj with 19 fraction bits            */
+
+    return (int32_t)((((uint64_t)root * 100) + (1UL << 18)) >> 19) - TMP006_ZERO_CELSIUS_X100;
 }
 
+/**
+*@brief   Function to start a conversion of the thermopile
+*@details 1.Enables continuous conversion mode with the DRDY pin enabled, TMP006 pulls DRDY low
+*            once a result is ready, TMP006_CONVERSION_RATE after this call
+*         2.The result is read with TMP006_collect_ObjTempC() on the DRDY event
+*         3.Returns a true value if the conversion has started
+*/
+bool TMP006_trigger_conversion(void)
+{
+    return TMP006_enable_continuous_conversion();
+}
 
-/*-----------------------------------------------------------------------------
-*  Function:	float_to_str
-*  Brief:		converting float value to character
-*  Parameter:	None
-*  Return:		None
------------------------------------------------------------------------------*/
-void float_to_str(float source , char *dest)
+/**
+*@brief   Function to read the result of the conversion started by TMP006_trigger_conversion()
+*@details 1.Reads T-ambient and V-object, which releases DRDY, and switches TMP006 back to power
+*            down mode for power considerations
+*         2.Returns the object temperature in 0.01 degC, the previous one on failure
+*/
+int32_t TMP006_collect_ObjTempC(void)
 {
-    unsigned char int_part[4],dec_part[2];
-    int value,i,j;
-  
-		if (source <0)																					//If source value is negative, make it positive, and add a - sign as the first character
-		{
-			source = source * (-1);
-			*dest = '-';
-			dest++;
-		}
-		
-    value = (int)source;																		//Truncate source value							
-    convert(value,int_part);																//Create character representations for integer part of source number
-    for(i=0;int_part[i]!='\0';i++)													//Put integer characters into current_thermopile_array
-    {
-        *dest = int_part[i];                                                                                                                                                                                                                                                                                         
-        dest++;
-    }
-		
-		
-    *dest = '.';																						//Add decimal to current_thermopile_array
-    dest++;
-    source = (source - (float)value)*10 ;										//Subtract integer value from decimal value in order to isolate value, multiply by 10 to make decimal integer number
-    value = (int)source;																		//Truncate newly created "decimal" value
-    convert(value,dec_part);																//Create character representations for decimal part of source number 
-    for(j=0;dec_part[j]!='\0';j++)													//Put decimal character into current_thermopile_array
-    {
-        *dest = dec_part[j];
-        dest++;
+    static int32_t previous_val = 0;
+    int16_t        raw_die;
+    int16_t        raw_vobj;
+
+    raw_die  = readRawDieTemperature();
+    raw_vobj = readRawVoltage();
+
+    if (false == TMP006_enable_powerdown_mode())
+    {	
+        return previous_val;
     }
-    
-		if(i < 4){
-			*dest ='\0';																					//Add a null character at the end incase the string is not five characters
-		}			
-		
-		
-		
-    return;
-}
 
+    previous_val = TMP006_calc_obj_temp(raw_die, raw_vobj);
+
+    return previous_val;
 
-void do_thermopile_measurement(uint8_t *temp_str, float *fTemp)
-{
-    static float obj_temp;
-    obj_temp= TMP006_ObjTempC_conversion();
-    *fTemp = obj_temp;
-    float_to_str(obj_temp,(char *)temp_str);
-    return;
 }
 
-/*-----------------------------------------------------------------------------
-*  Function:	stof
-*  Brief:		converting character value to float
-*  Parameter:	char pointer
-*  Return:		float
------------------------------------------------------------------------------*/
-float stof(char* s)
+// Caculate sensor temperature in 0.01 degC based on raw reading
+int32_t TMP006_readDieTempC(void) 
 {
-    float rez = 0, fact = 1;
-    if (*s == '-'){
-        s++;
-        fact = -1;
-    };
-    for (int point_seen = 0; *s; s++){
-        if (*s == '.'){
-            point_seen = 1; 
-            continue;
-        };
-        int d = *s - '0';
-        if (d >= 0 && d <= 9){
-            if (point_seen) fact /= 10.0f;
-            rez = rez * 10.0f + (float)d;
-        };
-    };
-    return rez * fact;
+    int16_t raw_die = (int16_t)(TMP006_get_t_ambient_data() << 2) >> 2;   /* sign extend the 14 bit value */
+    return ((int32_t)raw_die * 25) / 8;                                   /* 1/32 degC per LSB            */
 }
 
+/**
+*@brief   Function to read the object temperature measured by TMP006_trigger_conversion()
+*@details 1.The temperature in 0.01 degC is returned in p_temp
+*         2.p_encoded receives it as the thermopile characteristic value (THERMOP_CHAR_SIZE bytes)
+*/
+void do_thermopile_measurement(uint8_t *p_encoded, int32_t *p_temp)
+{
+    static int32_t obj_temp;
+    obj_temp= TMP006_collect_ObjTempC();
+    *p_temp = obj_temp;
+    wimoto_encode_int16(obj_temp, p_encoded);
+    return;
+}
 
@@ -0,0 +1,52 @@
+/** @file
+ *
+ * @brief Events of the application, dispatched from the main loop by the scheduler.
+ *
+ * @details Timer, GPIOTE and BLE handlers post an event for the work they leave to the main
+ *          loop. An event that is already queued is not queued again, so the queue holds at most
+ *          one event of each type and cannot overflow. The main loop runs app_sched_execute()
+ *          on every wakeup, which only dispatches the events that are pending.
+ */
+
+#ifndef WIMOTO_EVT_H__
+#define WIMOTO_EVT_H__
+
+#include <stdint.h>
+
+/**@brief Application events. */
+typedef enum
+{
+    WIMOTO_EVT_DFU_ENABLE,                          /**< A client enabled the DFU mode, jump to the bootloader. */
+    WIMOTO_EVT_LED_FLASH,                           /**< A client asked for the LED to be flashed. */
+    WIMOTO_EVT_DLOG_TIMER_START,                    /**< The data logger was enabled or its interval changed. */
+    WIMOTO_EVT_DATA_LOG,                            /**< A record is due to be logged. */
+    WIMOTO_EVT_READ_DATA,                           /**< A client asked for the logged data, or the flash writer made progress meanwhile. */
+    WIMOTO_EVT_DOWNLOAD,                            /**< TX buffers were freed during a download of the logged data. */
+    WIMOTO_EVT_TIME_SET,                            /**< A client wrote the time. */
+    WIMOTO_EVT_ALARM_CHECK,                         /**< The sensors are due to be checked for the alarm conditions. */
+    WIMOTO_EVT_READ_SENSORS,                        /**< A client read a current value. */
+    WIMOTO_EVT_THERMOPILE_READY,                    /**< The TMP006 conversion is ready. */
+    WIMOTO_EVT_BATTERY_MEAS,                        /**< The battery level is due to be measured. */
+    WIMOTO_EVT_COUNT                                /**< Number of events, not an event. */
+} wimoto_evt_t;
+
+/**@brief Application event handler type. */
+typedef void (*wimoto_evt_handler_t)(wimoto_evt_t evt);
+
+/**@brief Function for initializing the scheduler queue.
+ *
+ * @details Call before any handler that posts an event is enabled.
+ *
+ * @param[in]   evt_handler   Handler of the events, called from the main loop.
+ */
+void wimoto_evt_init(wimoto_evt_handler_t evt_handler);
+
+/**@brief Function for posting an event to the main loop.
+ *
+ * @details Can be called from any interrupt level. Nothing is done if the event is pending already.
+ *
+ * @param[in]   evt           Event to post.
+ */
+void wimoto_evt_post(wimoto_evt_t evt);
+
+#endif // WIMOTO_EVT_H__
@@ -0,0 +1,156 @@
+/**
+*@file     This file contains the queue of the outgoing notifications and indications.
+*
+*@details  The queue is a ring buffer of copies of the values. It is filled from the main loop and
+*          the timer handlers and emptied from the BLE event handler, so it is only accessed with
+*          the interrupts disabled.
+*/
+
+#include <stdbool.h>
+#include <string.h>
+#include "wimoto_hvx.h"
+#include "nrf_error.h"
+#include "app_util_platform.h"
+
+#define HVX_QUEUE_SIZE              8                           /**< Number of values that can wait for the link. */
+#define HVX_DATA_MAX_LEN            (GATT_MTU_SIZE_DEFAULT - 3) /**< Longest value, the ATT MTU less the opcode and the handle. */
+
+/**@brief Notification or indication waiting in the queue. */
+typedef struct
+{
+    uint16_t conn_handle;                                       /**< Connection handle. */
+    uint16_t handle;                                            /**< Characteristic value handle. */
+    uint8_t  type;                                              /**< BLE_GATT_HVX_NOTIFICATION or BLE_GATT_HVX_INDICATION. */
+    uint16_t len;                                               /**< Length of the value. */
+    uint8_t  data[HVX_DATA_MAX_LEN];                            /**< Value. */
+} hvx_entry_t;
+
+static hvx_entry_t m_queue[HVX_QUEUE_SIZE];                     /**< Values waiting for the link. */
+static uint8_t     m_queue_head  = 0;                           /**< Oldest value in the queue. */
+static uint8_t     m_queue_count = 0;                           /**< Number of values in the queue. */
+static bool        m_ind_pending = false;                       /**< An indication waits for its confirmation. */
+
+
+/**@brief Function for sending a notification or indication, records a sent indication.
+*/
+static uint32_t hvx_send(uint16_t conn_handle, const ble_gatts_hvx_params_t * p_hvx_params)
+{
+    uint32_t err_code = sd_ble_gatts_hvx(conn_handle, p_hvx_params);
+
+    if ((err_code == NRF_SUCCESS) && (p_hvx_params->type == BLE_GATT_HVX_INDICATION))
+    {
+        m_ind_pending = true;
+    }
+    return err_code;
+}
+
+
+/**@brief Function for sending the queued values until the link is busy.
+*
+* @details Called with the interrupts disabled.
+*/
+static void queue_process(void)
+{
+    ble_gatts_hvx_params_t hvx_params;
+    hvx_entry_t          * p_entry;
+    uint16_t               len;
+    uint32_t               err_code;
+
+    while (m_queue_count != 0)
+    {
+        p_entry = &m_queue[m_queue_head];
+        if ((p_entry->type == BLE_GATT_HVX_INDICATION) && m_ind_pending)
+        {
+            return;                                             /* sent on the confirmation*/
+        }
+
+        len = p_entry->len;
+        memset(&hvx_params, 0, sizeof(hvx_params));
+        hvx_params.handle = p_entry->handle;
+        hvx_params.type   = p_entry->type;
+        hvx_params.p_len  = &len;
+        hvx_params.p_data = p_entry->data;
+
+        err_code = hvx_send(p_entry->conn_handle, &hvx_params);
+        if ((err_code == BLE_ERROR_NO_TX_BUFFERS) || (err_code == NRF_ERROR_BUSY))
+        {
+            return;                                             /* sent on the next TX complete or confirmation*/
+        }
+
+        m_queue_head = (m_queue_head + 1) % HVX_QUEUE_SIZE;     /* sent, or the client does not take it any more*/
+        m_queue_count--;
+    }
+}
+
+
+uint32_t wimoto_hvx_send(uint16_t conn_handle, const ble_gatts_hvx_params_t * p_hvx_params)
+{
+    uint32_t      err_code = NRF_SUCCESS;
+    hvx_entry_t * p_entry;
+    uint16_t      len      = *p_hvx_params->p_len;
+
+    if ((p_hvx_params->offset != 0) || (p_hvx_params->p_data == NULL) || (len > HVX_DATA_MAX_LEN))
+    {
+        return NRF_ERROR_INVALID_PARAM;
+    }
+
+    CRITICAL_REGION_ENTER();
+    if ((m_queue_count == 0) && !((p_hvx_params->type == BLE_GATT_HVX_INDICATION) && m_ind_pending))
+    {
+        err_code = hvx_send(conn_handle, p_hvx_params);         /* nothing ahead of it, try at once*/
+    }
+    else
+    {
+        err_code = BLE_ERROR_NO_TX_BUFFERS;
+    }
+
+    if ((err_code == BLE_ERROR_NO_TX_BUFFERS) || (err_code == NRF_ERROR_BUSY))
+    {
+        if (m_queue_count < HVX_QUEUE_SIZE)
+        {
+            p_entry              = &m_queue[(m_queue_head + m_queue_count) % HVX_QUEUE_SIZE];
+            p_entry->conn_handle = conn_handle;
+            p_entry->handle      = p_hvx_params->handle;
+            p_entry->type        = p_hvx_params->type;
+            p_entry->len         = len;
+            memcpy(p_entry->data, p_hvx_params->p_data, len);
+            m_queue_count++;
+            err_code = NRF_SUCCESS;
+        }
+        else
+        {
+            err_code = BLE_ERROR_NO_TX_BUFFERS;                 /* the value is dropped*/
+        }
+    }
+    CRITICAL_REGION_EXIT();
+
+    return err_code;
+}
+
+
+void wimoto_hvx_on_ble_evt(ble_evt_t * p_ble_evt)
+{
+    CRITICAL_REGION_ENTER();
+    switch (p_ble_evt->header.evt_id)
+    {
+        case BLE_GAP_EVT_DISCONNECTED:
+            m_queue_head  = 0;                                  /* the values are for the lost connection*/
+            m_queue_count = 0;
+            m_ind_pending = false;
+            break;
+
+        case BLE_GATTS_EVT_HVC:
+            m_ind_pending = false;
+            queue_process();
+            break;
+
+        case BLE_EVT_TX_COMPLETE:
+            queue_process();
+            break;
+
+        default:
+            // No implementation needed.
+            break;
+    }
+    CRITICAL_REGION_EXIT();
+}
@@ -20,7 +20,7 @@
 /********************************************************************************************/
 #include <stdbool.h>
 #include <stdint.h>
-#include "twi_master.h"
+#include "twi_hw_master.h"
 #include "nrf.h"
 #include "nrf_delay.h"
 #include "nrf_gpio.h"
@@ -73,6 +73,7 @@ bool      write_to_register            (uint8_t,uint8_t,uint8_t);  /**< Write da
  *             1.Configure TMP006 in power down mode
  *             2.Configure TMP006 in continuous conversion mode         
  *             3.Get the content of V-object and T-ambient register one time
+ *             4.Start a conversion which signals its end on the DRDY pin, and read its result
 */
 
 /**< Macros       */
@@ -84,33 +85,46 @@ bool      write_to_register            (uint8_t,uint8_t,uint8_t);  /**< Write da
 #define TMP006_MANUFACT_ID_REG         0xFE     /**< Base address of Manufacturer ID register */
 #define TMP006_DEVICE_ID_REG           0xFF     /**< Base address of Device ID register */
 
-#define TMP006_ENABLE_POWER_DOWN       0x04     /**< Enable power down mode in TMP006 (no conversion) */
-#define TMP006_ENABLE_CONVERSION       0x74     /**< Enable continious conversion mode in TMP006  */
+#define TMP006_MOD_POWER_DOWN          0x00     /**< MOD bits of the Configuration register MSB: power-down */
+#define TMP006_MOD_CONTINUOUS          0x70     /**< MOD bits of the Configuration register MSB: continuous conversion */
+#define TMP006_CR_1_SAMPLE             0x00     /**< CR bits: 1 sample averaged, a result every 0.25 s */
+#define TMP006_CR_2_SAMPLES            0x02     /**< CR bits: 2 samples averaged, a result every 0.5 s */
+#define TMP006_CR_4_SAMPLES            0x04     /**< CR bits: 4 samples averaged, a result every 1 s */
+#define TMP006_CR_8_SAMPLES            0x06     /**< CR bits: 8 samples averaged, a result every 2 s */
+#define TMP006_CR_16_SAMPLES           0x08     /**< CR bits: 16 samples averaged, a result every 4 s */
+#define TMP006_DRDY_EN                 0x01     /**< EN bit: DRDY pin is pulled low when a result is ready */
+#define TMP006_CONVERSION_RATE         TMP006_CR_4_SAMPLES  /**< Averaging of the thermopile samples */
+#define TMP006_CONVERSION_TIME_MS      1000     /**< Time from the start of a conversion to its result at TMP006_CONVERSION_RATE */
+
+#define TMP006_ENABLE_POWER_DOWN       (TMP006_MOD_POWER_DOWN | TMP006_CONVERSION_RATE)                   /**< Enable power down mode in TMP006 (no conversion) */
+#define TMP006_ENABLE_CONVERSION       (TMP006_MOD_CONTINUOUS | TMP006_CONVERSION_RATE | TMP006_DRDY_EN)  /**< Enable continious conversion mode in TMP006, signalled on DRDY  */
 #define TMP006_CONFIG_REG_LSB          0x00     /**< Default value of Least Significant Byte(LSB) in Configuration register */
 
 // Constants for calculating object temperature
-#define TMP006_B0                      -0.0000294
-#define TMP006_B1                      -0.00000057
-#define TMP006_B2                       0.00000000463
-#define TMP006_C2                      13.4
-#define TMP006_TREF                   298.15
-#define TMP006_A2                      -0.00001678
-#define TMP006_A1                       0.00175
-#define TMP006_S0                       6.4       /**< 10^-14  */
+#define TMP006_B0_PV                   -29400000  /**< B0 = -2.94e-5 V, in pV */
+#define TMP006_B1_PV                   -570000    /**< B1 = -5.7e-7 V/K, in pV/K */
+#define TMP006_B2_PV                    4630      /**< B2 = 4.63e-9 V/K^2, in pV/K^2 */
+#define TMP006_C2_X10                   134       /**< C2 = 13.4 /V, in 0.1 /V */
+#define TMP006_A2_PPM_X100             -1678      /**< A2 = -1.678e-5 /K^2, in 0.01 ppm/K^2 */
+#define TMP006_A1_PPM                   1750      /**< A1 = 1.75e-3 /K, in ppm/K */
+#define TMP006_S0_X10                   64        /**< S0 = 6.4e-14 V/K^4, in 10^-15 V/K^4 */
+#define TMP006_TREF_RAW                 800       /**< Tref (298.15 K) above 0 degC, in T-ambient LSBs of 1/32 K */
+#define TMP006_VOBJ_PV_PER_LSB          156250    /**< V-object register resolution, 156.25 nV per LSB */
+#define TMP006_ZERO_CELSIUS_X800        218520    /**< 0 degC in 1/800 K */
+#define TMP006_ZERO_CELSIUS_X100        27315     /**< 0 degC in 0.01 K */
 
 /**< Functions      */
 /*Public Functions  */
 bool      TMP006_enable_powerdown_mode(void);     /**< Enable power down mode */
-uint32_t  TMP006_get_onetime_data(void);          /**< Enable continuous conversion mode then read contents of V-object & T-ambient  
-                                                       registers one time and reconfigure TMP006 in power down mode */																									 
-float     TMP006_readDieTempC(void);              /**< Calculate sensor temperature based on raw reading */
-float     TMP006_ObjTempC_conversion(void);       /**< Calculate object temperature based on raw sensor temp and thermopile voltage */
-void      do_thermopile_measurement(uint8_t*, float*);
+int32_t   TMP006_readDieTempC(void);              /**< Calculate sensor temperature in 0.01 degC based on raw reading */
+int32_t   TMP006_calc_obj_temp(int16_t raw_die, int16_t raw_vobj); /**< Object temperature in 0.01 degC from raw T-ambient and V-object */
+bool      TMP006_trigger_conversion(void);        /**< Start a conversion, its end is signalled on the DRDY pin */
+int32_t   TMP006_collect_ObjTempC(void);          /**< Read the result of the conversion and calculate the object temperature in 0.01 degC */
+void      do_thermopile_measurement(uint8_t*, int32_t*);
 /*Private Functions */
 bool      TMP006_enable_continuous_conversion(void);                          /**< Enable continuous conversion mode */
 bool      TMP006_write_to_reg(uint8_t base_Address,uint8_t MSB,uint8_t LSB);  /**< Write data to the register of TMP006*/
 uint16_t  TMP006_read_register(uint8_t base_address);                         /**< Read the data from the registers of TMP006 */
-float     stof(char*);                                                        /**< Convert string to float */
 
 
 /*Private Functions */
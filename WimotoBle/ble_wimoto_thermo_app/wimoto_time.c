@@ -0,0 +1,168 @@
+/**
+*@file     This file contains the time keeping on the RTC1 counter of the application timer.
+*
+*@details  Only the seconds since the epoch are counted, the calendar is worked out on request.
+*/
+
+#include <stdbool.h>
+#include "wimoto_time.h"
+#include "nrf_error.h"
+#include "app_timer.h"
+#include "app_util_platform.h"
+
+#define SECONDS_PER_DAY             86400UL     /**< Seconds in a day. */
+
+static uint32_t m_ticks_per_second;             /**< RTC1 frequency. */
+static uint32_t m_rtc_last;                     /**< RTC1 counter when the time was last brought up to date. */
+static uint32_t m_rtc_fraction;                 /**< RTC1 ticks of the second in progress. */
+static uint32_t m_time;                         /**< Seconds since the epoch, or since wimoto_time_init() while the date is not set. */
+static bool     m_time_valid = false;           /**< The date has been set. */
+
+
+static bool time_leap_year(uint32_t year)
+{
+    return ((year % 4) == 0) && (((year % 100) != 0) || ((year % 400) == 0));
+}
+
+
+static uint32_t time_days_in_month(uint32_t year, uint32_t month)
+{
+    static const uint8_t days[] = {31, 28, 31, 30, 31, 30, 31, 31, 30, 31, 30, 31};
+
+    return ((month == 2) && time_leap_year(year)) ? 29 : days[month - 1];
+}
+
+
+/**@brief Function for adding the RTC1 ticks counted since the last call to the time.
+*
+* @details Called with the interrupts disabled, the time is read from the main loop and the timer handlers.
+*/
+static void time_advance(void)
+{
+    uint32_t counter;
+    uint32_t ticks;
+
+    (void)app_timer_cnt_get(&counter);
+    (void)app_timer_cnt_diff_compute(counter, m_rtc_last, &ticks);
+
+    m_rtc_last      = counter;
+    m_rtc_fraction += ticks;
+    m_time         += m_rtc_fraction / m_ticks_per_second;
+    m_rtc_fraction %= m_ticks_per_second;
+}
+
+
+void wimoto_time_init(uint32_t prescaler)
+{
+    CRITICAL_REGION_ENTER();
+    m_ticks_per_second = APP_TIMER_CLOCK_FREQ / (prescaler + 1);
+    (void)app_timer_cnt_get(&m_rtc_last);
+    m_rtc_fraction     = 0;
+    m_time             = 0;
+    m_time_valid       = false;
+    CRITICAL_REGION_EXIT();
+}
+
+
+uint32_t wimoto_time_from_date_time(const ble_date_time_t * p_date_time, uint32_t * p_time)
+{
+    uint32_t days = p_date_time->day - 1;
+    uint32_t i;
+
+    if ((p_date_time->year < WIMOTO_TIME_EPOCH_YEAR) || (p_date_time->year > WIMOTO_TIME_MAX_YEAR) ||
+        (p_date_time->month < 1) || (p_date_time->month > 12) || (p_date_time->day < 1) ||
+        (p_date_time->day > time_days_in_month(p_date_time->year, p_date_time->month)) ||
+        (p_date_time->hours > 23) || (p_date_time->minutes > 59) || (p_date_time->seconds > 59))
+    {
+        return NRF_ERROR_INVALID_DATA;
+    }
+
+    for (i = WIMOTO_TIME_EPOCH_YEAR; i < p_date_time->year; i++)
+    {
+        days += time_leap_year(i) ? 366 : 365;
+    }
+    for (i = 1; i < p_date_time->month; i++)
+    {
+        days += time_days_in_month(p_date_time->year, i);
+    }
+    *p_time = (((days * 24 + p_date_time->hours) * 60 + p_date_time->minutes) * 60) + p_date_time->seconds;
+
+    return NRF_SUCCESS;
+}
+
+
+void wimoto_time_to_date_time(uint32_t time, ble_date_time_t * p_date_time)
+{
+    uint32_t days    = time / SECONDS_PER_DAY;
+    uint32_t seconds = time % SECONDS_PER_DAY;
+    uint32_t year    = WIMOTO_TIME_EPOCH_YEAR;
+    uint32_t month   = 1;
+
+    while (days >= (time_leap_year(year) ? 366 : 365))
+    {
+        days -= time_leap_year(year) ? 366 : 365;
+        year++;
+    }
+    while (days >= time_days_in_month(year, month))
+    {
+        days -= time_days_in_month(year, month);
+        month++;
+    }
+    p_date_time->year    = year;
+    p_date_time->month   = month;
+    p_date_time->day     = days + 1;
+    p_date_time->hours   = seconds / 3600;
+    p_date_time->minutes = (seconds / 60) % 60;
+    p_date_time->seconds = seconds % 60;
+}
+
+
+uint32_t wimoto_time_set(const ble_date_time_t * p_date_time)
+{
+    uint32_t time;
+
+    if (wimoto_time_from_date_time(p_date_time, &time) != NRF_SUCCESS)
+    {
+        return NRF_ERROR_INVALID_DATA;
+    }
+
+    CRITICAL_REGION_ENTER();
+    time_advance();                                 /* the second in progress starts now*/
+    m_rtc_fraction = 0;
+    m_time         = time;
+    m_time_valid   = true;
+    CRITICAL_REGION_EXIT();
+
+    return NRF_SUCCESS;
+}
+
+
+uint32_t wimoto_time_get(void)
+{
+    uint32_t time;
+
+    CRITICAL_REGION_ENTER();
+    time_advance();
+    time = m_time;
+    CRITICAL_REGION_EXIT();
+
+    return time;
+}
+
+
+void wimoto_time_date_time_get(ble_date_time_t * p_date_time)
+{
+    uint32_t time = wimoto_time_get();
+
+    if (!m_time_valid)
+    {
+        p_date_time->year    = 0;
+        p_date_time->month   = 0;
+        p_date_time->day     = 0;
+        p_date_time->hours   = (time % SECONDS_PER_DAY) / 3600;
+        p_date_time->minutes = (time / 60) % 60;
+        p_date_time->seconds = time % 60;
+        return;
+    }
+    wimoto_time_to_date_time(time, p_date_time);
+}
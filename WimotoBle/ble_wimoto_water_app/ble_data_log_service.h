@@ -23,6 +23,9 @@
 #include "ble_srv_common.h"
 #include "ble_date_time.h"
 
+#define BLE_DLOGS_MAX_CHANNELS    6                                 /**< Largest number of sensor channels in a log record. */
+#define BLE_DLOGS_WEAR_UNKNOWN    0xFFFF                            /**< lifetime of the flash which cannot be estimated yet */
+
 /**@brief Data logger event type. */
 typedef enum
 {
@@ -40,7 +43,12 @@ typedef struct
 typedef enum
 {
     BLE_DLOGS_ENABLE_WRITE,                                        /**< Datalogger enable write event. */
-    BLE_DLOGS_READ_SWITCH_WRITE                                    /**< Data log read char write event. */
+    BLE_DLOGS_READ_SWITCH_WRITE,                                   /**< Data log read char write event. */
+    BLE_DLOGS_CURSOR_WRITE,                                        /**< Data log cursor char write event. */
+    BLE_DLOGS_QUERY_WRITE,                                         /**< Data log query char write event. */
+    BLE_DLOGS_ROLLUP_WRITE,                                        /**< Data log rollup char write event. */
+    BLE_DLOGS_DEADBAND_WRITE,                                      /**< Data log deadband char write event. */
+    BLE_DLOGS_INTERVAL_WRITE                                       /**< Data log interval char write event. */
 }ble_dlogs_write_evt_type_t;
 
 /**@brief Data logger Service value write event. */
@@ -58,6 +66,16 @@ typedef void (*ble_dlogs_evt_handler_t) (ble_dlogs_t * p_dlogs, ble_dlogs_evt_t
 /**@brief Data logger  value write event handler type. */
 typedef void (*ble_dlogs_write_evt_handler_t) (ble_dlogs_t * p_dlogs, ble_dlogs_write_evt_t * p_evt);
 
+/**@brief Data logger record schema entry. Describes where a sensor channel is found in a log
+*        record and how many of its bits are stored. */
+typedef struct
+{
+    uint8_t                       word;                         /**< Record word holding the channel. */
+    uint8_t                       pos;                          /**< Lowest bit of the channel in the word. */
+    uint8_t                       bits;                         /**< Number of bits stored, at most 16. */
+    uint8_t                       scale;                        /**< Number of low bits below the stored ones, these are always zero. */
+} ble_dlogs_channel_t;
+
 /**@brief Data logger Service init structure. This contains all options and data needed for
 *        initialization of the service.*/
 typedef struct
@@ -69,6 +87,7 @@ typedef struct
     uint8_t                       data_logger_enable;  					/**< switch to enable data loggin functionality */
     uint8_t                       read_data_switch;  						 /**< switch to start reading data */
     uint8_t                       data[8]; 											/**< data logged in flash to send over BLE */
+    uint16_t                      log_interval;                 /**< minutes between logged records until set by the central */
     ble_srv_cccd_security_mode_t  dlogs_char_attr_md;         	/**< Initial security level for data logger characteristics attribute */
     ble_srv_cccd_security_mode_t  dlogs_char_attr_md2;         	/**< Initial security level for data logger characteristics attribute */
     ble_gap_conn_sec_mode_t       dlogs_report_read_perm;       /**< Initial security level for data logger read attribute */
@@ -84,14 +103,38 @@ typedef struct ble_dlogs_s
     ble_gatts_char_handles_t      data_logger_enable_handles;    /**< Handles for temperature  characteristic. */
     ble_gatts_char_handles_t      data_handles;          	       /**< Handles for temperature low Level characteristic. */
     ble_gatts_char_handles_t      read_data_handles;          	 /**< Handles for temperature low Level characteristic. */
+    ble_gatts_char_handles_t      cursor_handles;                /**< Handles for the download cursor characteristic. */
+    ble_gatts_char_handles_t      query_handles;                 /**< Handles for the download query characteristic. */
+    ble_gatts_char_handles_t      rollup_handles;                /**< Handles for the rollup download characteristic. */
+    ble_gatts_char_handles_t      deadband_handles;              /**< Handles for the deadband characteristic. */
+    ble_gatts_char_handles_t      interval_handles;              /**< Handles for the logging interval characteristic. */
     uint16_t                      report_ref_handle;             /**< Handle of the Report Reference descriptor. */
     uint8_t                       data_logger_enable;  					 /**< switch to enable data loggin functionality */
     uint8_t                       read_data_switch;  						 /**< switch to start reading data */
+    uint16_t                      cursor;                        /**< log ID of the last record acknowledged by the central */
+    uint32_t                      query_start;                   /**< time stamp of the first record to download, 0 for the oldest record */
+    uint32_t                      query_end;                     /**< time stamp of the last record to download, 0 for the newest record */
+    uint8_t                       query_stride;                  /**< download every query_stride-th record of the window, 0 or 1 for all */
+    uint8_t                       rollup;                        /**< rollup ring to download, 0 for the logged records, 1 hourly, 2 daily */
+    uint8_t                       heartbeat;                     /**< hours between records written in deadband mode, 0 writes every record */
+    uint16_t                      deadband[BLE_DLOGS_MAX_CHANNELS];  /**< change of a channel value which is written in deadband mode */
+    uint16_t                      interval;                      /**< minutes between logged records */
+    uint8_t                       decimation[BLE_DLOGS_MAX_CHANNELS];  /**< every decimation-th logged record takes a new value of the channel, 0 or 1 for all */
     uint8_t                       data[16]; 										 /**< data logged in flash to send over BLE */
     uint16_t                      conn_handle;                   /**< Handle of the current connection (as provided by the BLE stack, is BLE_CONN_HANDLE_INVALID if not in a connection). */
     bool                          is_notification_supported;     /**< TRUE if notification of Temperature Level is supported. */
 } ble_dlogs_t;
 
+/**@brief Flash wear statistics of the data logger, see data_log_wear_get(). */
+typedef struct
+{
+    uint32_t                      total_erases;                  /**< erases of all pages of the log buffer and the rollup rings */
+    uint8_t                       hot_page;                      /**< flash page erased most often */
+    uint32_t                      hot_erases;                    /**< erase count of hot_page */
+    uint8_t                       fill;                          /**< part of the log buffer holding records, in percent */
+    uint16_t                      lifetime;                      /**< estimated days until the first page reaches its erase endurance, BLE_DLOGS_WEAR_UNKNOWN if not known yet */
+} ble_dlogs_wear_t;
+
 typedef enum
 {
     READ,
@@ -120,20 +163,63 @@ uint32_t ble_dlogs_init(ble_dlogs_t * p_dlogs, const ble_dlogs_init_t * p_dlogs_
 */
 void ble_dlogs_on_ble_evt(ble_dlogs_t * p_dlogs, ble_evt_t * p_ble_evt);
 
-/**@brief Function write sensor data to flash.
+/**@brief Function for queueing sensor data to be written to flash.
 *
-* @param[in]   data             Data buffer.
-* 
+* @details Records are staged in RAM and written to flash in batches. Returns immediately, the
+*          flash operations are driven by the flash system events. The record is also added to
+*          the hourly and daily rollups. Channels which are not due by their decimation factor
+*          are set to their last value written. In deadband mode a record which differs too
+*          little from the last record written is only added to the rollups.
+*
+* @param[in,out] data           Data buffer.
+*
+* @return      NRF_SUCCESS on success, NRF_ERROR_NO_MEM if the write-back buffer is full,
+*              NRF_ERROR_INVALID_STATE if the record is within the deadband and not written.
 */
-void write_data_flash(uint32_t * data);																
+uint32_t write_data_flash(uint32_t * data);																
+
+/**@brief Function for writing all records staged in RAM to flash.
+*
+* @return      true if all records are in flash and the writer is idle, false otherwise.
+*/
+bool data_log_flush(void);
+
+/**@brief Function for restoring the data logger pointers from flash after a reset.
+*
+* @details Locates the newest page and the end of the compressed records of the cyclic buffer
+*          and of the rollup rings, so that logging continues without erasing the logged data.
+*          Call once at startup.
+*
+* @param[out]  p_next_id        Log ID following the newest record in flash.
+*
+* @return      true if a logged record was found, false if the buffer is empty.
+*/
+bool data_log_init(uint16_t * p_next_id);
+
+/**@brief Function for getting the flash wear statistics of the data logger.
+*
+* @details Every page of the log buffer and of the rollup rings counts its erases in its header.
+*          The remaining lifetime is estimated from the time a page takes to fill and the erase
+*          count of the page erased most often, assuming the current logging interval.
+*
+* @param[out]  p_wear           Flash wear statistics.
+*/
+void data_log_wear_get(ble_dlogs_wear_t * p_wear);
 
 /**@brief Function to send data to the connected BLE central device.
 *
+* @details Sends the logged records, packed into notifications, keeping all TX buffers filled.
+*          If a query has been written, only the records of its time window are sent. The
+*          records logged before the download started are sent, logging continues meanwhile.
+*          If a rollup download or the flash image of the log has been requested, the pages are
+*          sent as stored, straight from flash.
+*          Returns when all TX buffers are in use, call again on the next TX complete event.
+*
 * @param[in]   ble_dlogs        Data logger service structure.
 *
-* 
+* @return      true if the download is complete, false if it has to be continued.
 */
-void send_data(ble_dlogs_t * ble_dlogs);               
+bool send_data(ble_dlogs_t * ble_dlogs);               
 
 /**@brief Function reading data to flash and sending to the connected BLE central device.
 *
@@ -146,12 +232,13 @@ uint32_t read_data_flash(ble_dlogs_t * ble_dlogs, uint32_t * data);
 /**@brief Function to send the data to the connected central device.
 *
 * @param[in]   ble_dlogs  Data logger service structure.
-* @param[in]   data       Data buffer.
+* @param[in]   p_data     Packed log records.
+* @param[in]   len        Length of the packed log records.
 * @return      NRF_SUCCESS on success, otherwise an error code.
 */
-uint32_t send_data_to_central(ble_dlogs_t * ble_dlogs,uint32_t *data);
+uint32_t send_data_to_central(ble_dlogs_t * ble_dlogs, uint8_t * p_data, uint16_t len);
 
-/**@brief Function to reset the datalogger enable and read data switch characteristics.
+/**@brief Function to reset the read data switch and rollup characteristics after a download.
 *
 * @param[in]   ble_dlogs        Data logger service structure.
 * 
@@ -20,12 +20,12 @@
 #include "app_util.h"
 #include "wimoto.h"
 #include "ble_date_time.h"
+#include "wimoto_time.h"
+#include "wimoto_evt.h"
+#include "wimoto_hvx.h"
+#include "app_error.h"
 
 bool   DEVICE_CONNECTED_STATE = false;                  /* This flag indicates whether a client is connected to the peripheral or not*/
-bool   DFU_ENABLE             = false;                  /* Flah to check whether DFU feature has been enabled or not*/
-bool 	 LED_FLASH							= false;									/* Flag to indicate whether or not to flash LED*/
-extern ble_date_time_t m_time_stamp;                    /* Time stamp defined in connect.c. */
-extern bool TIME_SET;                                   /* Flag to start time updation, defined in connect.c*/
 extern uint8_t	 var_receive_uuid;											/*variable to receive uuid*/
 
 
@@ -54,6 +54,62 @@ static void on_disconnect(ble_device_t * p_device, ble_evt_t * p_ble_evt)
 }
 
 
+/**@brief Function for encoding the current time as the value of the time stamp characteristic.
+*
+* @param[out]  p_encoded        Buffer of 7 bytes.
+*/
+void ble_time_stamp_encode(uint8_t * p_encoded)
+{
+    ble_date_time_t time_stamp;
+
+    wimoto_time_date_time_get(&time_stamp);
+
+    p_encoded[0] = ((time_stamp.year) & 0xFF00) >> 8;
+    p_encoded[1] = time_stamp.year;
+    p_encoded[2] = time_stamp.month;
+    p_encoded[3] = time_stamp.day;
+    p_encoded[4] = time_stamp.hours;
+    p_encoded[5] = time_stamp.minutes;
+    p_encoded[6] = time_stamp.seconds;
+}
+
+
+/**@brief Function for handling the Read/Write Authorization Request event.
+*
+* @details Reads of the time stamp characteristic are answered with the current time, so the time
+*          is only worked out when a client reads it.
+*
+* @param[in]   p_device    Device Management Service structure.
+* @param[in]   p_ble_evt   Event received from the BLE stack.
+*/
+static void on_rw_authorize_request(ble_device_t * p_device, ble_evt_t * p_ble_evt)
+{
+    ble_gatts_evt_rw_authorize_request_t * p_auth_req = &p_ble_evt->evt.gatts_evt.params.authorize_request;
+    ble_gatts_rw_authorize_reply_params_t  auth_reply;
+    uint8_t                                time_stamp[7];
+    uint32_t                               err_code;
+
+    if ((p_auth_req->type == BLE_GATTS_AUTHORIZE_TYPE_READ) &&
+        (p_auth_req->request.read.handle == p_device->time_stamp_handles.value_handle))
+    {
+        ble_time_stamp_encode(time_stamp);
+
+        memset(&auth_reply, 0, sizeof(auth_reply));
+
+        auth_reply.type                    = BLE_GATTS_AUTHORIZE_TYPE_READ;
+        auth_reply.params.read.gatt_status = BLE_GATT_STATUS_SUCCESS;
+        auth_reply.params.read.len         = sizeof(time_stamp);
+        auth_reply.params.read.p_data      = time_stamp;        /* the stack copies the value to the characteristic*/
+
+        err_code = sd_ble_gatts_rw_authorize_reply(p_ble_evt->evt.gatts_evt.conn_handle, &auth_reply);
+        if ((err_code != NRF_SUCCESS) && (err_code != NRF_ERROR_INVALID_STATE))
+        {
+            APP_ERROR_HANDLER(err_code);                       /* the client may have disconnected meanwhile*/
+        }
+    }
+}
+
+
 /**@brief Function for handling the write event.
 *
 * @param[in]   p_device    Device Management Service structure.
@@ -67,19 +123,15 @@ static void write_evt_handler (ble_device_t * p_device, ble_device_write_evt_t *
     case BLE_DEVICE_DFU_WRITE:
         if(p_device->device_dfu_mode_set == 0x01)
         {
-            DFU_ENABLE = true;
+            wimoto_evt_post(WIMOTO_EVT_DFU_ENABLE);
         }
 				else if(p_device->device_dfu_mode_set == 0x80)
 				{
-						LED_FLASH = true;
+						wimoto_evt_post(WIMOTO_EVT_LED_FLASH);
 				}
-        else
-        {
-            DFU_ENABLE = false;
-        }	 
         break;
     case BLE_DEVICE_TIME_STAMP_WRITE:
-        TIME_SET = true;
+        wimoto_evt_post(WIMOTO_EVT_TIME_SET);
         break;  
     default:
         break;
@@ -217,6 +269,10 @@ void ble_device_on_ble_evt(ble_device_t * p_device, ble_evt_t * p_ble_evt)
         on_write(p_device, p_ble_evt);
         break;
 
+    case BLE_GATTS_EVT_RW_AUTHORIZE_REQUEST:
+        on_rw_authorize_request(p_device, p_ble_evt);
+        break;
+
     default:
         break;
     }
@@ -333,7 +389,7 @@ static uint32_t time_stamp_char_add(ble_device_t * p_device, const ble_device_in
     attr_md.read_perm  = p_device_init->device_char_attr_md.read_perm;
     attr_md.write_perm = p_device_init->device_char_attr_md.write_perm;
     attr_md.vloc       = BLE_GATTS_VLOC_USER;
-    attr_md.rd_auth    = 0;
+    attr_md.rd_auth    = 1;                                   /* the value is set when a client reads it*/
     attr_md.wr_auth    = 0;
     attr_md.vlen       = 0;
 
@@ -367,6 +423,71 @@ static uint32_t time_stamp_char_add(ble_device_t * p_device, const ble_device_in
 }
 
 
+/**@brief Function for adding the flash wear characteristic.
+*
+* @details The value holds the erase statistics of the flash pages of the data logger, most
+*          significant byte first: total number of page erases (4 bytes), the page erased most
+*          often (1 byte) and its erase count (4 bytes), the fill level of the log buffer in
+*          percent (1 byte) and the estimated remaining lifetime in days (2 bytes, 0xFFFF if it
+*          cannot be estimated yet).
+*
+* @param[in]   p_device       Device Management Service structure.
+* @param[in]   p_device_init  Information needed to initialize the service.
+*
+* @return      NRF_SUCCESS on success, otherwise an error code.
+*/
+static uint32_t flash_wear_char_add(ble_device_t * p_device, const ble_device_init_t * p_device_init)
+{
+    uint32_t            err_code;
+    ble_gatts_char_md_t char_md;
+    ble_gatts_attr_t    attr_char_value;
+    ble_uuid_t          ble_uuid;
+    ble_gatts_attr_md_t attr_md;
+    static uint8_t      flash_wear_char[BLE_DEVICE_FLASH_WEAR_LEN];
+
+    memset(&char_md, 0, sizeof(char_md));
+
+    char_md.char_props.read           = 1;
+    char_md.p_char_user_desc          = NULL;
+    char_md.p_char_pf                 = NULL;
+    char_md.p_user_desc_md            = NULL;
+    char_md.p_cccd_md                 = NULL;
+    char_md.p_sccd_md                 = NULL;
+
+    //Adding custom UUID
+    ble_uuid.type = p_device->uuid_type;
+    ble_uuid.uuid = WATER_PROFILE_DEVICE_FLASH_WEAR_CHAR_UUID;
+
+    memset(&attr_md, 0, sizeof(attr_md));
+
+    attr_md.read_perm  = p_device_init->device_char_attr_md.read_perm;
+    BLE_GAP_CONN_SEC_MODE_SET_NO_ACCESS(&attr_md.write_perm);
+    attr_md.vloc       = BLE_GATTS_VLOC_USER;
+    attr_md.rd_auth    = 0;
+    attr_md.wr_auth    = 0;
+    attr_md.vlen       = 0;
+
+    memset(&attr_char_value, 0, sizeof(attr_char_value));
+
+    attr_char_value.p_uuid       = &ble_uuid;
+    attr_char_value.p_attr_md    = &attr_md;
+    attr_char_value.init_len     = sizeof(flash_wear_char);
+    attr_char_value.init_offs    = 0;
+    attr_char_value.max_len      = sizeof(flash_wear_char);
+    attr_char_value.p_value      = flash_wear_char;
+
+    err_code = sd_ble_gatts_characteristic_add(p_device->service_handle, &char_md,
+    &attr_char_value,
+    &p_device->flash_wear_handles);
+    if (err_code != NRF_SUCCESS)
+    {
+        return err_code;
+    }
+
+    return NRF_SUCCESS;
+}
+
+
 
 /**@brief Function for initializing the Device management service.
 *
@@ -412,71 +533,93 @@ uint32_t ble_device_init(ble_device_t * p_device, const ble_device_init_t * p_de
         return err_code;
     }
 
+    err_code =  flash_wear_char_add(p_device, p_device_init);  /* Add flash wear characteristic */
+    if (err_code != NRF_SUCCESS)
+    {
+        return err_code;
+    }
+
     return NRF_SUCCESS;
 
 }
 
-/**@brief Function to get the time set by the user and create a time stamp structure
+/**@brief Function to get the time set by the user and set the clock to it
 *
 * @param[in]   p_device         Device Management Service structure.
-* @param[in]   p_time_stamp     Time stamp structure.
 *
-* 
+* @return      NRF_SUCCESS on success, NRF_ERROR_INVALID_DATA if the user set time is not valid.
 */
-
-void create_time_stamp(ble_device_t * p_device, ble_date_time_t * p_time_stamp)
+uint32_t create_time_stamp(ble_device_t * p_device)
 {
-    /*Create new time stamp  */
-    p_time_stamp->year    = (p_device->device_time_stamp_set[0]<<8)|p_device->device_time_stamp_set[1];
-    p_time_stamp->month   = p_device->device_time_stamp_set[2];
-    p_time_stamp->day     = p_device->device_time_stamp_set[3];
-    p_time_stamp->hours   = p_device->device_time_stamp_set[4];
-    p_time_stamp->minutes = p_device->device_time_stamp_set[5];
-    p_time_stamp->seconds = p_device->device_time_stamp_set[6];
+    ble_date_time_t time_stamp;
 
+    /*Create new time stamp  */
+    time_stamp.year    = (p_device->device_time_stamp_set[0]<<8)|p_device->device_time_stamp_set[1];
+    time_stamp.month   = p_device->device_time_stamp_set[2];
+    time_stamp.day     = p_device->device_time_stamp_set[3];
+    time_stamp.hours   = p_device->device_time_stamp_set[4];
+    time_stamp.minutes = p_device->device_time_stamp_set[5];
+    time_stamp.seconds = p_device->device_time_stamp_set[6];
+
+    return wimoto_time_set(&time_stamp);
 }
 
 
-/**@brief Function updates the current time to the client.
+/**@brief Function for notifying the current time to the client.
 *
 * @param[in]   p_device         Device Management Service structure.
-* @param[in]   p_time_stamp     Time stamp structure.
 *
-* @return      NRF_SUCCESS on success, otherwise an error code.
+* @return      NRF_SUCCESS on success, NRF_ERROR_INVALID_STATE if no client is connected, otherwise an error code.
 */
-uint32_t ble_time_update(ble_device_t * p_device, ble_date_time_t *p_time_stamp)
+uint32_t ble_time_update(ble_device_t * p_device)
 {
-    uint32_t err_code = NRF_SUCCESS;  
-    uint16_t  len = 7;
+    uint8_t                time_stamp[7];
+    uint16_t               len = sizeof(time_stamp);
+    ble_gatts_hvx_params_t hvx_params;
 
-    //update the service structure
-    p_device->device_time_stamp_set[0]= ((p_time_stamp->year)& 0xFF00)>>8;
-    p_device->device_time_stamp_set[1]= p_time_stamp->year;
-    p_device->device_time_stamp_set[2]= p_time_stamp->month;
-    p_device->device_time_stamp_set[3]= p_time_stamp->day;
-    p_device->device_time_stamp_set[4]= p_time_stamp->hours;
-    p_device->device_time_stamp_set[5]= p_time_stamp->minutes;
-    p_device->device_time_stamp_set[6]= p_time_stamp->seconds;
+    if ((p_device->conn_handle == BLE_CONN_HANDLE_INVALID) || !p_device->is_notification_supported)
+    {
+        return NRF_ERROR_INVALID_STATE;                       /* the time is not worked out while nobody listens*/
+    }
 
+    ble_time_stamp_encode(time_stamp);
 
-    if ((p_device->conn_handle != BLE_CONN_HANDLE_INVALID) && p_device->is_notification_supported)
-    {
-        ble_gatts_hvx_params_t hvx_params;
+    memset(&hvx_params, 0, sizeof(hvx_params));
 
-        memset(&hvx_params, 0, sizeof(hvx_params));
+    hvx_params.handle   = p_device->time_stamp_handles.value_handle;
+    hvx_params.type     = BLE_GATT_HVX_NOTIFICATION;
+    hvx_params.offset   = 0;
+    hvx_params.p_len    = &len;
+    hvx_params.p_data   = time_stamp;
 
-        hvx_params.handle   = p_device->time_stamp_handles.value_handle;
-        hvx_params.type     = BLE_GATT_HVX_NOTIFICATION;
-        hvx_params.offset   = 0;
-        hvx_params.p_len    = &len;
-        hvx_params.p_data   = p_device->device_time_stamp_set;
+    return wimoto_hvx_send(p_device->conn_handle, &hvx_params);
+}
 
-        err_code = sd_ble_gatts_hvx(p_device->conn_handle, &hvx_params);
-    }
-    else
-    {
-        err_code = NRF_ERROR_INVALID_STATE;
-    }
-    return err_code;
 
+/**@brief Function for updating the flash wear characteristic.
+*
+* @param[in]   p_device         Device Management Service structure.
+* @param[in]   p_wear           Flash wear statistics of the data logger.
+*
+* @return      NRF_SUCCESS on success, otherwise an error code.
+*/
+uint32_t ble_flash_wear_update(ble_device_t * p_device, const ble_dlogs_wear_t * p_wear)
+{
+    uint8_t  flash_wear[BLE_DEVICE_FLASH_WEAR_LEN];
+    uint16_t len = sizeof(flash_wear);
+
+    flash_wear[0]  = (uint8_t)(p_wear->total_erases >> 24);
+    flash_wear[1]  = (uint8_t)(p_wear->total_erases >> 16);
+    flash_wear[2]  = (uint8_t)(p_wear->total_erases >> 8);
+    flash_wear[3]  = (uint8_t)p_wear->total_erases;
+    flash_wear[4]  = p_wear->hot_page;
+    flash_wear[5]  = (uint8_t)(p_wear->hot_erases >> 24);
+    flash_wear[6]  = (uint8_t)(p_wear->hot_erases >> 16);
+    flash_wear[7]  = (uint8_t)(p_wear->hot_erases >> 8);
+    flash_wear[8]  = (uint8_t)p_wear->hot_erases;
+    flash_wear[9]  = p_wear->fill;
+    flash_wear[10] = (uint8_t)(p_wear->lifetime >> 8);
+    flash_wear[11] = (uint8_t)p_wear->lifetime;
+
+    return sd_ble_gatts_value_set(p_device->flash_wear_handles.value_handle, 0, &len, flash_wear);
 }
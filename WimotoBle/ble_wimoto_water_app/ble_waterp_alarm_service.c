@@ -26,15 +26,17 @@
 #include "ble_srv_common.h"
 #include "app_util.h"
 #include "wimoto.h"
+#include "wimoto_evt.h"
+#include "wimoto_hvx.h"
 #include "wimoto_sensors.h"
 
 extern bool 			WATERP_EVENT_FLAG;              /* This flag indicates whether there is an event on gpiote */
 bool     	    		WATERPS_CONNECTED_STATE=false;  /* Indicates whether the water presence service is connected or not*/
 extern uint8_t		var_receive_uuid;								/*variable to receive uuid*/
 extern uint8_t	  curr_waterpresence;             /* water presence value for broadcast*/
-extern bool       CHECK_ALARM_TIMEOUT;
 bool              waterp_alarm_set_changed = false;
 bool     					m_waterps_alarm_ind_conf_pending = false;       /**< Flag to keep track of when an indication confirmation is pending. */
+bool     				WATERPS_READ_PENDING = false;       /**< Flag to keep track of when a read of the current water presence waits for a measurement. */
 /**@brief Function for handling the Connect event.
 *
 * @param[in]   p_waterps   water presence Service structure.
@@ -44,7 +46,7 @@ static void on_connect(ble_waterps_t * p_waterps, ble_evt_t * p_ble_evt)
 {
     p_waterps->conn_handle = p_ble_evt->evt.gap_evt.conn_handle;
     WATERPS_CONNECTED_STATE = true;  /*Set the flag to true so that state remains in connectable mode until disconnect*/
-		CHECK_ALARM_TIMEOUT = true;			 /*Set the flag to do alarm check on connection*/
+		wimoto_evt_post(WIMOTO_EVT_ALARM_CHECK);			 /*check the alarm conditions on connection*/
 }
 
 
@@ -61,6 +63,27 @@ static void on_disconnect(ble_waterps_t * p_waterps, ble_evt_t * p_ble_evt)
 }
 
 
+/**@brief Function for handling the Read/Write Authorization Request event.
+*
+* @details A read of the current water presence is answered by ble_waterps_current_read_reply() once the main loop
+*          has taken a new measurement.
+*
+* @param[in]   p_waterps   water presence Service structure.
+* @param[in]   p_ble_evt   Event received from the BLE stack.
+*/
+static void on_rw_authorize_request(ble_waterps_t * p_waterps, ble_evt_t * p_ble_evt)
+{
+    ble_gatts_evt_rw_authorize_request_t * p_auth_req = &p_ble_evt->evt.gatts_evt.params.authorize_request;
+
+    if ((p_auth_req->type == BLE_GATTS_AUTHORIZE_TYPE_READ) &&
+        (p_auth_req->request.read.handle == p_waterps->current_waterp_handles.value_handle))
+    {
+        WATERPS_READ_PENDING = true;
+        wimoto_evt_post(WIMOTO_EVT_READ_SENSORS);    /* the measurement is taken from the main loop*/
+    }
+}
+
+
 /**@brief Function for handling write events on values.
 *
 * @details This function will be called for all write events of water presence low, high values and alarm set 
@@ -222,11 +245,16 @@ void ble_waterps_on_ble_evt(ble_waterps_t * p_waterps, ble_evt_t * p_ble_evt)
 
     case BLE_GAP_EVT_DISCONNECTED:
 				m_waterps_alarm_ind_conf_pending = false;															//Clear pending confirmation flag if a disconnect occurs
+				WATERPS_READ_PENDING = false;
         on_disconnect(p_waterps, p_ble_evt);
         break;
 
     case BLE_GATTS_EVT_WRITE:
         on_write(p_waterps, p_ble_evt);
+        break;
+
+    case BLE_GATTS_EVT_RW_AUTHORIZE_REQUEST:
+        on_rw_authorize_request(p_waterps, p_ble_evt);
         break;
 		case BLE_GATTS_EVT_HVC:    //Handle Value Confirmation event
             on_hvc(p_waterps, p_ble_evt);
@@ -282,7 +310,7 @@ static uint32_t current_waterpresence_char_add(ble_waterps_t * p_waterps, const
     attr_md.read_perm  = p_waterps_init->waterpresence_char_attr_md.read_perm;
     attr_md.write_perm = p_waterps_init->waterpresence_char_attr_md2.write_perm;
     attr_md.vloc       = BLE_GATTS_VLOC_USER;
-    attr_md.rd_auth    = 0;
+    attr_md.rd_auth    = 1;                                   /* the value is measured when a client reads it*/
     attr_md.wr_auth    = 0;
     attr_md.vlen       = 0;
 
@@ -509,24 +537,16 @@ uint32_t ble_waterps_init(ble_waterps_t * p_waterps, const ble_waterps_init_t *
 }
 
 
-/**@brief Function reads and updates the current water presence and checks for alarm condition.
-*  Executes only when an event occurs on gpiote pin for water presence
+/**@brief Function for measuring the water presence.
 *
-* @param[in]   p_waterps        water presence  Service structure.
-*
-* @param[in]   p_device       Device management Service structure.
+* @details The sensor is only energized for the measurement.
 *
-* @return      NRF_SUCCESS on success, otherwise an error code.
+* @return      WATER_PRESENT if water is present.
 */
-uint32_t ble_waterps_alarm_check(ble_waterps_t * p_waterps,ble_device_t *p_device)
+static uint8_t read_waterpresence(void)
 {
-    uint32_t err_code;
-    uint8_t  current_waterpresence;       				/* Current water presence*/
 		uint8_t waterp_pin_reading;
-    static uint8_t alarm[8]= {0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00};
-    uint16_t len1 = sizeof(uint8_t);
-		uint16_t len	= 8;	//length of alarm with time stamp characteristics
-	
+
 		//Set up necessary pins for presence measurement
 		nrf_gpio_cfg_input(WATERP_GPIOTE_PIN,GPIO_PIN_CNF_PULL_Disabled);           /* Configure pin p0.01 as input with pull-up disabled*/
 		nrf_gpio_cfg_output(WATER_SENSOR_ENERGIZE_PIN);                             /* Configure P0.02 as output to energize the water presence sensor */
@@ -549,8 +569,28 @@ uint32_t ble_waterps_alarm_check(ble_waterps_t * p_waterps,ble_device_t *p_devic
                                         | (GPIO_PIN_CNF_PULL_Disabled << GPIO_PIN_CNF_PULL_Pos)
                                         | (GPIO_PIN_CNF_INPUT_Disconnect << GPIO_PIN_CNF_INPUT_Pos)
                                         | (GPIO_PIN_CNF_DIR_Input << GPIO_PIN_CNF_DIR_Pos);
-		
-		current_waterpresence = !(waterp_pin_reading);									/* Active Low voltage in pin indicates water presence.So invert the waterp_pin_reading */
+		return !(waterp_pin_reading);																		/* Active Low voltage in pin indicates water presence.So invert the waterp_pin_reading */
+}
+
+
+/**@brief Function reads and updates the current water presence and checks for alarm condition.
+*  Executes only when an event occurs on gpiote pin for water presence
+*
+* @param[in]   p_waterps        water presence  Service structure.
+*
+* @param[in]   p_device       Device management Service structure.
+*
+* @return      NRF_SUCCESS on success, otherwise an error code.
+*/
+uint32_t ble_waterps_alarm_check(ble_waterps_t * p_waterps,ble_device_t *p_device)
+{
+    uint32_t err_code;
+    uint8_t  current_waterpresence;       				/* Current water presence*/
+    static uint8_t alarm[8]= {0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00};
+    uint16_t len1 = sizeof(uint8_t);
+		uint16_t len	= 8;	//length of alarm with time stamp characteristics
+	
+		current_waterpresence = read_waterpresence();										/* Measure the current water presence*/
 		curr_waterpresence =current_waterpresence; 											/*copy the current waterpresence value for global broadcast data*/							
 
 		
@@ -566,7 +606,7 @@ uint32_t ble_waterps_alarm_check(ble_waterps_t * p_waterps,ble_device_t *p_devic
         hvx_params.p_len    = &len1;
         hvx_params.p_data   = &current_waterpresence;
 
-        err_code = sd_ble_gatts_hvx(p_waterps->conn_handle, &hvx_params);  /*Send the current water presence value*/
+        err_code = wimoto_hvx_send(p_waterps->conn_handle, &hvx_params);  /*Send the current water presence value*/
     }
     else
     {
@@ -579,13 +619,7 @@ uint32_t ble_waterps_alarm_check(ble_waterps_t * p_waterps,ble_device_t *p_devic
 			  if (current_waterpresence == WATER_PRESENT)					/*Check the presence of water */
         {
             alarm[0] = 0x01;																/*If water is present set the alarm and capture the timestamp of last occurance*/
-						alarm[1] = p_device->device_time_stamp_set[0];  
-						alarm[2] = p_device->device_time_stamp_set[1];
-						alarm[3] = p_device->device_time_stamp_set[2];
-						alarm[4] = p_device->device_time_stamp_set[3];
-						alarm[5] = p_device->device_time_stamp_set[4];
-						alarm[6] = p_device->device_time_stamp_set[5];
-						alarm[7] = p_device->device_time_stamp_set[6];
+						ble_time_stamp_encode(&alarm[1]);	/*capture the timestamp when alarm occured*/
 				}
         
     }
@@ -627,7 +661,7 @@ uint32_t ble_waterps_alarm_check(ble_waterps_t * p_waterps,ble_device_t *p_devic
             hvx_params.p_len    = &len;
             hvx_params.p_data   = alarm;
 
-            err_code = sd_ble_gatts_hvx(p_waterps->conn_handle, &hvx_params);
+            err_code = wimoto_hvx_send(p_waterps->conn_handle, &hvx_params);
 						p_waterps->waterps_alarm_with_time_stamp[0]  = alarm[0]; 
 						if(err_code == NRF_SUCCESS)
 						{
@@ -645,3 +679,36 @@ uint32_t ble_waterps_alarm_check(ble_waterps_t * p_waterps,ble_device_t *p_devic
     return err_code;
 
 }
+
+
+/**@brief Function for answering a pending read of the current water presence.
+*
+* @details The application calls this function from the main loop after a read of the current
+*          water presence was requested.
+*
+* @param[in]   p_waterps    water presence Service structure.
+*
+* @return      NRF_SUCCESS on success, NRF_ERROR_INVALID_STATE if no read is pending, otherwise an error code.
+*/
+uint32_t ble_waterps_current_read_reply(ble_waterps_t * p_waterps)
+{
+    ble_gatts_rw_authorize_reply_params_t auth_reply;
+    uint8_t                               current_value;
+
+    if (!WATERPS_READ_PENDING)
+    {
+        return NRF_ERROR_INVALID_STATE;
+    }
+    WATERPS_READ_PENDING = false;
+
+    current_value = read_waterpresence();
+
+    memset(&auth_reply, 0, sizeof(auth_reply));
+
+    auth_reply.type                    = BLE_GATTS_AUTHORIZE_TYPE_READ;
+    auth_reply.params.read.gatt_status = BLE_GATT_STATUS_SUCCESS;
+    auth_reply.params.read.len         = sizeof(current_value);
+    auth_reply.params.read.p_data      = &current_value;       /* the stack copies the value to the characteristic*/
+
+    return sd_ble_gatts_rw_authorize_reply(p_waterps->conn_handle, &auth_reply);
+}
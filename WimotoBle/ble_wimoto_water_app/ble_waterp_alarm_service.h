@@ -132,6 +132,14 @@ void ble_waterps_on_ble_evt(ble_waterps_t * p_bas, ble_evt_t * p_ble_evt);
 */
 uint32_t ble_waterps_alarm_check(ble_waterps_t *,ble_device_t *);
 
+/**@brief Function for answering a pending read of the current water presence with a new measurement.
+*
+* @param[in]   p_waterps    water presence Service structure.
+*
+* @return      NRF_SUCCESS on success, NRF_ERROR_INVALID_STATE if no read is pending, otherwise an error code.
+*/
+uint32_t ble_waterps_current_read_reply(ble_waterps_t *);
+
 #endif // BLE_WATERPS_LOW_H__
 
 /** @} */
@@ -37,6 +37,7 @@
 #include "ble_conn_params.h"
 #include "softdevice_handler.h"
 #include "app_timer.h"
+#include "app_scheduler.h"
 #include "app_gpiote.h"
 #include "app_button.h"
 #include "ble_error_log.h"
@@ -46,6 +47,10 @@
 #include "ble_bas.h"
 #include "wimoto_sensors.h"
 #include "wimoto.h"
+#include "wimoto_format.h"
+#include "wimoto_time.h"
+#include "wimoto_evt.h"
+#include "wimoto_hvx.h"
 #include "ble_device_mgmt_service.h"
 #include "battery.h"
 #include "boards.h"
@@ -72,9 +77,12 @@
 #define APP_TIMER_MAX_TIMERS                 5                                          /**< Maximum number of simultaneously created timers. */
 #define APP_TIMER_OP_QUEUE_SIZE              4                                          /**< Size of timer operation queues. */
 																														
-#define WATER_LEVEL_MEAS_INTERVAL            APP_TIMER_TICKS(60000, APP_TIMER_PRESCALER) /**< water level measurement interval (ticks). */
+#define DATA_LOG_TIMER_MAX_SECONDS           480                                        /**< Longest timeout of the data logger timer, the 24 bit RTC1 counter wraps after 512 s (seconds). */
 #define CONNECTED_MODE_TIMEOUT_INTERVAL      APP_TIMER_TICKS(30000, APP_TIMER_PRESCALER)/**< Connected mode timeout interval (ticks). */
 #define SECONDS_INTERVAL                     APP_TIMER_TICKS(1000, APP_TIMER_PRESCALER) /**< seconds measurement interval (ticks). */
+#define TIME_KEEPING_SECONDS                 2                                          /**< Interval of the time keeping timer, shorter than the 512 s wrap of the RTC1 counter (seconds). */
+#define TIME_KEEPING_INTERVAL                APP_TIMER_TICKS(TIME_KEEPING_SECONDS * 1000, APP_TIMER_PRESCALER) /**< Time keeping interval (ticks). */
+#define BATTERY_MEAS_TICKS                   ((BATTERY_MEAS_INTERVAL * 60) / TIME_KEEPING_SECONDS)        /**< Time keeping intervals between battery measurements. */
 #define BROADCAST_INTERVAL       						 APP_TIMER_TICKS(1000, APP_TIMER_PRESCALER) /**< updating interval of broadcast data*/ 
 
 #define WATER_TYPE_AS_CHARACTERISTIC         0                                          /**< Determines if water type is given as characteristic (1) or as a field of measurement (0). */
@@ -125,34 +133,26 @@ static app_timer_id_t                        real_time_timer;
 static app_timer_id_t                        delay_timer;                               /**< Timer for implementing delay. */
 
 app_gpiote_user_id_t 								         waterp_measurement_gpiote;                 /**< water presence measurement gpiote. */
-ble_date_time_t                              m_time_stamp;                              /**< Time stamp. */
 
 uint8_t 																		 battery_level=0;                           /**< Battery level variable */
 
 bool 																				 ENABLE_DATA_LOG   = false;	  							/**< Flag to enable data logger */
-bool																				 ENABLE_DLOG_TIMER=false;										/**< Flag to start the data logger timer */
-bool																				 RESET_DLOG_TIMER = false;									/**< Flag to reset the data logger timer and make sure first log is 15 minutes later*/
-bool 																				 READ_DATA         = false;                 /**< Data reeding disabled initially */
+static uint32_t                              m_dlog_timer_remaining = 0;                /**< Seconds of the logging interval left after the running data logger timeout. */
+volatile bool 																				 READ_DATA         = false;                 /**< Data reeding disabled initially */
+bool 																				 DOWNLOAD_DATA     = false;                 /**< Flag to indicate that a data log download is in progress */
 bool 																				 START_DATA_READ   = true;									/**< Flag to start data logging*/
 bool 																				 TX_COMPLETE       = false;                 /**< Transmission completed flag */
 bool 																				 WATERP_EVENT_FLAG = false;                 /**< This flag indicates whether there is an event on gpiote*/
-bool                                         TIME_SET          = false;                 /**< Flag to start time updation*/
-bool                                         CHECK_ALARM_TIMEOUT = false;                 /**< Flag to indicate whether to check for alarm conditions*/
-bool                                         DATA_LOG_CHECK     = false;
-bool                                         MEAS_BATTERY_LEVEL = true;                /**< Flag for measuring the battery level */
-bool                                         delay_complete = false;                    /**< Flag to indicate the completion of delay*/
+volatile bool                                delay_complete = false;                    /**< Flag to indicate the completion of delay*/
 
 extern bool                                  WATERPS_CONNECTED_STATE;                   /**< This flag indicates water presence service is in connected state*/
 extern bool                                  WATERLS_CONNECTED_STATE;                   /**< This flag indicates water level service is in connected state*/
 extern bool																	 DLOGS_CONNECTED_STATE;                     /**< This flag indicate Dalatlogging is in connected state */
-extern bool  																 DFU_ENABLE;                                /**< This flag indicates DFU mode is enabled/not*/
-extern bool																	 LED_FLASH;																	/**< This flag indicates whether or not to flash the LED*/
 extern bool                                  DEVICE_CONNECTED_STATE;                    /**< This flag indicates device management service is in connected start or now*/
 volatile bool                                ACTIVE_CONN_FLAG = false;                  /**<flag indicating active connection*/
 
 volatile bool                                m_radio_event = false;                     /**< Radio notification event */
 uint8_t  																		 var_receive_uuid;  												/**<variable for receiving uuid >*/
-uint32_t buf[4];                                        															  /*buffer for flash write operation*/
 uint8_t				                               curr_waterpresence=0x01;                   /* water presence value for broadcast*/
 uint8_t                                      battery_lvl;                                 /*battery level for broadcasting*/
 
@@ -241,7 +241,6 @@ static void alarm_check(void)
     {
         APP_ERROR_HANDLER(err_code);
     }
-		delay_ms(100);																										 
 		//updating the advertise/broadcast data
 		if(ACTIVE_CONN_FLAG==false)               /* no active connection*/
 			advertising_init();                     
@@ -250,98 +249,81 @@ static void alarm_check(void)
 }
 
 
-/**@brief Function for performing a water parmaters level measurement, and  check for the alarm condition.
+/**@brief Function for answering the reads of the current values with a new measurement.
+*
+* @details The services request the measurement when a client reads a current value, so a
+*          client does not have to wait for the next alarm_check() to see a new value.
 */
-static void water_param_meas_timeout_handler(void * p_context)
+static void current_read(void)
 {
-    UNUSED_PARAMETER(p_context);
-    static uint8_t minutes_count = 0x01;
-		if (RESET_DLOG_TIMER)
-		{
-				minutes_count = 0x01;
-				RESET_DLOG_TIMER = false; 
-		}
-    if (minutes_count < 0x0F)
-    {
-        minutes_count++;
-    }
-    else 
+    uint32_t err_code;
+
+    err_code = ble_waterps_current_read_reply(&m_waterps);        /* Answer a pending read of the current water presence*/
+    if ((err_code != NRF_SUCCESS) && (err_code != NRF_ERROR_INVALID_STATE))
     {
-        minutes_count =0x01;
-        DATA_LOG_CHECK=true;
+        APP_ERROR_HANDLER(err_code);
     }
 }
 
 
-/**@brief Function for performing time keeping. Executed every second.
+/**@brief Function for starting the data logger timer.
+*
+* @details The timer is single shot and runs for the whole logging interval, an interval longer
+*          than the RTC1 counter range is split into the fewest timeouts possible.
+*
+* @param[in]   seconds   Time until the next data log.
 */
-static void real_time_timeout_handler(void * p_context)
+static void data_log_timer_start(uint32_t seconds)
 {
     uint32_t err_code;
-		static uint8_t sensor_check_sec = 0x01;
-	  static uint8_t battery_meas_timeout  = 0x00;
-	
-    //Store the number of days in every month to an array
-    uint8_t days_in_month[]={0,31,28,31,30,31,30,31,31,30,31,30,31};
+    uint32_t timeout = (seconds > DATA_LOG_TIMER_MAX_SECONDS) ? DATA_LOG_TIMER_MAX_SECONDS : seconds;
+
+    m_dlog_timer_remaining = seconds - timeout;
+    err_code = app_timer_start(water_measurement_timer, timeout * SECONDS_INTERVAL, NULL);
+    APP_ERROR_CHECK(err_code);
+}
 
-    //Check for leap year and set the days in February
-    if((m_time_stamp.year% 4 == 0 && m_time_stamp.year%100 != 0) || m_time_stamp.year%400 == 0)
+
+/**@brief Function for handling the data logger timer timeout, sets the flag for a data log once
+*        the logging interval has passed.
+*/
+static void water_param_meas_timeout_handler(void * p_context)
+{
+    UNUSED_PARAMETER(p_context);
+    if (m_dlog_timer_remaining != 0)
     {
-        days_in_month[2] = 29;
+        data_log_timer_start(m_dlog_timer_remaining);     /* Continue the logging interval*/
     }
     else
     {
-        days_in_month[2] = 28;
+        wimoto_evt_post(WIMOTO_EVT_DATA_LOG);
+        data_log_timer_start(m_dlogs.interval * 60);
     }
+}
 
-    //Increment the time stamp
-    m_time_stamp.seconds += 1;
-		
-		if(sensor_check_sec < 0x02)
-		{
-			sensor_check_sec += 1;
-		}
-		else
-		{
-		  sensor_check_sec = 1;
-			CHECK_ALARM_TIMEOUT=true;                           /* Set the flag to  check alarm conditions */
-		}
-		
-		NRF_WDT->RR[0] = 0x6E524635;					//kick the dog every second
-		
-    if (m_time_stamp.seconds > 59)
+
+/**@brief Function for performing time keeping. Executed every TIME_KEEPING_SECONDS.
+*
+* @details The time is counted by RTC1, reading it here keeps up with the wrap of the counter.
+*/
+static void real_time_timeout_handler(void * p_context)
+{
+    uint32_t err_code;
+    static uint16_t battery_meas_timeout = 0x00;
+
+    NRF_WDT->RR[0] = 0x6E524635;                          //kick the dog every time keeping interval
+    wimoto_evt_post(WIMOTO_EVT_ALARM_CHECK);              /*Check the alarm conditions in main loop*/
+
+    battery_meas_timeout++;
+    if(battery_meas_timeout >= BATTERY_MEAS_TICKS)        /*Check whether the battery measurement interval is reached*/
     {
-        m_time_stamp.seconds -= 60;
-        m_time_stamp.minutes++;
-        if (m_time_stamp.minutes > 59)
-        {
-            m_time_stamp.minutes = 0;
-            m_time_stamp.hours++;
-            if (m_time_stamp.hours > 23)
-            {
-                m_time_stamp.hours = 0;
-                m_time_stamp.day++;
-                if (m_time_stamp.day > (days_in_month[m_time_stamp.month]))	
-                {
-                    m_time_stamp.day = 1;
-                    m_time_stamp.month++;
-                    if (m_time_stamp.month > 12)	
-                    {
-                        m_time_stamp.month = 1;
-                        m_time_stamp.year++;
-                    }
-                }
-            }
-        }
-				battery_meas_timeout++;
-				if(battery_meas_timeout >= BATTERY_MEAS_INTERVAL) /*Check whether the battery measurement interval is reached*/
-				{
-					battery_meas_timeout = 0;
-				  MEAS_BATTERY_LEVEL = true;                      /*Set the flag to do battery measurement in main loop*/
-				}
+        battery_meas_timeout = 0;
+        wimoto_evt_post(WIMOTO_EVT_BATTERY_MEAS);         /*Measure the battery level in main loop*/
     }
-    // Update the current time
-    err_code= ble_time_update(&m_device, &m_time_stamp);   
+
+    // Notify the current time to a connected client
+    err_code = ble_time_update(&m_device);
+
     if ((err_code != NRF_SUCCESS) &&
             (err_code != NRF_ERROR_INVALID_STATE) &&
             (err_code != BLE_ERROR_NO_TX_BUFFERS) &&
@@ -453,12 +435,12 @@ static void timers_init(void)
 
     // Create timers
     err_code = app_timer_create(&water_measurement_timer, /* Timer for water level measurement time-out*/
-    APP_TIMER_MODE_REPEATED,
+    APP_TIMER_MODE_SINGLE_SHOT,
     water_param_meas_timeout_handler);
     APP_ERROR_CHECK(err_code);
 
     // Create timer for time keeping
-    err_code = app_timer_create(&real_time_timer,        /* Timer for Real time tracking, ie;time-out after 1s*/
+    err_code = app_timer_create(&real_time_timer,        /* Timer for Real time tracking*/
     APP_TIMER_MODE_REPEATED,
     real_time_timeout_handler);
     APP_ERROR_CHECK(err_code);
@@ -477,13 +459,11 @@ static void application_timers_start(void)
 {
     uint32_t err_code;
 
-    // Start application timers
-    //err_code = app_timer_start(water_measurement_timer, WATER_LEVEL_MEAS_INTERVAL, NULL);
-    //APP_ERROR_CHECK(err_code);
-
     // Start the time keeping timer
-    err_code = app_timer_start(real_time_timer, SECONDS_INTERVAL, NULL);
+    err_code = app_timer_start(real_time_timer, TIME_KEEPING_INTERVAL, NULL);
     APP_ERROR_CHECK(err_code);
+
+    wimoto_time_init(APP_TIMER_PRESCALER);              /* RTC1 is running now*/
 	
 }
 
@@ -499,20 +479,17 @@ static void gap_params_init(void)
     ble_gap_conn_params_t   gap_conn_params;
     ble_gap_conn_sec_mode_t sec_mode;
 		char deviceName[20];
-		uint8_t mac_add[3];
+		char * p_name_end;
 		
     BLE_GAP_CONN_SEC_MODE_SET_OPEN(&sec_mode);
 	
 		//MAC ADDRESS CODE
-		mac_add[0] = (NRF_FICR->DEVICEADDR0 & 0x00FF0000) >> 16;
-		mac_add[1] = (NRF_FICR->DEVICEADDR0 & 0x0000FF00) >> 8;
-		mac_add[2] = (NRF_FICR->DEVICEADDR0 & 0x000000FF);
-	
-		sprintf(&deviceName[0], "%s%02x%02x%02x", &DEVICE_NAME[0], mac_add[0], mac_add[1], mac_add[2]);
+		p_name_end = wimoto_format_str(deviceName, DEVICE_NAME);
+		p_name_end = wimoto_format_hex(p_name_end, NRF_FICR->DEVICEADDR0 & 0x00FFFFFF, 6);   /* low three bytes of the device address*/
 	
 		//END MAC ADDRESS CODE
 		
-    err_code = sd_ble_gap_device_name_set(&sec_mode, (const uint8_t *)deviceName, strlen(deviceName));
+    err_code = sd_ble_gap_device_name_set(&sec_mode, (const uint8_t *)deviceName, p_name_end - deviceName);
     APP_ERROR_CHECK(err_code);
 
     err_code = sd_ble_gap_appearance_set(BLE_APPEARANCE_GENERIC_THERMOMETER);
@@ -749,6 +726,7 @@ static void dlogs_init(void)
     dlogs_init.p_report_ref         = NULL; 
     dlogs_init.data_logger_enable   = DEFAULT_ALARM_SET;
     dlogs_init.read_data_switch     = DEFAULT_ALARM_SET;
+    dlogs_init.log_interval         = DATA_LOGGER_DEFAULT_INTERVAL;
 
     err_code = ble_dlogs_init(&m_dlogs, &dlogs_init);
     APP_ERROR_CHECK(err_code);
@@ -978,6 +956,7 @@ static void ble_evt_dispatch(ble_evt_t * p_ble_evt)
     ble_device_on_ble_evt(&m_device, p_ble_evt);
     ble_conn_params_on_ble_evt(p_ble_evt);
     dm_ble_evt_handler(p_ble_evt);                  /*added for migrating to soft device 7.0.0 and SDK 6.1.0*/
+    wimoto_hvx_on_ble_evt(p_ble_evt);
     on_ble_evt(p_ble_evt);
 }
 
@@ -1067,6 +1046,7 @@ static void power_manage(void)
 */
 static void create_log_data(uint32_t * data)
 {
+    ble_date_time_t time_stamp;
     uint8_t current_water_presence;
 		uint8_t waterp_pin_reading;
 	
@@ -1095,8 +1075,9 @@ static void create_log_data(uint32_t * data)
 	
 		current_water_presence = !(waterp_pin_reading);																		/* Active Low voltage in pin indicates water presence.So invert the waterp_pin_reading */
     
-	  data[0]=(m_time_stamp.year<<16)|(m_time_stamp.month<<8)|m_time_stamp.day;				 	/* First word writeen to memory contains date (YYYYMMDD)*/
-    data[1]=(m_time_stamp.hours<<24)|(m_time_stamp.minutes<<16)|(m_time_stamp.seconds<<8); /* Second word contains time HHMMSS*/
+	  wimoto_time_date_time_get(&time_stamp);
+	  data[0]=(time_stamp.year<<16)|(time_stamp.month<<8)|time_stamp.day;				 	/* First word writeen to memory contains date (YYYYMMDD)*/
+    data[1]=(time_stamp.hours<<24)|(time_stamp.minutes<<16)|(time_stamp.seconds<<8); /* Second word contains time HHMMSS*/
 
     data[2]=current_water_presence;																										/* Third word contains water presence*/	
 		data[3]=log_id;																																		/* Fourth word contains log id*/
@@ -1111,17 +1092,34 @@ static void create_log_data(uint32_t * data)
 }
 
 
+/**@brief Function for updating the flash wear characteristic from the data logger.
+*/
+static void flash_wear_update(void)
+{
+    uint32_t         err_code;
+    ble_dlogs_wear_t wear;
+
+    data_log_wear_get(&wear);
+    err_code = ble_flash_wear_update(&m_device, &wear);
+    APP_ERROR_CHECK(err_code);
+}
+
+
 /**@brief Function for checking whether to log data.
 */
 static void data_log_check()
 {
     uint32_t log_data[4] = {0x00,0x00,0x00,0x00};         /* Array storing the data to be logged */
 
-    if(ENABLE_DATA_LOG && !READ_DATA)									    /* If enabled, start data logging functionality*/
+    if(ENABLE_DATA_LOG)									    /* If enabled, start data logging functionality*/
     {   
         create_log_data(log_data);                        /* Create the data to be logged */
-        write_data_flash(log_data);	                      /* Log the data to flash */
+        if (write_data_flash(log_data) == NRF_ERROR_INVALID_STATE)   /* Queue the data to be logged to flash */
+        {
+            log_id--;                                     /* Within the deadband, the record ID is kept for the next data log*/
+        }
     }
+    flash_wear_update();                                  /* Show the flash wear, updated by the data logger*/
 }
 
 
@@ -1175,6 +1173,10 @@ static void sys_evt_dispatch(uint32_t sys_evt)
 {
     pstorage_sys_event_handler(sys_evt);
 		data_log_sys_event_handler(sys_evt);               /*added event handler for flash write operation*/
+    if (READ_DATA)
+    {
+        wimoto_evt_post(WIMOTO_EVT_READ_DATA);                /* Retry the flush before a download when the flash operation is done*/
+    }
     on_sys_evt(sys_evt);
 }
 
@@ -1263,7 +1265,7 @@ void WDT_init(void)
 		NRF_WDT->CONFIG = WDT_CONFIG_HALT_Pause << WDT_CONFIG_HALT_Pos |							//pause WDT when device in debug mode
 											WDT_CONFIG_SLEEP_Run << WDT_CONFIG_SLEEP_Pos;								//continue WDT when device is in sleep mode
 		
-		NRF_WDT->CRV = 4*32768;								//set watchdog to have 2 second timeout
+		NRF_WDT->CRV = (TIME_KEEPING_SECONDS + 4)*32768;		//set watchdog to time out 4 seconds after a missed time keeping interval
 		NRF_WDT->RREN |= WDT_RREN_RR0_Msk;		//enable reload register0
 		NRF_WDT->TASKS_START = 1;							//start watchdog timer
 		
@@ -1372,16 +1374,107 @@ void reset_conn_params()
 	APP_ERROR_CHECK(err_code);
 }
 
+/**@brief Function for handling the application events.
+*
+* @details Called from app_sched_execute() in the main loop for every event posted by the timer,
+*          GPIOTE and BLE handlers, so each wakeup only does the work that is pending.
+*
+* @param[in]   evt   Application event.
+*/
+static void app_evt_handler(wimoto_evt_t evt)
+{
+    uint32_t err_code;
+    uint16_t len = 1;
+    uint8_t  val = 0;
+
+    switch (evt)
+    {
+        case WIMOTO_EVT_DFU_ENABLE:                               /* Go to the bootloader*/
+            sd_power_gpregret_set(1);                             /* Set the value of general purpose retention register to 1*/
+            err_code = sd_ble_gatts_service_changed(m_conn_handle,0x01,0x4D); /*function for service change indication*/
+            UNUSED_VARIABLE(err_code);
+            sd_nvic_SystemReset();                                /* Apply a system reset for jumping into bootloader*/
+            break;
+
+        case WIMOTO_EVT_LED_FLASH:                                /* Flash the red LED*/
+            err_code = sd_ble_gatts_value_set(m_device.dfu_mode_handles.value_handle , 0, &len, &val);  /* Reset characteristic value */
+            APP_ERROR_CHECK(err_code);
+            LED_ON(18,19);
+            break;
+
+        case WIMOTO_EVT_DLOG_TIMER_START:                         /* The data logger has been enabled or its interval changed, restart the timer*/
+            err_code = app_timer_stop(water_measurement_timer);
+            APP_ERROR_CHECK(err_code);
+            data_log_timer_start(m_dlogs.interval * 60);
+            wimoto_evt_post(WIMOTO_EVT_DATA_LOG);                 /* Create a data log immediately upon enabling logging functionality*/
+            break;
+
+        case WIMOTO_EVT_DATA_LOG:
+            data_log_check();
+            break;
+
+        case WIMOTO_EVT_READ_DATA:                                /* Start sending data to the connected device*/
+            if(READ_DATA && data_log_flush())                     /* Posted again by the flash events until the log is written*/
+            {
+                READ_DATA = false;
+                DOWNLOAD_DATA = true;                             /* Logging continues while the data is sent*/
+                if(((write_pg != 0) && (read_pg < (write_pg - 1))) || (read_pg > write_pg))
+                {
+                    update_conn_params();                         /* Update connection parameters if there is enough data*/
+                }
+                wimoto_evt_post(WIMOTO_EVT_DOWNLOAD);
+            }
+            break;
+
+        case WIMOTO_EVT_DOWNLOAD:
+            if(DOWNLOAD_DATA && send_data(&m_dlogs))              /* Send the data, continued on every TX complete event*/
+            {
+                DOWNLOAD_DATA = false;
+                if(param_updated == true)
+                {
+                    reset_conn_params();                          /* Reset the conn params to maintain decent power consumption */
+                }
+                err_code=reset_data_log(&m_dlogs);                /* Reset the data read switch*/
+                APP_ERROR_CHECK(err_code);
+            }
+            break;
+
+        case WIMOTO_EVT_TIME_SET:
+            (void)create_time_stamp(&m_device);                   /* Set the clock to the user set time, an invalid time is ignored*/
+            break;
+
+        case WIMOTO_EVT_ALARM_CHECK:
+            alarm_check();                                        /* Checks for alarm in all services*/
+            break;
+
+        case WIMOTO_EVT_READ_SENSORS:                             /* A client read a current value*/
+            current_read();
+            break;
+
+        case WIMOTO_EVT_BATTERY_MEAS:
+            battery_start();                                      /* Measure battery level*/
+            break;
+
+        default:
+            // No implementation needed.
+            break;
+    }
+}
+
+
 /**@brief Function for application main entry.
 */
 void connectable_mode(void)
 {
-    uint32_t err_code;
-			uint16_t len = 1;
-		uint8_t	 val = 0;
+    uint16_t next_log_id;                  /* log ID following the newest data log in flash*/
     // Initialization.
 		get_die_revision_no();								 	/*Get silicon revision before init*/
+    wimoto_evt_init(app_evt_handler);      /* Queue the application events on the scheduler*/
     ble_stack_init();											        
+    if (data_log_init(&next_log_id))       /* Restore the data logger pointers from flash*/
+    {
+        log_id = next_log_id;              /* Continue the record ID of the last data log*/
+    }
     timers_init();
     gpiote_init();
 	  device_manager_init();
@@ -1389,6 +1482,7 @@ void connectable_mode(void)
 	  //init_battery_level();                 /*measure the battery level before advertisement*/
     advertising_init();
     services_init();
+    flash_wear_update();
     conn_params_init();
     sec_params_init();
     radio_notification_init();
@@ -1403,85 +1497,14 @@ void connectable_mode(void)
 		LED_ON(20,NULL);
 		 
 
+    wimoto_evt_post(WIMOTO_EVT_BATTERY_MEAS);             /* Measure the battery level at start up*/
+
     // Enter main loop.
     for (;;)
     {
-
-			// If the dfu enable flag is true go to the bootloader
-        if(DFU_ENABLE)  
-        {   
-            sd_power_gpregret_set(1);                                /* If DFU mode is enabled, set the general purpose retention register to 1*/
-           
-						err_code=sd_ble_gatts_service_changed(m_conn_handle,0x01,0x4D); /*function for service change indication*/
-
-						sd_nvic_SystemReset();                                    /* Apply a system reset for jumping into bootloader*/
-        }
-				if(LED_FLASH)																									/* If LED flash flag is enabled, flash the red LED*/
-				{		
-						val = 0;
-						err_code = sd_ble_gatts_value_set(m_device.dfu_mode_handles.value_handle , 0, &len, &val);
-						APP_ERROR_CHECK(err_code);
-						LED_ON(18,19);
-						LED_FLASH = false;
-						
-				}
-				if (ENABLE_DLOG_TIMER)																/* If the data logger has been enabled, start the timer*/
-				{
-					err_code = app_timer_start(water_measurement_timer, WATER_LEVEL_MEAS_INTERVAL, NULL);
-					APP_ERROR_CHECK(err_code);
-					ENABLE_DLOG_TIMER = false;
-					DATA_LOG_CHECK = true;															/* Create a data log immediately upon enabling logging functionality*/
-					RESET_DLOG_TIMER = true;														/* Make sure that the timer gets reset so that first log is 15 minutes later*/
-				}
-        if (DATA_LOG_CHECK)
-        {		
-             data_log_check();
-            DATA_LOG_CHECK= false;
-        }
-
-        // If READ_DATA flag is set, start sending data to the connected device
-        if(READ_DATA)																			       
-        {
-            err_code=app_timer_stop(water_measurement_timer);		       	/* Stop the timers before start sending the historical data*/
-            APP_ERROR_CHECK(err_code);
-            READ_DATA=false;
-            ENABLE_DATA_LOG = false;                                    /* Disable data logging functionality */
-						if(((write_pg != 0) && (read_pg < (write_pg - 1))) || (read_pg > write_pg))
-						{
-							update_conn_params();																			/* UPDATE CONNECTION PARAMETERS, THIS NEEDS TO BECOME CONDITIONAL THOUGH*/
-						}
-            send_data(&m_dlogs);																        /* Start sending the data*/	
-						if(param_updated == true)
-						{
-							reset_conn_params();																			/* Reset the conn params to maintain decent power consumption */
-						}
-            err_code=reset_data_log(&m_dlogs);									        /* Reset the data logger enable and data read switches*/
-            APP_ERROR_CHECK(err_code);	
-        }
-
-        // If TIME_SET flag is set, create new time stamp
-        if(TIME_SET)                                                   
-        {
-            create_time_stamp(&m_device, &m_time_stamp);                /* Create new time stamp from user set time*/
-            TIME_SET = false;                                           /* Reset the flag*/
-        }
-
-
-        if (CHECK_ALARM_TIMEOUT)                                        /* Check for sensor measurement time-out*/
-        {
-            alarm_check();
-            CHECK_ALARM_TIMEOUT=false;                                  /* Reset the flag*/
-        }
-				
-        if(MEAS_BATTERY_LEVEL)
-				{
-					  battery_start();		                                        /* Measure battery level*/
-						MEAS_BATTERY_LEVEL = false;
-				}
-        power_manage(); 
-
+        app_sched_execute();                                  /* Handle the pending application events*/
+        power_manage();                                       /* Switch to a low power state*/
     }
-
 }
 
 // * @}
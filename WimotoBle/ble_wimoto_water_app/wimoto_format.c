@@ -0,0 +1,54 @@
+/**
+*@file     This file contains the integer formatting of device names and characteristic values.
+*
+*@details  The digits are taken with shifts and masks, so no division runs on the Cortex-M0.
+*/
+
+#include "wimoto_format.h"
+
+static const char hex_digits[] = "0123456789abcdef";
+
+
+char * wimoto_format_str(char * p_dest, const char * p_str)
+{
+    while (*p_str != '\0')
+    {
+        *p_dest++ = *p_str++;
+    }
+
+    return p_dest;
+}
+
+
+char * wimoto_format_hex(char * p_dest, uint32_t value, uint8_t digits)
+{
+    while (digits != 0)
+    {
+        digits--;
+        *p_dest++ = hex_digits[(value >> (4 * digits)) & 0x0F];
+    }
+
+    return p_dest;
+}
+
+
+void wimoto_encode_int16(int32_t value, uint8_t * p_encoded)
+{
+    if (value > INT16_MAX)
+    {
+        value = INT16_MAX;
+    }
+    else if (value < INT16_MIN)
+    {
+        value = INT16_MIN;
+    }
+
+    p_encoded[0] = (uint8_t)((uint16_t)value >> 8);
+    p_encoded[1] = (uint8_t)value;
+}
+
+
+int16_t wimoto_decode_int16(const uint8_t * p_encoded)
+{
+    return (int16_t)(((uint16_t)p_encoded[0] << 8) | p_encoded[1]);
+}